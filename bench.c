@@ -0,0 +1,517 @@
+// ExamSys microbenchmarks: times the server's core routines on synthetic data of several
+// sizes and reports ns/op and allocations/op, optionally against a saved baseline.
+//
+// Build and run:
+//   gcc -O2 -pthread bench.c -o bench -lm && ./bench
+//   ./bench -s baseline.txt      save the results
+//   ./bench -c baseline.txt      compare against them
+// The routines are compiled from server.c itself, so they are timed exactly as shipped.
+#define EXAMSYS_NO_MAIN
+#include "server.c"
+
+#define BENCH_ROUNDS 5          // Timed rounds per benchmark; the fastest one is reported
+#define BENCH_MAX_SIZES 4
+#define BENCH_MAX_RESULTS 64
+
+// Allocation counting: the benchmark replaces the allocator entry points and forwards to glibc
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void __libc_free(void *p);
+
+atomic_long allocations = 0;
+
+void *malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void free(void *p) {
+    __libc_free(p);
+}
+
+// One routine under test. setup prepares data of the given size and run performs one
+// iteration, returning how many operations it did.
+typedef struct {
+    const char *name;
+    int sizes[BENCH_MAX_SIZES];
+    void (*setup)(int size);
+    long (*run)(int size);
+} Bench;
+
+// A measured or saved result
+typedef struct {
+    char name[64];
+    int size;
+    double nsPerOp;
+    double allocsPerOp;
+} BenchResult;
+
+Exam *benchExam;                       // Exam whose files live in the scratch directory
+FILE *report;                          // Where results go; stdout is silenced while timing
+FILE *linesFile;                       // Fixture for qb_next_line
+char lookupRolls[64][50];              // Rolls verify_student looks up, spread over the file
+int lookupNext = 0;
+DashboardStudent unranked[MAX_STUDENTS]; // Dashboard rows before rankStudents sorts them
+PaperBuf *benchPaper;                  // Paper sent by the send path benchmark
+Conn benchConn;                        // Connection the paper goes out on
+int drainSock = -1;                    // Other end of benchConn's socket pair
+IrtTable benchIrt;                     // Calibrated bank the adaptive benchmarks select from
+IrtResponse *benchResponses;           // Past answers irt_calibrate fits
+
+// Deterministic pseudo-random numbers, so every run sees the same data
+unsigned int benchSeed = 12345;
+
+int bench_rand() {
+    benchSeed = benchSeed * 1103515245u + 12345u;
+    return (benchSeed >> 16) & 0x7fff;
+}
+
+// Writes a question file with count questions of realistic length.
+void write_questions(int count) {
+    FILE *fp = fopen(QUESTION_FILE, "w");
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, "Question %d: which of the following best describes process scheduling case %d?\n",
+                i + 1, bench_rand());
+        for (int o = 0; o < 4; o++) {
+            fprintf(fp, "Option %c for question %d, a moderately long answer text\n", 'A' + o, i + 1);
+        }
+        fprintf(fp, "%c\n%d\n\n", 'A' + bench_rand() % 4, 1 + bench_rand() % 3);
+    }
+    fclose(fp);
+}
+
+// Writes a results file with count rows.
+void write_results(int count) {
+    FILE *fp = fopen(RESULT_FILE, "w");
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, "S%d|Student%d|%d|%d|0|%d|", i, i, bench_rand() % 6, NUM_EXAM_QUESTIONS, 20 + bench_rand() % 200);
+        for (int q = 0; q < NUM_EXAM_QUESTIONS; q++) fprintf(fp, "%d,", 1 + bench_rand() % 40);
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+}
+
+// Fixture: a text file of size lines, every fourth one blank or indented.
+void setup_lines(int size) {
+    FILE *fp = fopen("lines.txt", "w");
+    for (int i = 0; i < size; i++) {
+        if (i % 4 == 3) fprintf(fp, "   \n");
+        else fprintf(fp, "%sLine %d of the synthetic question bank with some text\n", i % 4 == 1 ? "    " : "", i);
+    }
+    fclose(fp);
+    if (linesFile) fclose(linesFile);
+    linesFile = fopen("lines.txt", "r");
+}
+
+long run_qb_next_line(int size) {
+    (void)size;
+    static char *buf = NULL;
+    static size_t cap = 0;
+    char *line;
+    int lineNo = 0;
+    long ops = 0;
+    rewind(linesFile);
+    while (qb_next_line(linesFile, &buf, &cap, &line, &lineNo) >= 0) ops++;
+    return ops;
+}
+
+void setup_load_questions(int size) {
+    write_questions(size);
+}
+
+long run_load_questions(int size) {
+    (void)size;
+    load_questions(benchExam);
+    return 1;
+}
+
+// Fixture: a student file of size students, and rolls to look up spread evenly over it.
+void setup_verify_student(int size) {
+    FILE *fp = fopen(STUDENT_FILE, "w");
+    for (int i = 0; i < size; i++) {
+        fprintf(fp, "Student%d S%d REG%06d pw%d\n", i, i, i, i);
+    }
+    fclose(fp);
+    // Logins check the in-memory index, rebuilt here as the reload thread would
+    cred_store_load(&studentCreds);
+    for (int i = 0; i < 64; i++) {
+        snprintf(lookupRolls[i], sizeof(lookupRolls[i]), "S%d", (int)((long)size * i / 64 + bench_rand() % (size / 64 + 1)) % size);
+    }
+    lookupNext = 0;
+}
+
+long run_verify_student(int size) {
+    (void)size;
+    char name[50], regNo[50], pass[50];
+    const char *roll = lookupRolls[lookupNext++ & 63];
+    snprintf(pass, sizeof(pass), "pw%s", roll + 1);
+    if (!verify_student(roll, pass, name, regNo)) fprintf(report, "📛 verify_student failed for %s\n", roll);
+    return 1;
+}
+
+long run_cred_store_load(int size) {
+    (void)size;
+    cred_store_load(&studentCreds);
+    return 1;
+}
+
+void setup_append_result(int size) {
+    write_results(size);
+}
+
+long run_append_result(int size) {
+    (void)size;
+    DashboardStudent s = { .roll = "S1", .name = "Student1", .correctAnswers = 3,
+                           .totalQuestions = NUM_EXAM_QUESTIONS, .answeredCount = NUM_EXAM_QUESTIONS, .totalTime = 60,
+                           .responseTimes = { 10, 12, 9, 14, 15 } };
+    append_result(benchExam, &s);
+    return 1;
+}
+
+void setup_dashboard(int size) {
+    write_results(size);
+}
+
+long run_load_dashboard(int size) {
+    (void)size;
+    loadDashboardData(benchExam);
+    return 1;
+}
+
+// Fixture: size dashboard rows loaded from a results file, kept unsorted for rankStudents.
+void setup_loaded_dashboard(int size) {
+    write_results(size);
+    loadDashboardData(benchExam);
+    memcpy(unranked, dashboardStudents, sizeof(DashboardStudent) * studentCount);
+}
+
+long run_flag_suspicious(int size) {
+    (void)size;
+    flagSuspiciousActivity();
+    return 1;
+}
+
+// Includes restoring the unsorted rows, since rankStudents sorts in place.
+long run_rank_students(int size) {
+    memcpy(dashboardStudents, unranked, sizeof(DashboardStudent) * size);
+    studentCount = size;
+    rankStudents();
+    return 1;
+}
+
+// Fixture: a text bank of size questions and its compiled form, which load_questions maps.
+void setup_load_qbank(int size) {
+    write_questions(size);
+    FILE *fp = fopen(QUESTION_FILE, "r");
+    QBankBuilder b;
+    qb_init(&b);
+    qb_parse_text(&b, fp, NULL);
+    fclose(fp);
+    size_t len;
+    void *image = qb_image(&b, &len);
+    qb_free(&b);
+    fp = fopen(QBANK_FILE, "w");
+    if (image == NULL || fp == NULL || fwrite(image, 1, len, fp) != len) {
+        perror("📛 Error writing compiled bank");
+        exit(EXIT_FAILURE);
+    }
+    fclose(fp);
+    free(image);
+}
+
+void setup_paper_build(int size) {
+    write_questions(size);
+    load_questions(benchExam);
+}
+
+// A new seed per call, as every student gets their own paper.
+long run_paper_build(int size) {
+    static uint64_t seed;
+    (void)size;
+    BankSnapshot *b = bank_acquire(&benchExam->bank);
+    PaperBuf *paper = paper_build(benchExam, b, ++seed);
+    bank_release(b);
+    if (paper) paper_release(paper);
+    return 1;
+}
+
+// Fixture: a paper from a bank of size questions and a connected socket pair to send it on.
+void setup_send_paper(int size) {
+    setup_paper_build(size);
+    if (benchPaper) paper_release(benchPaper);
+    BankSnapshot *b = bank_acquire(&benchExam->bank);
+    benchPaper = paper_build(benchExam, b, 0);
+    bank_release(b);
+    if (drainSock < 0) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+            perror("📛 Error creating socket pair");
+            exit(EXIT_FAILURE);
+        }
+        memset(&benchConn, 0, sizeof(benchConn));
+        benchConn.sock = sv[0];
+        benchConn.state = CONN_EXAM;
+        benchConn.loop = &loops[0];
+        drainSock = sv[1];
+    }
+}
+
+long run_send_paper(int size) {
+    (void)size;
+    char buf[16384];
+    conn_send_paper(&benchConn, benchPaper);
+    size_t got = 0;
+    while (got < benchPaper->len) {
+        ssize_t n = recv(drainSock, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        got += n;
+    }
+    return 1;
+}
+
+// Fixture: size questions with spread-out parameters, as a calibration would leave them.
+void setup_irt_items(int size) {
+    free(benchIrt.items);
+    benchIrt.items = malloc(sizeof(IrtItem) * size);
+    benchIrt.count = size;
+    for (int i = 0; i < size; i++) {
+        benchIrt.items[i].a = 0.5f + (bench_rand() % 1000) / 1000.0f * 1.5f;
+        benchIrt.items[i].b = (bench_rand() % 1000) / 1000.0f * 6.0f - 3.0f;
+    }
+}
+
+long run_irt_table_build(int size) {
+    (void)size;
+    free(benchIrt.best);
+    irt_table_build(&benchIrt, 1);
+    return 1;
+}
+
+void setup_adaptive_next(int size) {
+    setup_irt_items(size);
+    run_irt_table_build(size);
+}
+
+// One step of an adaptive paper: fold in the last answer, pick the next question. Papers
+// run to 20 questions, then a new student starts.
+long run_adaptive_next(int size) {
+    static Prng rng;
+    static IrtAbility ability;
+    static int used[20], asked = 0;
+    (void)size;
+    if (asked == 0 || asked == 20) {
+        irt_ability_init(&ability);
+        asked = 0;
+    } else {
+        irt_ability_update(&ability, &benchIrt.items[used[asked - 1]], prng_next(&rng) & 1);
+    }
+    int qid = irt_select(&benchIrt, ability.theta, used, asked, &rng);
+    used[asked++] = qid < 0 ? 0 : qid;
+    return 1;
+}
+
+// Fixture: size past answers to a 1,000-question bank, 20 per student.
+void setup_irt_calibrate(int size) {
+    setup_irt_items(1000);
+    free(benchResponses);
+    benchResponses = malloc(sizeof(IrtResponse) * size);
+    for (int k = 0; k < size; k++) {
+        benchResponses[k].person = k / 20;
+        benchResponses[k].item = bench_rand() % 1000;
+        benchResponses[k].correct = bench_rand() & 1;
+    }
+}
+
+long run_irt_calibrate(int size) {
+    for (int i = 0; i < 1000; i++) {
+        benchIrt.items[i].a = 1.0f;
+        benchIrt.items[i].b = 0.0f;
+    }
+    irt_calibrate(benchIrt.items, 1000, benchResponses, size, (size + 19) / 20);
+    return 1;
+}
+
+Bench benches[] = {
+    { "qb_next_line",           { 1000, 10000, 100000 }, setup_lines,             run_qb_next_line },
+    { "load_questions",         { 10, 50, 200, 100000 }, setup_load_questions,    run_load_questions },
+    { "verify_student",         { 100, 1000, 10000 },    setup_verify_student,    run_verify_student },
+    { "cred_store_load",        { 100, 1000, 10000 },    setup_verify_student,    run_cred_store_load },
+    { "append_result",          { 0, 10000 },            setup_append_result,     run_append_result },
+    { "loadDashboardData",      { 10, 50, MAX_STUDENTS }, setup_dashboard,        run_load_dashboard },
+    { "flagSuspiciousActivity", { 10, 50, MAX_STUDENTS }, setup_loaded_dashboard, run_flag_suspicious },
+    { "rankStudents",           { 10, 50, MAX_STUDENTS }, setup_loaded_dashboard, run_rank_students },
+    { "paper_build",            { 10, 200, 100000 },     setup_paper_build,       run_paper_build },
+    { "conn_send_paper",        { 10, 200 },             setup_send_paper,        run_send_paper },
+    { "irt_table_build",        { 200, 100000 },         setup_irt_items,         run_irt_table_build },
+    { "adaptive_next",          { 200, 100000 },         setup_adaptive_next,     run_adaptive_next },
+    { "irt_calibrate",          { 10000, 100000 },       setup_irt_calibrate,     run_irt_calibrate },
+    // Last: the compiled bank it leaves behind would otherwise replace the text bank above
+    { "load_qbank",             { 1000, 100000 },        setup_load_qbank,        run_load_questions },
+};
+
+// Times one benchmark at one size: BENCH_ROUNDS rounds of at least roundUs each, keeping
+// the time and allocations of the fastest round, which is the least disturbed by the rest
+// of the machine.
+BenchResult measure(Bench *b, int size, long roundUs) {
+    BenchResult r;
+    snprintf(r.name, sizeof(r.name), "%s", b->name);
+    r.size = size;
+    r.nsPerOp = 0;
+    r.allocsPerOp = 0;
+    b->setup(size);
+    b->run(size);   // Warm caches and the page cache
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        struct timespec started;
+        long ops = 0;
+        long allocsBefore = atomic_load(&allocations);
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        long long us;
+        do {
+            for (int i = 0; i < 16; i++) ops += b->run(size);
+            us = elapsed_us(&started);
+        } while (us < roundUs);
+        double ns = us * 1000.0 / ops;
+        if (round == 0 || ns < r.nsPerOp) {
+            r.nsPerOp = ns;
+            r.allocsPerOp = (double)(atomic_load(&allocations) - allocsBefore) / ops;
+        }
+    }
+    return r;
+}
+
+// Reads a baseline saved with -s. Returns the number of results read.
+int load_baseline(const char *path, BenchResult *out) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror("📛 Error opening baseline");
+        exit(EXIT_FAILURE);
+    }
+    int n = 0;
+    while (n < BENCH_MAX_RESULTS &&
+           fscanf(fp, "%63s %d %lf %lf", out[n].name, &out[n].size, &out[n].nsPerOp, &out[n].allocsPerOp) == 4) {
+        n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+// Finds a benchmark result in a baseline.
+BenchResult *baseline_find(BenchResult *base, int count, BenchResult *r) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(base[i].name, r->name) == 0 && base[i].size == r->size) return &base[i];
+    }
+    return NULL;
+}
+
+// Prints the command line options.
+void bench_usage(const char *prog) {
+    printf("Usage: %s [-f filter] [-t ms] [-s file] [-c file]\n", prog);
+    printf("  -f filter  only run benchmarks whose name contains filter\n");
+    printf("  -t ms      length of each timed round (default 50)\n");
+    printf("  -s file    save the results as a baseline\n");
+    printf("  -c file    compare the results against a saved baseline\n");
+}
+
+// Main function: builds the fixtures in a scratch directory and runs every benchmark.
+int main(int argc, char *argv[]) {
+    const char *filter = NULL, *savePath = NULL, *comparePath = NULL;
+    long roundMs = 50;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:t:s:c:h")) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 't': roundMs = atol(optarg); break;
+            case 's': savePath = optarg; break;
+            case 'c': comparePath = optarg; break;
+            default:
+                bench_usage(argv[0]);
+                exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (roundMs < 1) {
+        printf("📛 Invalid option value\n");
+        bench_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Baseline files are named relative to where the benchmark was started
+    BenchResult baseline[BENCH_MAX_RESULTS];
+    int baselineCount = comparePath ? load_baseline(comparePath, baseline) : 0;
+    FILE *save = NULL;
+    if (savePath && (save = fopen(savePath, "w")) == NULL) {
+        perror("📛 Error opening baseline for writing");
+        exit(EXIT_FAILURE);
+    }
+
+    char scratch[] = "/tmp/examsys-bench-XXXXXX";
+    if (mkdtemp(scratch) == NULL || chdir(scratch) < 0) {
+        perror("📛 Error creating scratch directory");
+        exit(EXIT_FAILURE);
+    }
+
+    // The routines print progress as they would for the instructor; keep it out of the report
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    if (report == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+        perror("📛 Error redirecting output");
+        exit(EXIT_FAILURE);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    write_questions(NUM_EXAM_QUESTIONS);
+    benchExam = exam_create(DEFAULT_EXAM, ".");
+    if (benchExam == NULL) exit(EXIT_FAILURE);
+
+    fprintf(report, "\n⏱️  ExamSys microbenchmarks (%d rounds of %ld ms, fastest shown)\n", BENCH_ROUNDS, roundMs);
+    fprintf(report, "+------------------------+--------+--------------+-----------+");
+    if (baselineCount) fprintf(report, "--------------+---------+");
+    fprintf(report, "\n| Benchmark              |   Size |        ns/op | allocs/op |");
+    if (baselineCount) fprintf(report, "     Baseline |  Change |");
+    fprintf(report, "\n+------------------------+--------+--------------+-----------+");
+    if (baselineCount) fprintf(report, "--------------+---------+");
+    fprintf(report, "\n");
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        Bench *b = &benches[i];
+        if (filter && strstr(b->name, filter) == NULL) continue;
+        for (int k = 0; k < BENCH_MAX_SIZES && (k == 0 || b->sizes[k] != 0); k++) {
+            BenchResult r = measure(b, b->sizes[k], roundMs * 1000);
+            fprintf(report, "| %-22s | %6d | %12.1f | %9.2f |", r.name, r.size, r.nsPerOp, r.allocsPerOp);
+            BenchResult *base = baselineCount ? baseline_find(baseline, baselineCount, &r) : NULL;
+            if (base) {
+                fprintf(report, " %12.1f | %+6.1f%% |", base->nsPerOp, (r.nsPerOp / base->nsPerOp - 1.0) * 100.0);
+            } else if (baselineCount) {
+                fprintf(report, " %12s | %7s |", "-", "new");
+            }
+            fprintf(report, "\n");
+            fflush(report);
+            if (save) fprintf(save, "%s %d %.1f %.2f\n", r.name, r.size, r.nsPerOp, r.allocsPerOp);
+        }
+    }
+    fprintf(report, "+------------------------+--------+--------------+-----------+");
+    if (baselineCount) fprintf(report, "--------------+---------+");
+    fprintf(report, "\n");
+
+    if (save) {
+        fclose(save);
+        fprintf(report, "💾 Baseline saved to %s\n", savePath);
+    }
+
+    // Clean up the scratch directory
+    const char *files[] = { QUESTION_FILE, QBANK_FILE, RULES_FILE, RESULT_FILE, STUDENT_FILE, "lines.txt" };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) unlink(files[i]);
+    if (chdir("/") != 0 || rmdir(scratch) != 0) {
+        fprintf(report, "📛 Could not remove scratch directory %s: %s\n", scratch, strerror(errno));
+    }
+    return 0;
+}
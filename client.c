@@ -1,7 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <pthread.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <termios.h>
@@ -11,38 +10,58 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <errno.h>
+#include "protocol.h"
 
 // Maximum line length for input/output buffers
 #define MAX_LINE 512
-// Number of questions in the exam
+// Number of questions in a fixed exam paper; adaptive papers hold up to PROTO_MAX_QUESTIONS
 #define NUM_EXAM_QUESTIONS 5
 // Minimum time (in seconds) to consider an answer as not suspicious
 #define MIN_ANSWER_TIME 5
 // Server IP and port configuration
 #define SERVER_IP "127.0.0.1"
 #define SERVER_PORT 8080
+// Reconnect attempts after the connection drops mid-exam, one second apart
+#define RESUME_ATTEMPTS 5
 
-// Flag to indicate if overall exam time is up (shared between threads)
-volatile int examTimeUp = 0;
-// Total allowed time for the entire exam (in seconds)
+// Total allowed time for the entire exam (in seconds), as sent by the server
 int overallExamTime = 300;
+// When the overall exam time runs out
+time_t examDeadline;
 
-// Structure representing a single MCQ question
+// Structure representing a single MCQ question; its texts live in the session's arena
 typedef struct {
-    char question[MAX_LINE];
-    char optionA[MAX_LINE];
-    char optionB[MAX_LINE];
-    char optionC[MAX_LINE];
-    char optionD[MAX_LINE];
+    int id;            // Question id assigned by the server, quoted in answers
+    const char *text[5]; // Question, then options A-D
     char correct;      // Correct answer: 'A', 'B', 'C', or 'D'
     int difficulty;    // Difficulty level: 1 (easy), 2 (medium), 3 (hard)
+    int answered;      // 1 once an answer was given, kept for re-sending after a reconnect
+    char answer;       // Option given, or 0 if none
+    long answerMs;     // Response time of that answer in ms
 } Question;
 
+// The connection to the server and what is needed to resume it after a drop
+typedef struct {
+    int sock;
+    struct sockaddr_in addr;
+    char roll[50];
+    char examCode[32];     // Exam named at login, empty for the default exam
+    char token[64];        // Session token from MSG_LOGIN_OK
+    ProtoReaderConn conn;  // Frames from the server, kept across questions of an adaptive paper
+    Question *questions;
+    int count;
+    char *arena;           // Every question and option text of the START paper, each NUL-terminated
+    int adaptiveLength;    // Most questions of an adaptive paper, 0 for a fixed one
+    char *later[PROTO_MAX_QUESTIONS]; // Texts of each adaptive question received after START
+    int finished;          // 1 once the server ended the adaptive paper
+    float ability, abilitySe; // Its estimate of the student's ability and the standard error
+} ExamSession;
+
 // Structure for storing a student's exam result
 typedef struct {
     char roll[MAX_LINE];
     char name[MAX_LINE];
-    int responseTimes[NUM_EXAM_QUESTIONS]; // Time taken for each answer
+    int responseTimes[PROTO_MAX_QUESTIONS]; // Time taken for each answer
     int totalTime;                         // Total time spent in exam
     int correctAnswers;                    // Number of correct answers
     int totalQuestions;                    // Number of attempted questions
@@ -92,28 +111,272 @@ int get_input_with_timeout(char *buf, int buf_size, int timeout_seconds) {
         if (fgets(buf, buf_size, stdin) == NULL) {
             return 0;
         }
+        if (strchr(buf, '\n') == NULL) clear_input_buffer(); // Discard the rest of an overlong line
         buf[strcspn(buf, "\n")] = '\0'; // Remove newline
         return 1;
     }
 }
 
-// Thread function: Waits for the overall exam time, then sets examTimeUp flag
-void *overall_timer(void *arg) {
-    sleep(overallExamTime); // Wait for the total exam duration
-    examTimeUp = 1;         // Signal that time is up
-    printf("\n⏰ *** Overall exam time is up! The exam will now end. ***\n");
-    pthread_exit(NULL);
+// Receives the next frame and checks it has the expected type; r is set to its body.
+// Reports server errors, protocol version mismatches and disconnects, and returns 0 in those cases.
+int recv_expected(ProtoReaderConn *conn, ProtoReader *r, int expected, const char *what) {
+    int type;
+    const unsigned char *body;
+    uint32_t len;
+    int rc = prc_next(conn, &type, &body, &len);
+    if (rc < 0) {
+        printf("📛 Error receiving %s: connection closed (%s)\n", what, strerror(errno));
+        return 0;
+    }
+    if (rc != PROTO_OK) {
+        printf("📛 Error receiving %s: %s. Please use a client that matches the server.\n",
+               what, proto_strerror(rc));
+        return 0;
+    }
+    pr_init(r, body, len);
+    if (type == MSG_LOGIN_QUEUED && expected == MSG_LOGIN_OK) {
+        // The server is pacing logins; the response follows once our turn comes
+        uint32_t position = pr_varint(r);
+        uint32_t seconds = pr_varint(r);
+        printf("⏳ Many students are logging in. You are number %u in line, about %u seconds...\n", position, seconds);
+        return recv_expected(conn, r, expected, what);
+    }
+    if (type != expected && (type == MSG_ERROR || type == MSG_LOGIN_FAIL)) {
+        char reason[MAX_LINE];
+        pr_str(r, reason, sizeof(reason));
+        printf("📛 %s\n", r->failed ? "Server reported an error" : reason);
+        return 0;
+    }
+    if (type != expected) {
+        printf("📛 Unexpected message type %d while waiting for %s\n", type, what);
+        return 0;
+    }
+    return 1;
+}
+
+// Sends one answer frame. Returns 0 if the connection is gone.
+int send_answer_frame(int sock, Question *q) {
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_ANSWER);
+    pb_put_varint(&frame, q->id);
+    pb_put_u8(&frame, (uint8_t)q->answer);
+    pb_put_varint(&frame, (uint32_t)q->answerMs);
+    proto_end(&frame, start);
+    int ok = !frame.failed && proto_send_all(sock, frame.data, frame.len);
+    pb_free(&frame);
+    return ok;
+}
+
+// Decodes one question as MSG_START, MSG_QUESTION and MSG_RESUME_OK carry it. Its texts are
+// copied into arena from offset *used; a text and its NUL never take more room than the text
+// and its length prefix did in the frame, so an arena the size of the body always fits.
+// Returns 0 if the body was too short.
+int read_question(ProtoReader *r, Question *q, char *arena, size_t size, size_t *used) {
+    q->id = (int)pr_varint(r);
+    for (int f = 0; f < 5; f++) {
+        pr_str(r, arena + *used, size - *used);
+        q->text[f] = arena + *used;
+        *used += strlen(arena + *used) + 1;
+    }
+    q->correct = (char)pr_u8(r);
+    q->difficulty = pr_u8(r);
+    if (r->failed) return 0;
+    if (q->text[0][0] == '\0' || !strchr("ABCD", q->correct) || q->correct == '\0' ||
+        q->difficulty < 1 || q->difficulty > 3) {
+        q->text[0] = ""; // Mark as invalid
+    }
+    return 1;
+}
+
+// Adds the next question of an adaptive paper, the first one left in r, with its own arena.
+// Returns 0 if it is malformed or the paper is full.
+int add_question(ExamSession *s, ProtoReader *r) {
+    if (s->count >= PROTO_MAX_QUESTIONS) return 0;
+    char *arena = malloc(r->len + 1);
+    size_t used = 0;
+    if (arena == NULL || !read_question(r, &s->questions[s->count], arena, r->len + 1, &used)) {
+        free(arena);
+        return 0;
+    }
+    s->later[s->count++] = arena;
+    return 1;
+}
+
+// Reconnects after the connection dropped and resumes the exam with the session token.
+// The server answers with the questions it has no answer for; answers already given here
+// that it never received are sent again. On an adaptive paper it may list a question sent
+// while the connection was down, which is added to the paper. Returns 0 if the session could
+// not be resumed.
+int resume_session(ExamSession *s) {
+    close(s->sock);
+    s->sock = -1;
+    prc_free(&s->conn);
+    for (int attempt = 1; attempt <= RESUME_ATTEMPTS; attempt++) {
+        printf("🔁 Connection lost, reconnecting (attempt %d of %d)...\n", attempt, RESUME_ATTEMPTS);
+        sleep(1);
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0) {
+            perror("📛 Error creating socket");
+            continue;
+        }
+        if (connect(sock, (struct sockaddr*)&s->addr, sizeof(s->addr)) < 0) {
+            perror("📛 Error connecting to server");
+            close(sock);
+            continue;
+        }
+
+        ProtoBuf frame;
+        pb_init(&frame);
+        size_t start = proto_begin(&frame, MSG_RESUME);
+        pb_put_str(&frame, s->roll);
+        pb_put_str(&frame, s->token);
+        pb_put_str(&frame, s->examCode);
+        proto_end(&frame, start);
+        int sent = !frame.failed && proto_send_all(sock, frame.data, frame.len);
+        pb_free(&frame);
+        if (!sent) {
+            perror("📛 Error sending resume request");
+            close(sock);
+            continue;
+        }
+
+        ProtoReader r;
+        prc_init(&s->conn, sock);
+        if (!recv_expected(&s->conn, &r, MSG_RESUME_OK, "resume response")) {
+            // The server refused the token or closed the exam, so retrying will not help
+            prc_free(&s->conn);
+            close(sock);
+            return 0;
+        }
+        pr_varint(&r);   // answerTimeout, unchanged
+        int secondsLeft = (int)pr_varint(&r);
+        pr_f32(&r);
+        pr_f32(&r);
+        int unanswered = (int)pr_varint(&r);
+        int resent = 0;
+        char *skip = malloc(r.len + 1);   // Any one question fits in the body it came in
+        if (skip == NULL) r.failed = 1;
+        for (int i = 0; i < unanswered && !r.failed; i++) {
+            ProtoReader at = r;
+            Question listed;
+            size_t used = 0;
+            if (!read_question(&r, &listed, skip, r.len + 1, &used)) break;
+            int known = 0;
+            for (int j = 0; j < s->count && !r.failed; j++) {
+                Question *q = &s->questions[j];
+                if (q->id != listed.id) continue;
+                known = 1;
+                if (!q->answered) continue;
+                if (!send_answer_frame(sock, q)) r.failed = 1;
+                resent++;
+            }
+            if (!known && s->adaptiveLength > 0 && !add_question(s, &at)) r.failed = 1;
+        }
+        free(skip);
+        if (r.failed) {
+            printf("📛 Malformed resume response\n");
+            prc_free(&s->conn);
+            close(sock);
+            continue;
+        }
+        s->sock = sock;
+        examDeadline = time(NULL) + secondsLeft;
+        printf("🔁 Exam resumed: %d question(s) left on the server, %d answer(s) re-sent, %d s remaining\n",
+               unanswered - resent, resent, secondsLeft);
+        return 1;
+    }
+    return 0;
+}
+
+// Streams one answer to the server as soon as it is given. option is 'A'-'D', or 0 when the
+// question timed out or the input was not a valid option. Returns 0 if the server is lost.
+int send_answer(ExamSession *s, Question *q, char option, long responseMs) {
+    q->answered = 1;
+    q->answer = option;
+    q->answerMs = responseMs;
+    if (send_answer_frame(s->sock, q)) return 1;
+    perror("📛 Error sending answer");
+    // Resuming re-sends this answer along with any others the server did not get
+    return resume_session(s);
 }
 
-// Conducts the exam: presents questions, collects answers, times responses, and computes results
-void conduct_exam(int sock, char *roll, char *name, Question *questions, int totalQuestions, int answerTimeout) {
+// Waits for the server's next move on an adaptive paper: the next question, chosen from the
+// answers so far, or the end of the paper with the estimated ability. A lost connection is
+// resumed, which may bring the next question along. Returns 1 if a question was added, 0 if
+// the paper is over, or -1 if the server is lost.
+int next_question(ExamSession *s) {
+    int have = s->count;
+    while (!s->finished && s->count == have) {
+        int type;
+        const unsigned char *body;
+        uint32_t len;
+        int rc = prc_next(&s->conn, &type, &body, &len);
+        if (rc < 0) {
+            if (!resume_session(s)) return -1;
+            continue;
+        }
+        if (rc != PROTO_OK) {
+            printf("📛 Error receiving the next question: %s\n", proto_strerror(rc));
+            return -1;
+        }
+        ProtoReader r;
+        pr_init(&r, body, len);
+        if (type == MSG_QUESTION) {
+            if (!add_question(s, &r)) {
+                printf("📛 Malformed question from the server\n");
+                return -1;
+            }
+        } else if (type == MSG_ADAPTIVE_DONE) {
+            s->ability = pr_f32(&r);
+            s->abilitySe = pr_f32(&r);
+            s->finished = 1;
+        } else if (type == MSG_ERROR) {
+            char reason[MAX_LINE];
+            pr_str(&r, reason, sizeof(reason));
+            printf("📛 %s\n", r.failed ? "Server reported an error" : reason);
+            return -1;
+        } else {
+            printf("📛 Unexpected message type %d while waiting for the next question\n", type);
+            return -1;
+        }
+    }
+    return s->count > have;
+}
+
+// Sends the final result frame. Returns 0 if it could not be sent.
+int send_result(int sock, ExamResult *result) {
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_RESULT);
+    pb_put_str(&frame, result->roll);
+    pb_put_str(&frame, result->name);
+    pb_put_varint(&frame, result->correctAnswers);
+    pb_put_varint(&frame, result->totalQuestions);
+    pb_put_varint(&frame, result->flagged);
+    pb_put_varint(&frame, result->totalTime);
+    pb_put_varint(&frame, result->totalQuestions);
+    for (int i = 0; i < result->totalQuestions; i++) {
+        pb_put_varint(&frame, result->responseTimes[i]);
+    }
+    proto_end(&frame, start);
+    int ok = !frame.failed && proto_send_all(sock, frame.data, frame.len);
+    pb_free(&frame);
+    return ok;
+}
+
+// Conducts the exam: presents questions, collects answers, times responses, and computes
+// results. An adaptive paper is extended one question at a time until the server ends it.
+void conduct_exam(ExamSession *session, char *name, int answerTimeout) {
+    Question *questions = session->questions;
     ExamResult result = {0}; // Initialize result structure
-    strcpy(result.roll, roll);
+    strcpy(result.roll, session->roll);
     strcpy(result.name, name);
 
     double weightedScore = 0.0; // Score with difficulty weights
     int wrongCount = 0, attempted = 0;
     int isCheating = 0;         // Flag for suspicious activity
+    int connected = 1;          // 0 once the server is lost and could not be resumed
     time_t questionStartTime;
     int totalAnswerTime = 0;
 
@@ -124,20 +387,16 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
     char* diffNames[] = {"", "⭐ Easy", "⭐⭐ Medium", "⭐⭐⭐ Hard"};
     float diffWeights[] = {0, 1.0, 1.5, 2.0}; // Scoring weights per difficulty
 
-    // Shuffle question indices for random order
-    int indices[totalQuestions];
-    for (int i = 0; i < totalQuestions; i++)
-        indices[i] = i;
-    srand(time(NULL));
-    for (int i = totalQuestions - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        int temp = indices[i];
-        indices[i] = indices[j];
-        indices[j] = temp;
-    }
+    // Questions are shown in paper order: the server already shuffled the questions and their
+    // options for this student, from a seed it can regenerate them from for an audit
 
     // Exam instructions
-    printf("\n📝 Exam starting now. You will be shown %d questions.\n", totalQuestions);
+    if (session->adaptiveLength > 0) {
+        printf("\n📝 Exam starting now. You will be shown up to %d questions, each chosen from your answers so far.\n",
+               session->adaptiveLength);
+    } else {
+        printf("\n📝 Exam starting now. You will be shown %d questions.\n", session->count);
+    }
     printf("⏱️  You have %d seconds per question.\n", answerTimeout);
     printf("⏳ Overall exam time: %d seconds.\n", overallExamTime);
     printf("💡 Question weights: Easy(x%.1f) Medium(x%.1f) Hard(x%.1f)\n",
@@ -145,16 +404,28 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
     printf("🚪 Enter 'e' at any time to exit the exam.\n\n");
 
     char answerBuf[20];
-    for (int i = 0; i < totalQuestions; i++) {
-        if (examTimeUp) {
-            printf("\n⏰ Overall exam time has expired.\n");
+    for (int i = 0; ; i++) {
+        if (i == session->count) {
+            if (session->adaptiveLength == 0) break;
+            int more = next_question(session);
+            if (more < 0) connected = 0;
+            if (more <= 0) break;
+        }
+        int remaining = (int)(examDeadline - time(NULL));
+        if (remaining <= 0) {
+            printf("\n⏰ *** Overall exam time is up! The exam will now end. ***\n");
             break;
         }
 
-        Question *q = &questions[indices[i]];
+        Question *q = &questions[i];
         // Validate question data
-        if (q->question[0] == '\0' || q->difficulty < 1 || q->difficulty > 3) {
+        if (q->text[0][0] == '\0' || q->difficulty < 1 || q->difficulty > 3) {
             printf("📛 Invalid question %d, skipping\n", i+1);
+            // The server chooses the next adaptive question only once this one is answered
+            if (session->adaptiveLength > 0 && !send_answer(session, q, 0, 0)) {
+                connected = 0;
+                break;
+            }
             wrongCount++;
             attempted++;
             continue;
@@ -164,11 +435,11 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
         printf("\n--------------------------------------------------\n");
         printf("| 🔹 Q%-38d | %-12s |\n", i+1, diffNames[q->difficulty]);
         printf("--------------------------------------------------\n");
-        printf("| %-47s |\n", q->question);
-        printf("| 🅰️  %-45s |\n", q->optionA);
-        printf("| 🅱️  %-45s |\n", q->optionB);
-        printf("| ©️  %-45s |\n", q->optionC);
-        printf("| 🅳  %-45s |\n", q->optionD);
+        printf("| %-47s |\n", q->text[0]);
+        printf("| 🅰️  %-45s |\n", q->text[1]);
+        printf("| 🅱️  %-45s |\n", q->text[2]);
+        printf("| ©️  %-45s |\n", q->text[3]);
+        printf("| 🅳  %-45s |\n", q->text[4]);
         printf("--------------------------------------------------\n");
 
         printf("💭 Your answer (A/B/C/D or 'e' to exit): ");
@@ -176,17 +447,24 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
 
         // Start timer for this question
         questionStartTime = time(NULL);
-        int gotInput = get_input_with_timeout(answerBuf, sizeof(answerBuf), answerTimeout);
+        struct timespec shownAt, answeredAt;
+        clock_gettime(CLOCK_MONOTONIC, &shownAt);
+        int gotInput = get_input_with_timeout(answerBuf, sizeof(answerBuf),
+                                              remaining < answerTimeout ? remaining : answerTimeout);
+        clock_gettime(CLOCK_MONOTONIC, &answeredAt);
+        long answerMs = (answeredAt.tv_sec - shownAt.tv_sec) * 1000L + (answeredAt.tv_nsec - shownAt.tv_nsec) / 1000000L;
         int answerTime = time(NULL) - questionStartTime;
         totalAnswerTime += answerTime;
         timeByDifficulty[q->difficulty] += answerTime;
         result.responseTimes[i] = answerTime;
 
-        clear_input_buffer();
-
         if (!gotInput) {
             // No answer provided in time
             printf("\n⏰ Time's up for this question! No answer provided.\n");
+            if (!send_answer(session, q, 0, answerMs)) {
+                connected = 0;
+                break;
+            }
             wrongCount++;
             attempted++;
             attemptedByDifficulty[q->difficulty]++;
@@ -204,6 +482,10 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
         if (strchr("ABCD", userAns) == NULL) {
             // Invalid answer format
             printf("\n📛 Invalid answer! Treated as wrong.\n");
+            if (!send_answer(session, q, 0, answerMs)) {
+                connected = 0;
+                break;
+            }
             wrongCount++;
             attempted++;
             attemptedByDifficulty[q->difficulty]++;
@@ -212,6 +494,10 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
 
         attempted++;
         attemptedByDifficulty[q->difficulty]++;
+        if (!send_answer(session, q, userAns, answerMs)) {
+            connected = 0;
+            break;
+        }
 
         // Flag suspiciously fast answers
         if (answerTime < MIN_ANSWER_TIME) {
@@ -245,7 +531,11 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
     printf("*                         📊 DETAILED RESULTS                        *\n");
     printf("***********************************************************************\n");
     printf("| %-25s: %10.2f (Max: %.1f)                   |\n", "🎯 Weighted Score", weightedScore,
-          totalQuestions * diffWeights[3]);
+          session->count * diffWeights[3]);
+    if (session->finished) {
+        printf("| %-25s: %10.2f (± %.2f)                      |\n", "🧭 Estimated Ability", session->ability,
+               session->abilitySe);
+    }
     printf("| %-25s: %10.2f%%                                   |\n", "📈 Overall Accuracy", accuracy);
 
     printf("\n--------------------------------------------------------\n");
@@ -276,11 +566,14 @@ void conduct_exam(int sock, char *roll, char *name, Question *questions, int tot
     result.totalTime = totalAnswerTime;
     result.flagged = isCheating;
 
-    // Send result to server
-    if (send(sock, &result, sizeof(ExamResult), 0) < 0) {
-        perror("📛 Error sending exam result");
-    } else {
+    // Send result to server, resuming once if the connection dropped since the last answer
+    if (!connected) {
+        printf("📛 Lost the connection to the server. Your answers so far were recorded and will be scored.\n");
+    } else if (send_result(session->sock, &result) ||
+               (resume_session(session) && send_result(session->sock, &result))) {
         printf("📤 Sent exam result to server\n");
+    } else {
+        perror("📛 Error sending exam result");
     }
 }
 
@@ -310,46 +603,56 @@ int main() {
 
     // Student login
     char roll[50], password[50], name[MAX_LINE], reg_no[MAX_LINE];
+    ExamSession session = {0};
     printf("\n🎓 Welcome to ExamSys Online MCQ Exam Platform\n");
     printf("📝 Enter Roll No: ");
     scanf("%s", roll);
     printf("🔒 Enter Password: ");
     clear_input_buffer();
     getPassword(password, sizeof(password));
+    printf("🏫 Enter Exam Code (press Enter for the default exam): ");
+    if (fgets(session.examCode, sizeof(session.examCode), stdin) == NULL) session.examCode[0] = '\0';
+    session.examCode[strcspn(session.examCode, "\r\n")] = '\0';
 
     // Send login credentials to server
-    char login_buf[MAX_LINE];
-    snprintf(login_buf, MAX_LINE, "%s|%s", roll, password);
-    if (send(sock, login_buf, strlen(login_buf) + 1, 0) < 0) {
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_LOGIN);
+    pb_put_str(&frame, roll);
+    pb_put_str(&frame, password);
+    pb_put_str(&frame, session.examCode);
+    proto_end(&frame, start);
+    if (frame.failed || !proto_send_all(sock, frame.data, frame.len)) {
         perror("📛 Error sending login data");
         close(sock);
         exit(EXIT_FAILURE);
     }
-    printf("📤 Sent login data: %s\n", login_buf);
+    printf("📤 Sent login data for roll %s\n", roll);
+    pb_free(&frame);
 
     // Receive login response from server
-    char response[MAX_LINE];
-    int n = recv(sock, response, MAX_LINE, 0);
-    if (n <= 0) {
-        printf("📛 Error receiving login response: %s\n", strerror(errno));
+    ProtoReaderConn conn;
+    ProtoReader r;
+    prc_init(&conn, sock);
+    if (!recv_expected(&conn, &r, MSG_LOGIN_OK, "login response")) {
+        printf("📛 Login failed! Exiting.\n");
         close(sock);
         exit(EXIT_FAILURE);
     }
-    response[n] = '\0';
-    printf("📥 Received login response: %s\n", response);
 
-    if (strcmp(response, "INVALID") == 0) {
-        printf("📛 Invalid credentials! Exiting.\n");
+    // Parse name, registration number and session token from server response
+    pr_str(&r, name, sizeof(name));
+    pr_str(&r, reg_no, sizeof(reg_no));
+    pr_str(&r, session.token, sizeof(session.token));
+    if (r.failed) {
+        printf("📛 Malformed login response\n");
         close(sock);
         exit(EXIT_FAILURE);
     }
-
-    // Parse name and registration number from server response
-    sscanf(response, "%[^|]|%s", name, reg_no);
+    printf("📥 Received login response: %s|%s\n", name, reg_no);
     printf("\n🎉 Login successful. Welcome, %s!\n", name);
 
     // Wait for instructor to start the exam
-    char ready_signal[MAX_LINE];
     printf("\n⏳ Waiting for instructor to start the exam...\n");
 
     struct timeval timeout;
@@ -359,65 +662,47 @@ int main() {
     timeout.tv_sec = 300; // Wait up to 5 minutes
     timeout.tv_usec = 0;
 
-    if (select(sock + 1, &readfds, NULL, NULL, &timeout) <= 0) {
+    // START may already be buffered if it arrived together with the login response
+    if (conn.end == conn.start && select(sock + 1, &readfds, NULL, NULL, &timeout) <= 0) {
         printf("📛 Timeout or error waiting for start signal: %s\n", strerror(errno));
         close(sock);
         exit(EXIT_FAILURE);
     }
 
-    n = recv(sock, ready_signal, MAX_LINE - 1, 0);
-    if (n <= 0) {
-        printf("📛 Error receiving start signal: %s\n", strerror(errno));
+    // The START frame carries the exam configuration and the whole paper
+    if (!recv_expected(&conn, &r, MSG_START, "start signal")) {
         close(sock);
         exit(EXIT_FAILURE);
     }
-    ready_signal[n] = '\0';
-    printf("📥 Received signal: %s\n", ready_signal);
-
-    if (strcmp(ready_signal, "START") != 0) {
-        printf("📛 Invalid signal received: %s\n", ready_signal);
+    printf("📥 Received signal: START\n");
+
+    int answerTimeout = (int)pr_varint(&r);
+    int examDuration = (int)pr_varint(&r);
+    float marksForCorrectAnswer = pr_f32(&r);
+    float marksDeductedForWrongAnswer = pr_f32(&r);
+    int adaptiveLength = (int)pr_varint(&r);
+    int num_questions = (int)pr_varint(&r);
+    if (r.failed || adaptiveLength < 0 || adaptiveLength > PROTO_MAX_QUESTIONS) {
+        printf("📛 Malformed exam configuration\n");
         close(sock);
         exit(EXIT_FAILURE);
     }
 
-    // Receive exam configuration from server
-    int answerTimeout;
-    float marksForCorrectAnswer, marksDeductedForWrongAnswer;
-    int num_questions;
-
-    n = recv(sock, &answerTimeout, sizeof(int), 0);
-    if (n != sizeof(int)) {
-        printf("📛 Error receiving answerTimeout: %s (received %d bytes, expected %zu)\n",
-               strerror(errno), n, sizeof(int));
-        close(sock);
-        exit(EXIT_FAILURE);
-    }
     if (answerTimeout <= 0 || answerTimeout > 3600) {
         printf("📛 Invalid answerTimeout received: %d, using default: 30\n", answerTimeout);
         answerTimeout = 30;
     }
     printf("📥 Received answerTimeout: %d\n", answerTimeout);
 
-    n = recv(sock, &marksForCorrectAnswer, sizeof(float), 0);
-    if (n != sizeof(float)) {
-        printf("📛 Error receiving marksForCorrectAnswer: %s (received %d bytes, expected %zu)\n",
-               strerror(errno), n, sizeof(float));
-        close(sock);
-        exit(EXIT_FAILURE);
-    }
+    if (examDuration > 0) overallExamTime = examDuration;
+    printf("📥 Received exam duration: %d\n", overallExamTime);
+
     if (marksForCorrectAnswer <= 0 || marksForCorrectAnswer > 100) {
         printf("📛 Invalid marksForCorrectAnswer received: %.2f, using default: 1.0\n", marksForCorrectAnswer);
         marksForCorrectAnswer = 1.0;
     }
     printf("📥 Received marksForCorrectAnswer: %.2f\n", marksForCorrectAnswer);
 
-    n = recv(sock, &marksDeductedForWrongAnswer, sizeof(float), 0);
-    if (n != sizeof(float)) {
-        printf("📛 Error receiving marksDeductedForWrongAnswer: %s (received %d bytes, expected %zu)\n",
-               strerror(errno), n, sizeof(float));
-        close(sock);
-        exit(EXIT_FAILURE);
-    }
     if (marksDeductedForWrongAnswer < 0 || marksDeductedForWrongAnswer > 100) {
         printf("📛 Invalid marksDeductedForWrongAnswer received: %.2f, using default: 0.25\n",
                marksDeductedForWrongAnswer);
@@ -425,49 +710,37 @@ int main() {
     }
     printf("📥 Received marksDeductedForWrongAnswer: %.2f\n", marksDeductedForWrongAnswer);
 
-    n = recv(sock, &num_questions, sizeof(int), 0);
-    if (n != sizeof(int)) {
-        printf("📛 Error receiving num_questions: %s (received %d bytes, expected %zu)\n",
-               strerror(errno), n, sizeof(int));
+    if (num_questions <= 0 || num_questions > NUM_EXAM_QUESTIONS) {
+        printf("📛 Invalid num_questions received: %d\n", num_questions);
         close(sock);
         exit(EXIT_FAILURE);
     }
-    if (num_questions <= 0 || num_questions > NUM_EXAM_QUESTIONS) {
-        printf("📛 Invalid num_questions received: %d, using default: %d\n", num_questions, NUM_EXAM_QUESTIONS);
-        num_questions = NUM_EXAM_QUESTIONS;
-    }
     printf("📥 Received num_questions: %d\n", num_questions);
+    if (adaptiveLength > 0) printf("📥 Received adaptive paper of up to %d questions\n", adaptiveLength);
 
-    // Allocate memory for questions and receive them from server
-    Question *questions = malloc(num_questions * sizeof(Question));
-    if (!questions) {
+    // Decode the questions from the START frame into one arena the size of the frame body.
+    // An adaptive paper has room for the questions still to come.
+    Question *questions = calloc(adaptiveLength > 0 ? PROTO_MAX_QUESTIONS : num_questions, sizeof(Question));
+    char *arena = malloc(r.len + 1);
+    if (!questions || !arena) {
         printf("📛 Error allocating memory for questions\n");
         close(sock);
         exit(EXIT_FAILURE);
     }
 
+    size_t used = 0;
     for (int i = 0; i < num_questions; i++) {
-        n = recv(sock, &questions[i], sizeof(Question), 0);
-        if (n != sizeof(Question)) {
-            printf("📛 Error receiving question %d: %s (received %d bytes, expected %zu)\n",
-                   i+1, strerror(errno), n, sizeof(Question));
+        if (!read_question(&r, &questions[i], arena, r.len + 1, &used)) {
+            printf("📛 Truncated exam data at question %d\n", i+1);
             free(questions);
+            free(arena);
             close(sock);
             exit(EXIT_FAILURE);
         }
-        // Validate question data
-        questions[i].question[MAX_LINE-1] = '\0';
-        questions[i].optionA[MAX_LINE-1] = '\0';
-        questions[i].optionB[MAX_LINE-1] = '\0';
-        questions[i].optionC[MAX_LINE-1] = '\0';
-        questions[i].optionD[MAX_LINE-1] = '\0';
-        if (questions[i].question[0] == '\0' ||
-            !strchr("ABCD", questions[i].correct) ||
-            questions[i].difficulty < 1 || questions[i].difficulty > 3) {
+        if (questions[i].text[0][0] == '\0') {
             printf("📛 Invalid question %d data, will skip\n", i+1);
-            questions[i].question[0] = '\0'; // Mark as invalid
         } else {
-            printf("📥 Received question %d: %s\n", i+1, questions[i].question);
+            printf("📥 Received question %d: %s\n", i+1, questions[i].text[0]);
         }
     }
 
@@ -475,28 +748,32 @@ int main() {
     printf("\n====================================================\n");
     printf("| 📜          RULES FOR THE EXAM                 |\n");
     printf("====================================================\n");
-    printf("| 🔹 Number of questions: %-22d |\n", num_questions);
+    if (adaptiveLength > 0) printf("| 🔹 Number of questions: up to %-16d |\n", adaptiveLength);
+    else printf("| 🔹 Number of questions: %-22d |\n", num_questions);
     printf("| ⏱️  Time per question: %-3d seconds                  |\n", answerTimeout);
     printf("| ➕ Marks for correct answer: %-4.2f                   |\n", marksForCorrectAnswer);
     printf("| ➖ Marks deducted for wrong answer: %-4.2f            |\n", marksDeductedForWrongAnswer);
     printf("====================================================\n");
 
-    // Start overall exam timer in a separate thread
-    pthread_t overallTimerThread;
-    if (pthread_create(&overallTimerThread, NULL, overall_timer, NULL) != 0) {
-        perror("📛 Error creating overall timer thread");
-        free(questions);
-        close(sock);
-        exit(EXIT_FAILURE);
-    }
+    // The server enforces the same deadline and closes the exam out when it passes
+    examDeadline = time(NULL) + overallExamTime;
 
     // Conduct the exam
-    conduct_exam(sock, roll, name, questions, num_questions, answerTimeout);
-
-    // Wait for timer thread to finish (if not already)
-    pthread_join(overallTimerThread, NULL);
+    session.sock = sock;
+    session.addr = server_addr;
+    snprintf(session.roll, sizeof(session.roll), "%s", roll);
+    session.conn = conn;   // Frames after START, such as adaptive questions, are read through it
+    session.questions = questions;
+    session.count = num_questions;
+    session.arena = arena;
+    session.adaptiveLength = adaptiveLength;
+    conduct_exam(&session, name, answerTimeout);
+
+    prc_free(&session.conn);
+    for (int i = 0; i < session.count; i++) free(session.later[i]);
     free(questions);
-    close(sock);
+    free(arena);
+    if (session.sock >= 0) close(session.sock);
 
     printf("\n✨ Thank you for using ExamSys! Goodbye! ✨\n");
     return 0;
@@ -0,0 +1,284 @@
+// ExamSys item response theory: the two-parameter logistic (2PL) model behind adaptive papers.
+//
+// A student of ability theta answers question i correctly with probability
+//   P = 1 / (1 + exp(-a_i (theta - b_i)))
+// where b_i is how hard the question is and a_i how sharply it tells abilities apart. Abilities
+// live on a fixed grid of IRT_GRID points, so updating an estimate after an answer costs the
+// same however many answers came before, and the questions worth asking at each point are
+// ranked once per bank version instead of once per student.
+#ifndef EXAMSYS_IRT_H
+#define EXAMSYS_IRT_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prng.h"
+
+#define IRT_GRID 41                 // Ability points from IRT_THETA_MIN to -IRT_THETA_MIN
+#define IRT_THETA_MIN -4.0
+#define IRT_THETA_STEP 0.2
+#define IRT_TOP 64                  // Most informative questions listed per grid point
+#define IRT_EXPOSURE 4              // The next question is drawn from this many best unused ones
+#define IRT_ROUNDS 4                // Calibration rounds, each refitting questions then students
+#define IRT_A_MIN 0.2               // Bounds keeping a sparse calibration sensible
+#define IRT_A_MAX 4.0
+#define IRT_B_MAX 4.0
+
+// Parameters of one question
+typedef struct {
+    float a;                        // Discrimination
+    float b;                        // Difficulty on the ability scale
+} IrtItem;
+
+// One past answer, as calibration reads it
+typedef struct {
+    uint32_t person;                // Index of the student who gave it
+    uint32_t item;                  // Question id
+    uint8_t correct;
+} IrtResponse;
+
+// Parameters and information tables of one bank version
+typedef struct {
+    uint32_t count;                 // Questions
+    IrtItem *items;                 // Parameters by question id
+    uint32_t perPoint;              // Ids listed per grid point: IRT_TOP, or count if smaller
+    uint32_t *best;                 // IRT_GRID rows of perPoint ids, most informative first
+} IrtTable;
+
+// Ability estimate of one student: the posterior over the grid, with its mean and spread
+typedef struct {
+    double post[IRT_GRID];
+    double theta;                   // Expected a posteriori ability
+    double se;                      // Its standard error
+} IrtAbility;
+
+static inline double irt_theta(int g) {
+    return IRT_THETA_MIN + g * IRT_THETA_STEP;
+}
+
+// Probability that a student of ability theta answers item correctly.
+static inline double irt_p(const IrtItem *item, double theta) {
+    return 1.0 / (1.0 + exp(-item->a * (theta - item->b)));
+}
+
+// Fisher information of item at theta: how much an answer to it narrows the estimate there.
+static inline double irt_info(const IrtItem *item, double theta) {
+    double p = irt_p(item, theta);
+    return item->a * item->a * p * (1.0 - p);
+}
+
+// Recomputes the mean and standard error of a normalized posterior.
+static inline void irt_ability_moments(IrtAbility *ab) {
+    double mean = 0, sq = 0;
+    for (int g = 0; g < IRT_GRID; g++) {
+        mean += ab->post[g] * irt_theta(g);
+        sq += ab->post[g] * irt_theta(g) * irt_theta(g);
+    }
+    ab->theta = mean;
+    ab->se = sqrt(sq - mean * mean > 0 ? sq - mean * mean : 0);
+}
+
+// Starts an estimate from the standard normal prior of the ability scale.
+static inline void irt_ability_init(IrtAbility *ab) {
+    double sum = 0;
+    for (int g = 0; g < IRT_GRID; g++) {
+        ab->post[g] = exp(-0.5 * irt_theta(g) * irt_theta(g));
+        sum += ab->post[g];
+    }
+    for (int g = 0; g < IRT_GRID; g++) ab->post[g] /= sum;
+    irt_ability_moments(ab);
+}
+
+// Folds one answer into an estimate: the posterior is multiplied by the answer's likelihood
+// at every grid point and normalized again. Costs O(IRT_GRID) whatever came before.
+static inline void irt_ability_update(IrtAbility *ab, const IrtItem *item, int correct) {
+    double sum = 0;
+    for (int g = 0; g < IRT_GRID; g++) {
+        double p = irt_p(item, irt_theta(g));
+        ab->post[g] *= correct ? p : 1.0 - p;
+        sum += ab->post[g];
+    }
+    // Answers the model calls impossible would empty the posterior; keep the last one instead
+    if (sum < 1e-300) return;
+    for (int g = 0; g < IRT_GRID; g++) ab->post[g] /= sum;
+    irt_ability_moments(ab);
+}
+
+// Grid point nearest to an ability.
+static inline int irt_point(double theta) {
+    int g = (int)floor((theta - IRT_THETA_MIN) / IRT_THETA_STEP + 0.5);
+    return g < 0 ? 0 : g >= IRT_GRID ? IRT_GRID - 1 : g;
+}
+
+// Builds the information tables of t, whose items and count are set: for every grid point,
+// the ids of the perPoint most informative questions there, best first, found with a
+// min-heap per point. Questions that are equally informative, such as uncalibrated ones of
+// the same difficulty, are ordered by a hash of salt, so each bank version lists a different
+// share of them rather than always the first ones in the file. Returns 0 if memory ran out.
+static inline int irt_table_build(IrtTable *t, uint64_t salt) {
+    t->perPoint = t->count < IRT_TOP ? t->count : IRT_TOP;
+    t->best = malloc(sizeof(uint32_t) * IRT_GRID * (t->perPoint ? t->perPoint : 1));
+    if (t->best == NULL) return 0;
+    uint32_t k = t->perPoint;
+    double info[IRT_TOP];
+    for (int g = 0; g < IRT_GRID; g++) {
+        uint32_t *row = t->best + (size_t)g * k;
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < t->count; i++) {
+            uint64_t x = salt + i;
+            double v = irt_info(&t->items[i], irt_theta(g)) * (1.0 + (prng_splitmix(&x) >> 11) * 0x1.0p-53 * 1e-6);
+            uint32_t at;
+            if (n < k) {
+                at = n++;
+                // Sift up: the least informative of the kept ones stays at the root
+                while (at > 0 && info[(at - 1) / 2] > v) {
+                    info[at] = info[(at - 1) / 2];
+                    row[at] = row[(at - 1) / 2];
+                    at = (at - 1) / 2;
+                }
+            } else if (v > info[0]) {
+                // Replace the root and sift down
+                at = 0;
+                while (1) {
+                    uint32_t c = 2 * at + 1;
+                    if (c >= k) break;
+                    if (c + 1 < k && info[c + 1] < info[c]) c++;
+                    if (info[c] >= v) break;
+                    info[at] = info[c];
+                    row[at] = row[c];
+                    at = c;
+                }
+            } else {
+                continue;
+            }
+            info[at] = v;
+            row[at] = i;
+        }
+        // Heap to best-first order: repeatedly move the least informative to the end
+        for (uint32_t end = n; end > 1; end--) {
+            double v = info[end - 1];
+            uint32_t id = row[end - 1];
+            info[end - 1] = info[0];
+            row[end - 1] = row[0];
+            uint32_t at = 0;
+            while (1) {
+                uint32_t c = 2 * at + 1;
+                if (c >= end - 1) break;
+                if (c + 1 < end - 1 && info[c + 1] < info[c]) c++;
+                if (info[c] >= v) break;
+                info[at] = info[c];
+                row[at] = row[c];
+                at = c;
+            }
+            info[at] = v;
+            row[at] = id;
+        }
+    }
+    return 1;
+}
+
+static inline void irt_table_free(IrtTable *t) {
+    if (t == NULL) return;
+    free(t->items);
+    free(t->best);
+    free(t);
+}
+
+// Picks the next question for a student of ability theta who has had the n questions in
+// used: one of the IRT_EXPOSURE most informative unused ones at the nearest grid point, at
+// random, so the best question is not given to every student of the same ability.
+// Returns -1 if every listed question was used.
+static inline int irt_select(const IrtTable *t, double theta, const int *used, int n, Prng *rng) {
+    const uint32_t *row = t->best + (size_t)irt_point(theta) * t->perPoint;
+    uint32_t candidates[IRT_EXPOSURE];
+    int found = 0;
+    for (uint32_t i = 0; i < t->perPoint && found < IRT_EXPOSURE; i++) {
+        int seen = 0;
+        for (int j = 0; j < n && !seen; j++) seen = used[j] == (int)row[i];
+        if (!seen) candidates[found++] = row[i];
+    }
+    if (found == 0) return -1;
+    return (int)candidates[prng_below(rng, found)];
+}
+
+// Calibrates items from past answers by joint maximum a posteriori estimation. On entry
+// items holds each question's prior (its a and b); on return its estimate. Students'
+// abilities start from the logit of their share of correct answers; each round then
+// refits every question with a Newton step on (a, -a*b) against the current abilities, and
+// every ability with a Newton step against the new questions. Priors of N(a0, 0.5) and
+// N(-a0*b0, 1) on the question side and N(0, 1) on the student side keep questions and
+// students with few answers near where they started. Returns 0 if memory ran out.
+static inline int irt_calibrate(IrtItem *items, uint32_t count, const IrtResponse *r, size_t n, uint32_t persons) {
+    double *theta = calloc(persons ? persons : 1, sizeof(double));
+    double *acc = calloc((size_t)(count > persons ? count : persons) * 5 + 1, sizeof(double));
+    IrtItem *prior = malloc(sizeof(IrtItem) * (count ? count : 1));
+    if (theta == NULL || acc == NULL || prior == NULL) {
+        free(theta);
+        free(acc);
+        free(prior);
+        return 0;
+    }
+    memcpy(prior, items, sizeof(IrtItem) * count);
+    // Starting abilities: acc holds answers and correct answers per person
+    for (size_t k = 0; k < n; k++) {
+        acc[2 * r[k].person] += 1;
+        acc[2 * r[k].person + 1] += r[k].correct;
+    }
+    for (uint32_t p = 0; p < persons; p++) {
+        double share = (acc[2 * p + 1] + 0.5) / (acc[2 * p] + 1.0);
+        theta[p] = log(share / (1.0 - share));
+    }
+
+    for (int round = 0; round < IRT_ROUNDS; round++) {
+        // Questions: gradient (ga, gc) and Hessian (haa, hac, hcc) of the log posterior in
+        // slope a and intercept c = -a*b
+        memset(acc, 0, sizeof(double) * 5 * count);
+        for (size_t k = 0; k < n; k++) {
+            const IrtItem *it = &items[r[k].item];
+            double t = theta[r[k].person];
+            double p = irt_p(it, t), w = p * (1.0 - p), e = r[k].correct - p;
+            double *s = acc + 5 * (size_t)r[k].item;
+            s[0] += e * t;
+            s[1] += e;
+            s[2] -= w * t * t;
+            s[3] -= w * t;
+            s[4] -= w;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            double *s = acc + 5 * (size_t)i;
+            double a = items[i].a, c = -items[i].a * items[i].b;
+            double a0 = prior[i].a, c0 = -prior[i].a * prior[i].b;
+            double ga = s[0] - (a - a0) / 0.25, gc = s[1] - (c - c0);
+            double haa = s[2] - 1 / 0.25, hac = s[3], hcc = s[4] - 1;
+            double det = haa * hcc - hac * hac;
+            if (det <= 0) continue;
+            a -= (hcc * ga - hac * gc) / det;
+            c -= (haa * gc - hac * ga) / det;
+            a = a < IRT_A_MIN ? IRT_A_MIN : a > IRT_A_MAX ? IRT_A_MAX : a;
+            double b = -c / a;
+            items[i].a = (float)a;
+            items[i].b = (float)(b < -IRT_B_MAX ? -IRT_B_MAX : b > IRT_B_MAX ? IRT_B_MAX : b);
+        }
+
+        // Students: gradient and Hessian of each ability's log posterior
+        memset(acc, 0, sizeof(double) * 2 * persons);
+        for (size_t k = 0; k < n; k++) {
+            const IrtItem *it = &items[r[k].item];
+            double p = irt_p(it, theta[r[k].person]);
+            acc[2 * r[k].person] += it->a * (r[k].correct - p);
+            acc[2 * r[k].person + 1] -= it->a * it->a * p * (1.0 - p);
+        }
+        for (uint32_t p = 0; p < persons; p++) {
+            double g = acc[2 * p] - theta[p], h = acc[2 * p + 1] - 1;
+            double t = theta[p] - g / h;
+            theta[p] = t < IRT_THETA_MIN ? IRT_THETA_MIN : t > -IRT_THETA_MIN ? -IRT_THETA_MIN : t;
+        }
+    }
+    free(theta);
+    free(acc);
+    free(prior);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,871 @@
+// ExamSys load generator: simulates many students sitting an exam against server.c, with
+// no terminals or typing, and reports how long each stage took as percentiles.
+//
+// Each thread drives its share of students from one epoll loop. A student connects, logs
+// in, waits for START, answers every question after a think time drawn from the chosen
+// distribution, and sends its result; some students drop mid-exam and resume with their
+// session token. On an adaptive paper each student answers from an ability of their own and
+// waits for the next question after each answer. Students are S<n> with password pw<n>
+// unless -R / -P say otherwise.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+
+#define SERVER_IP "127.0.0.1"
+#define SERVER_PORT 8080
+#define MAX_THREADS 64
+#define EPOLL_BATCH 256
+
+// Where a simulated student is in its exam
+enum {
+    ST_IDLE,        // Waiting for its ramp-up slot
+    ST_CONNECTING,  // Non-blocking connect in progress
+    ST_LOGIN,       // MSG_LOGIN or MSG_RESUME sent
+    ST_WAITING,     // Logged in, waiting for START
+    ST_THINKING,    // Exam running, next answer due at a timer
+    ST_NEXT,        // Adaptive paper: answer sent, waiting for the next question or the end
+    ST_RESULT,      // Result sent, waiting for the server to close
+    ST_DROPPED,     // Connection dropped on purpose, reconnecting at a timer
+    ST_DONE,        // Result accepted
+    ST_FAILED       // Gave up; see failReason
+};
+
+// Think-time distributions
+enum { THINK_FIXED, THINK_UNIFORM, THINK_EXP };
+
+// One simulated student
+typedef struct {
+    int id;                     // Student number, used for the roll and password
+    int fd;
+    int state;
+    int resuming;               // 1 while reconnecting with the session token
+    char roll[50];
+    char password[50];
+    char name[50];
+    char token[80];
+    unsigned char *in;          // Bytes received but not yet parsed
+    size_t inLen, inCap;
+    ProtoBuf out;               // Bytes still to send
+    size_t outOff;
+    int wantWrite;              // 1 while epoll also watches for writability
+    int count;                  // Questions still to answer, in paper order
+    int qids[PROTO_MAX_QUESTIONS];
+    char correct[PROTO_MAX_QUESTIONS];
+    unsigned char difficulty[PROTO_MAX_QUESTIONS];
+    int next;                   // Next question to answer
+    int total;                  // Questions on the paper; on an adaptive one, received so far
+    int adaptive;               // Most questions of an adaptive paper, 0 for a fixed one
+    int finished;               // 1 once the server ended the adaptive paper
+    double ability;             // Adaptive papers: chance of a right answer is logistic(ability - difficulty)
+    char right[PROTO_MAX_QUESTIONS];    // 1 if the answer given in that paper slot was correct
+    int responseTimes[PROTO_MAX_QUESTIONS];
+    int nextUs[PROTO_MAX_QUESTIONS]; // Adaptive papers: answer sent until the next question arrived
+    int nextCount;
+    int queuePosition;          // Place in the server's login queue, 0 if admitted at once
+    int dropAfter;              // Drop after this many answers, or -1
+    unsigned int seed;          // rand_r state, so students are reproducible per thread
+    long long due;              // When the timer fires (us), or -1
+    int heapPos;                // Index in the thread's timer heap, or -1
+    const char *failReason;
+    // Timestamps in microseconds on the monotonic clock, 0 when not reached
+    long long connectAt, loginOkAt, startFirstByte, startDone, askedAt, resumeAt, resumedAt,
+              resultSentAt, closedAt;
+} Student;
+
+// A thread driving a slice of the students
+typedef struct {
+    int id;
+    pthread_t thread;
+    int epfd;
+    Student *students;
+    int count;
+    int active;                 // Students not yet done or failed
+    Student **heap;             // Min-heap on due time
+    int heapLen;
+} Driver;
+
+// Command line settings
+struct {
+    const char *host;
+    int port;
+    int students;
+    int firstId;
+    int threads;
+    const char *examCode;
+    const char *rollFormat;
+    const char *passFormat;
+    int thinkDist;
+    double thinkMeanMs;
+    double accuracy;
+    double dropRate;
+    int reconnectMs;
+    double rampPerSec;
+    int timeoutSec;
+} opt = { SERVER_IP, SERVER_PORT, 100, 0, 0, "", "S%d", "pw%d", THINK_EXP, 1000.0, 0.7, 0.0, 500, 0.0, 600 };
+
+struct sockaddr_in serverAddr;
+long long runStarted;
+atomic_int activeTotal;
+
+// Current time on the monotonic clock in microseconds.
+long long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Uniform random number in [0, 1).
+double uniform01(Student *s) {
+    return rand_r(&s->seed) / ((double)RAND_MAX + 1.0);
+}
+
+// Draws a think time in milliseconds from the configured distribution.
+long think_ms(Student *s) {
+    switch (opt.thinkDist) {
+        case THINK_FIXED:
+            return (long)opt.thinkMeanMs;
+        case THINK_UNIFORM:
+            return (long)(uniform01(s) * 2.0 * opt.thinkMeanMs);
+        default:
+            return (long)(-log(1.0 - uniform01(s)) * opt.thinkMeanMs);
+    }
+}
+
+// Timer heap: swaps two entries and keeps their positions current.
+void heap_swap(Driver *d, int a, int b) {
+    Student *t = d->heap[a];
+    d->heap[a] = d->heap[b];
+    d->heap[b] = t;
+    d->heap[a]->heapPos = a;
+    d->heap[b]->heapPos = b;
+}
+
+// Timer heap: restores order around index i after its due time changed.
+void heap_fix(Driver *d, int i) {
+    while (i > 0 && d->heap[(i - 1) / 2]->due > d->heap[i]->due) {
+        heap_swap(d, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < d->heapLen && d->heap[l]->due < d->heap[m]->due) m = l;
+        if (r < d->heapLen && d->heap[r]->due < d->heap[m]->due) m = r;
+        if (m == i) break;
+        heap_swap(d, i, m);
+        i = m;
+    }
+}
+
+// Timer heap: removes a student's timer if it has one.
+void timer_clear(Driver *d, Student *s) {
+    int i = s->heapPos;
+    if (i < 0) return;
+    s->heapPos = -1;
+    d->heapLen--;
+    if (i != d->heapLen) {
+        d->heap[i] = d->heap[d->heapLen];
+        d->heap[i]->heapPos = i;
+        heap_fix(d, i);
+    }
+}
+
+// Timer heap: (re)arms a student's timer to fire at due.
+void timer_set(Driver *d, Student *s, long long due) {
+    s->due = due;
+    if (s->heapPos < 0) {
+        s->heapPos = d->heapLen;
+        d->heap[d->heapLen++] = s;
+    }
+    heap_fix(d, s->heapPos);
+}
+
+// Marks a student as finished, successfully or not.
+void student_finish(Driver *d, Student *s, int state, const char *reason) {
+    timer_clear(d, s);
+    if (s->fd >= 0) {
+        close(s->fd);
+        s->fd = -1;
+    }
+    pb_free(&s->out);
+    free(s->in);
+    s->in = NULL;
+    s->inLen = s->inCap = 0;
+    s->state = state;
+    s->failReason = reason;
+    d->active--;
+    atomic_fetch_sub(&activeTotal, 1);
+}
+
+// Sends as much queued output as the socket takes. Returns 0 if the connection failed.
+int student_flush(Driver *d, Student *s) {
+    while (s->outOff < s->out.len) {
+        ssize_t n = send(s->fd, s->out.data + s->outOff, s->out.len - s->outOff, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return 0;
+        }
+        s->outOff += n;
+    }
+    if (s->outOff == s->out.len) {
+        s->out.len = 0;
+        s->outOff = 0;
+    }
+    int want = s->out.len > 0;
+    if (want != s->wantWrite) {
+        struct epoll_event ev = { .events = EPOLLIN | (want ? EPOLLOUT : 0), .data.ptr = s };
+        epoll_ctl(d->epfd, EPOLL_CTL_MOD, s->fd, &ev);
+        s->wantWrite = want;
+    }
+    return 1;
+}
+
+// Finishes the frame being built in the output buffer and sends it.
+int student_send(Driver *d, Student *s, size_t start) {
+    proto_end(&s->out, start);
+    if (s->out.failed) return 0;
+    return student_flush(d, s);
+}
+
+// Opens a non-blocking connection to the server.
+void student_connect(Driver *d, Student *s) {
+    s->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s->fd < 0) {
+        student_finish(d, s, ST_FAILED, "socket");
+        return;
+    }
+    int one = 1;
+    setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    long long now = now_us();
+    if (s->resuming) s->resumeAt = now;
+    else s->connectAt = now;
+    if (connect(s->fd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) < 0 && errno != EINPROGRESS) {
+        student_finish(d, s, ST_FAILED, "connect");
+        return;
+    }
+    s->state = ST_CONNECTING;
+    s->wantWrite = 1;
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT, .data.ptr = s };
+    if (epoll_ctl(d->epfd, EPOLL_CTL_ADD, s->fd, &ev) < 0) {
+        student_finish(d, s, ST_FAILED, "epoll");
+    }
+}
+
+// Sends MSG_LOGIN, or MSG_RESUME when coming back after a drop.
+void student_login(Driver *d, Student *s) {
+    size_t start;
+    if (s->resuming) {
+        start = proto_begin(&s->out, MSG_RESUME);
+        pb_put_str(&s->out, s->roll);
+        pb_put_str(&s->out, s->token);
+        pb_put_str(&s->out, opt.examCode);
+    } else {
+        start = proto_begin(&s->out, MSG_LOGIN);
+        pb_put_str(&s->out, s->roll);
+        pb_put_str(&s->out, s->password);
+        pb_put_str(&s->out, opt.examCode);
+    }
+    s->state = ST_LOGIN;
+    if (!student_send(d, s, start)) student_finish(d, s, ST_FAILED, "send login");
+}
+
+// Sends the result once every question is answered.
+void student_send_result(Driver *d, Student *s) {
+    int totalTime = 0, correctCount = 0;
+    for (int i = 0; i < s->total; i++) {
+        totalTime += s->responseTimes[i];
+        correctCount += s->right[i];
+    }
+    size_t start = proto_begin(&s->out, MSG_RESULT);
+    pb_put_str(&s->out, s->roll);
+    pb_put_str(&s->out, s->name);
+    pb_put_varint(&s->out, correctCount);
+    pb_put_varint(&s->out, s->total);
+    pb_put_varint(&s->out, 0);
+    pb_put_varint(&s->out, totalTime);
+    pb_put_varint(&s->out, s->total);
+    for (int i = 0; i < s->total; i++) pb_put_varint(&s->out, s->responseTimes[i]);
+    s->state = ST_RESULT;
+    s->resultSentAt = now_us();
+    if (!student_send(d, s, start)) student_finish(d, s, ST_FAILED, "send result");
+}
+
+// Drops the connection without a goodbye, as a flaky network would, and schedules the resume.
+void student_drop(Driver *d, Student *s) {
+    struct linger hard = { 1, 0 };
+    setsockopt(s->fd, SOL_SOCKET, SO_LINGER, &hard, sizeof(hard));
+    close(s->fd);
+    s->fd = -1;
+    s->out.len = s->outOff = 0;
+    s->inLen = 0;
+    s->dropAfter = -1;
+    s->resuming = 1;
+    s->state = ST_DROPPED;
+    timer_set(d, s, now_us() + opt.reconnectMs * 1000LL);
+}
+
+// Answers the next question, then schedules the one after, the drop or the result. On an
+// adaptive paper the server decides what comes next, so the student waits for it instead.
+void student_answer(Driver *d, Student *s) {
+    int i = s->next++;
+    long long now = now_us();
+    int ms = (int)((now - s->askedAt) / 1000);
+    char option;
+    // Adaptive papers: the server's own prior, b = -1, 0 or 1 by difficulty, with a = 1
+    double p = s->adaptive ? 1.0 / (1.0 + exp(-(s->ability - ((int)s->difficulty[i] - 2)))) : opt.accuracy;
+    if (uniform01(s) < p) {
+        option = s->correct[i];
+    } else {
+        // Any of the other three options
+        option = 'A' + (s->correct[i] - 'A' + 1 + rand_r(&s->seed) % 3) % 4;
+    }
+    // After a resume only the unanswered tail of a fixed paper is left
+    int slot = s->adaptive ? i : s->total - s->count + i;
+    if (slot >= 0 && slot < PROTO_MAX_QUESTIONS) {
+        s->responseTimes[slot] = (ms + 999) / 1000;
+        s->right[slot] = option == s->correct[i];
+    }
+
+    size_t start = proto_begin(&s->out, MSG_ANSWER);
+    pb_put_varint(&s->out, s->qids[i]);
+    pb_put_u8(&s->out, (uint8_t)option);
+    pb_put_varint(&s->out, ms);
+    if (!student_send(d, s, start)) {
+        student_finish(d, s, ST_FAILED, "send answer");
+        return;
+    }
+
+    s->askedAt = now;
+    if (s->adaptive) {
+        if (s->next == s->dropAfter) {
+            student_drop(d, s);
+        } else {
+            s->state = ST_NEXT;
+        }
+    } else if (s->next >= s->count) {
+        student_send_result(d, s);
+    } else if (s->total - s->count + s->next == s->dropAfter) {
+        student_drop(d, s);
+    } else {
+        s->state = ST_THINKING;
+        timer_set(d, s, now + think_ms(s) * 1000LL);
+    }
+}
+
+// Reads one question into paper slot i, keeping only its id, answer and difficulty.
+void student_read_question(Student *s, ProtoReader *r, int i) {
+    char text[4096];
+    s->qids[i] = pr_varint(r);
+    for (int f = 0; f < 5; f++) pr_str(r, text, sizeof(text));
+    s->correct[i] = pr_u8(r);
+    s->difficulty[i] = pr_u8(r);
+    if (s->correct[i] < 'A' || s->correct[i] > 'D') s->correct[i] = 'A';
+    if (s->difficulty[i] < 1 || s->difficulty[i] > 3) s->difficulty[i] = 2;
+}
+
+// Reads the questions of a START or RESUME_OK body. A fixed paper lists the questions
+// left to answer; an adaptive one at most the question it is waiting on, which is new
+// unless the answer to the last one was lost in a drop. Returns 0 if it is malformed.
+int student_read_paper(Student *s, ProtoReader *r, int start) {
+    pr_varint(r);   // Time per question
+    pr_varint(r);   // Exam time left
+    pr_f32(r);
+    pr_f32(r);
+    if (start) s->adaptive = pr_varint(r);
+    uint32_t count = pr_varint(r);
+    int at = s->adaptive ? s->total : 0;
+    if (s->adaptive > PROTO_MAX_QUESTIONS || count > (uint32_t)(PROTO_MAX_QUESTIONS - at)) return 0;
+    if (s->adaptive && count > 1) return 0;
+    for (uint32_t i = 0; i < count && !r->failed; i++) student_read_question(s, r, at + i);
+    if (r->failed) return 0;
+    s->count = count;
+    if (!s->adaptive) {
+        s->next = 0;
+    } else if (count == 1 && at > 0 && s->qids[at] == s->qids[at - 1]) {
+        s->next = at - 1;
+    } else {
+        s->next = at;
+        s->total += count;
+    }
+    return 1;
+}
+
+// Draws a standard normal number (Box-Muller).
+double normal01(Student *s) {
+    return sqrt(-2.0 * log(1.0 - uniform01(s))) * cos(2.0 * M_PI * uniform01(s));
+}
+
+// Handles one complete frame from the server.
+void student_frame(Driver *d, Student *s, int type, const unsigned char *body, uint32_t len) {
+    ProtoReader r;
+    pr_init(&r, body, len);
+    long long now = now_us();
+    if (type == MSG_LOGIN_OK && s->state == ST_LOGIN && !s->resuming) {
+        char regNo[50];
+        pr_str(&r, s->name, sizeof(s->name));
+        pr_str(&r, regNo, sizeof(regNo));
+        pr_str(&r, s->token, sizeof(s->token));
+        if (r.failed) {
+            student_finish(d, s, ST_FAILED, "bad LOGIN_OK");
+            return;
+        }
+        s->loginOkAt = now;
+        s->state = ST_WAITING;
+    } else if (type == MSG_LOGIN_QUEUED && s->state == ST_LOGIN && !s->resuming) {
+        s->queuePosition = pr_varint(&r);
+    } else if (type == MSG_START && s->state == ST_WAITING) {
+        if (!student_read_paper(s, &r, 1)) {
+            student_finish(d, s, ST_FAILED, "bad START");
+            return;
+        }
+        s->startDone = now;
+        s->total = s->count;
+        if (s->count == 0) {
+            student_send_result(d, s);
+            return;
+        }
+        // Students spread around the ability that gives the -A accuracy on a medium question
+        double accuracy = opt.accuracy < 0.01 ? 0.01 : opt.accuracy > 0.99 ? 0.99 : opt.accuracy;
+        s->ability = log(accuracy / (1.0 - accuracy)) + normal01(s);
+        int length = s->adaptive ? s->adaptive : s->count;
+        s->dropAfter = uniform01(s) < opt.dropRate && length > 1 ? 1 + rand_r(&s->seed) % (length - 1) : -1;
+        s->askedAt = now;
+        s->state = ST_THINKING;
+        timer_set(d, s, now + think_ms(s) * 1000LL);
+    } else if (type == MSG_RESUME_OK && s->state == ST_LOGIN && s->resuming) {
+        if (!student_read_paper(s, &r, 0)) {
+            student_finish(d, s, ST_FAILED, "bad RESUME_OK");
+            return;
+        }
+        s->resumedAt = now;
+        s->resuming = 0;
+        s->askedAt = now;
+        if (s->count == 0) {
+            // An adaptive paper that ended during the drop is closed by MSG_ADAPTIVE_DONE
+            if (s->adaptive) s->state = ST_NEXT;
+            else student_send_result(d, s);
+            return;
+        }
+        s->state = ST_THINKING;
+        timer_set(d, s, now + think_ms(s) * 1000LL);
+    } else if (type == MSG_QUESTION && s->state == ST_NEXT) {
+        if (s->total >= PROTO_MAX_QUESTIONS) {
+            student_finish(d, s, ST_FAILED, "bad QUESTION");
+            return;
+        }
+        student_read_question(s, &r, s->total);
+        if (r.failed) {
+            student_finish(d, s, ST_FAILED, "bad QUESTION");
+            return;
+        }
+        s->nextUs[s->nextCount++] = (int)(now - s->askedAt);
+        s->total++;
+        s->askedAt = now;
+        s->state = ST_THINKING;
+        timer_set(d, s, now + think_ms(s) * 1000LL);
+    } else if (type == MSG_ADAPTIVE_DONE && s->state == ST_NEXT) {
+        s->finished = 1;
+        student_send_result(d, s);
+    } else if (type == MSG_LOGIN_FAIL) {
+        student_finish(d, s, ST_FAILED, s->resuming ? "resume refused" : "login refused");
+    } else if (type == MSG_ERROR) {
+        char reason[256];
+        pr_str(&r, reason, sizeof(reason));
+        // A student still answering when the exam closes is scored by the server
+        student_finish(d, s, ST_FAILED, strstr(reason, "time") ? "exam time over" : "server error");
+    } else {
+        student_finish(d, s, ST_FAILED, "unexpected frame");
+    }
+}
+
+// Reads what the server sent and handles every complete frame in it.
+void student_readable(Driver *d, Student *s) {
+    while (1) {
+        if (s->inCap - s->inLen < 4096) {
+            size_t cap = s->inCap ? s->inCap * 2 : 8192;
+            unsigned char *grown = realloc(s->in, cap);
+            if (grown == NULL) {
+                student_finish(d, s, ST_FAILED, "out of memory");
+                return;
+            }
+            s->in = grown;
+            s->inCap = cap;
+        }
+        ssize_t n = recv(s->fd, s->in + s->inLen, s->inCap - s->inLen, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        }
+        if (n <= 0) {
+            if (s->state == ST_RESULT) {
+                // The server closes the connection once it has taken the result
+                s->closedAt = now_us();
+                student_finish(d, s, ST_DONE, NULL);
+            } else {
+                student_finish(d, s, ST_FAILED, "connection closed");
+            }
+            return;
+        }
+        if (s->inLen == 0 && s->state == ST_WAITING) s->startFirstByte = now_us();
+        s->inLen += n;
+    }
+
+    size_t off = 0;
+    while (s->inLen - off >= PROTO_HEADER_SIZE) {
+        int type;
+        uint32_t len;
+        int code = proto_parse_header(s->in + off, &type, &len);
+        if (code != PROTO_OK) {
+            student_finish(d, s, ST_FAILED, proto_strerror(code));
+            return;
+        }
+        if (s->inLen - off < PROTO_HEADER_SIZE + len) break;
+        int fd = s->fd;
+        student_frame(d, s, type, s->in + off + PROTO_HEADER_SIZE, len);
+        // A frame can end the student or drop its connection; the buffer is then gone
+        if (s->fd != fd || s->in == NULL) return;
+        off += PROTO_HEADER_SIZE + len;
+    }
+    memmove(s->in, s->in + off, s->inLen - off);
+    s->inLen -= off;
+}
+
+// Handles readiness on a student's socket.
+void student_event(Driver *d, Student *s, uint32_t events) {
+    if (s->state == ST_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            student_finish(d, s, ST_FAILED, "connect");
+            return;
+        }
+        student_login(d, s);
+        return;
+    }
+    if (events & EPOLLOUT) {
+        if (!student_flush(d, s)) {
+            student_finish(d, s, ST_FAILED, "send");
+            return;
+        }
+    }
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) student_readable(d, s);
+}
+
+// Fires a student's timer: its ramp-up slot, next answer, or reconnect after a drop.
+void student_timer(Driver *d, Student *s) {
+    s->heapPos = -1;
+    if (s->state == ST_IDLE || s->state == ST_DROPPED) {
+        student_connect(d, s);
+    } else if (s->state == ST_THINKING) {
+        student_answer(d, s);
+    }
+}
+
+// Thread body: runs the epoll loop until all its students are done or the run times out.
+void *driver_run(void *arg) {
+    Driver *d = (Driver *)arg;
+    struct epoll_event events[EPOLL_BATCH];
+    long long deadline = runStarted + opt.timeoutSec * 1000000LL;
+    while (d->active > 0) {
+        long long now = now_us();
+        if (now >= deadline) break;
+        while (d->heapLen > 0 && d->heap[0]->due <= now) {
+            Student *s = d->heap[0];
+            timer_clear(d, s);
+            student_timer(d, s);
+        }
+        int wait = 1000;
+        if (d->heapLen > 0) {
+            long long ms = (d->heap[0]->due - now + 999) / 1000;
+            if (ms < wait) wait = (int)ms;
+        }
+        int n = epoll_wait(d->epfd, events, EPOLL_BATCH, wait);
+        for (int i = 0; i < n; i++) {
+            Student *s = events[i].data.ptr;
+            if (s->fd < 0) continue;
+            student_event(d, s, events[i].events);
+        }
+    }
+    for (int i = 0; i < d->count; i++) {
+        Student *s = &d->students[i];
+        if (s->state != ST_DONE && s->state != ST_FAILED) {
+            student_finish(d, s, ST_FAILED, "timed out");
+        }
+    }
+    return NULL;
+}
+
+// Orders latencies for qsort.
+int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Prints one latency row: count, p50, p90, p99 and max, in milliseconds.
+void print_row(const char *label, long long *v, int n) {
+    if (n == 0) {
+        printf("| %-22s | %7d | %9s | %9s | %9s | %9s |\n", label, 0, "-", "-", "-", "-");
+        return;
+    }
+    qsort(v, n, sizeof(long long), compare_ll);
+    printf("| %-22s | %7d | %9.2f | %9.2f | %9.2f | %9.2f |\n", label, n,
+           v[(n - 1) * 50 / 100] / 1000.0, v[(n - 1) * 90 / 100] / 1000.0,
+           v[(n - 1) * 99 / 100] / 1000.0, v[n - 1] / 1000.0);
+}
+
+// Prints the run summary: outcomes, stage latencies and result throughput.
+void report(Student *all, int n, long long elapsedUs) {
+    long long *login = malloc(n * sizeof(long long));
+    long long *skew = malloc(n * sizeof(long long));
+    long long *paper = malloc(n * sizeof(long long));
+    long long *resume = malloc(n * sizeof(long long));
+    long long *ingest = malloc(n * sizeof(long long));
+    long long *next = malloc((size_t)n * PROTO_MAX_QUESTIONS * sizeof(long long));
+    if (!login || !skew || !paper || !resume || !ingest || !next) {
+        printf("📛 Out of memory building the report\n");
+        return;
+    }
+    int nLogin = 0, nStart = 0, nResume = 0, nDone = 0, nDropped = 0, nQueued = 0, maxPosition = 0;
+    int nNext = 0, nAdaptive = 0, adaptiveQuestions = 0, mostQuestions = 0;
+    long long firstStart = 0, firstResult = 0, lastClose = 0;
+    for (int i = 0; i < n; i++) {
+        Student *s = &all[i];
+        if (s->loginOkAt) login[nLogin++] = s->loginOkAt - s->connectAt;
+        if (s->queuePosition) nQueued++;
+        if (s->queuePosition > maxPosition) maxPosition = s->queuePosition;
+        if (s->startDone && (firstStart == 0 || s->startFirstByte < firstStart)) firstStart = s->startFirstByte;
+        if (s->resumeAt) nDropped++;
+        if (s->resumedAt) resume[nResume++] = s->resumedAt - s->resumeAt;
+        if (s->state == ST_DONE) {
+            ingest[nDone++] = s->closedAt - s->resultSentAt;
+            if (firstResult == 0 || s->resultSentAt < firstResult) firstResult = s->resultSentAt;
+            if (s->closedAt > lastClose) lastClose = s->closedAt;
+        }
+        for (int j = 0; j < s->nextCount; j++) next[nNext++] = s->nextUs[j];
+        if (s->finished) {
+            nAdaptive++;
+            adaptiveQuestions += s->total;
+            if (s->adaptive > mostQuestions) mostQuestions = s->adaptive;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        Student *s = &all[i];
+        if (!s->startDone) continue;
+        skew[nStart] = s->startDone - firstStart;
+        paper[nStart] = s->startDone - s->startFirstByte;
+        nStart++;
+    }
+
+    printf("\n📊 Load Test Report (%d students, %.1f s)\n", n, elapsedUs / 1e6);
+    printf("+------------------------+---------+\n");
+    printf("| Logged in              | %7d |\n", nLogin);
+    printf("| Queued for login       | %7d |\n", nQueued);
+    printf("| Longest login queue    | %7d |\n", maxPosition);
+    printf("| Received START         | %7d |\n", nStart);
+    printf("| Dropped and reconnected| %7d |\n", nDropped);
+    printf("| Resumed                | %7d |\n", nResume);
+    printf("| Results accepted       | %7d |\n", nDone);
+    printf("| Failed                 | %7d |\n", n - nDone);
+    printf("+------------------------+---------+\n");
+
+    // Group failures by reason
+    const char *reasons[16];
+    int counts[16], nReasons = 0;
+    for (int i = 0; i < n; i++) {
+        const char *why = all[i].failReason;
+        if (all[i].state != ST_FAILED || why == NULL) continue;
+        int j = 0;
+        while (j < nReasons && strcmp(reasons[j], why) != 0) j++;
+        if (j == nReasons) {
+            if (nReasons == 16) continue;
+            reasons[nReasons] = why;
+            counts[nReasons++] = 0;
+        }
+        counts[j]++;
+    }
+    for (int j = 0; j < nReasons; j++) {
+        printf("📛 %-40s %d\n", reasons[j], counts[j]);
+    }
+
+    printf("\n+------------------------+---------+-----------+-----------+-----------+-----------+\n");
+    printf("| Stage (ms)             |   Count |       p50 |       p90 |       p99 |       Max |\n");
+    printf("+------------------------+---------+-----------+-----------+-----------+-----------+\n");
+    print_row("Login latency", login, nLogin);
+    print_row("START fan-out skew", skew, nStart);
+    print_row("Paper delivery", paper, nStart);
+    print_row("Resume latency", resume, nResume);
+    print_row("Result ingest", ingest, nDone);
+    if (nNext > 0) print_row("Next adaptive question", next, nNext);
+    printf("+------------------------+---------+-----------+-----------+-----------+-----------+\n");
+    if (nAdaptive > 0) {
+        printf("🧭 Adaptive papers: %d finished with %.1f questions on average, of up to %d\n",
+               nAdaptive, (double)adaptiveQuestions / nAdaptive, mostQuestions);
+    }
+    double window = (lastClose - firstResult) / 1e6;
+    if (nDone > 0) {
+        printf("📥 Result ingest throughput: %.1f results/s (%d results over %.3f s)\n",
+               window > 0 ? nDone / window : (double)nDone, nDone, window);
+    }
+    free(login);
+    free(skew);
+    free(paper);
+    free(resume);
+    free(ingest);
+    free(next);
+}
+
+// Prints the command line options.
+void usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  -H host       server address (default %s)\n", SERVER_IP);
+    printf("  -p port       server port (default %d)\n", SERVER_PORT);
+    printf("  -n students   students to simulate (default 100)\n");
+    printf("  -f first      number of the first student (default 0)\n");
+    printf("  -R format     roll number format (default S%%d)\n");
+    printf("  -P format     password format (default pw%%d)\n");
+    printf("  -c code       exam code (default: the server's default exam)\n");
+    printf("  -t threads    driver threads (default: one per CPU)\n");
+    printf("  -d dist       think time distribution: fixed, uniform or exp (default exp)\n");
+    printf("  -m ms         mean think time per question (default 1000)\n");
+    printf("  -A fraction   share of answers that are correct (default 0.7); on adaptive papers,\n");
+    printf("                of medium questions, for a student of average ability\n");
+    printf("  -x fraction   share of students who drop mid-exam and resume (default 0)\n");
+    printf("  -y ms         delay before a dropped student reconnects (default 500)\n");
+    printf("  -r rate       connections per second while ramping up (default: all at once)\n");
+    printf("  -w seconds    give up after this long (default 600)\n");
+}
+
+// Main function: parses options, starts the driver threads and prints the report.
+int main(int argc, char *argv[]) {
+    int c;
+    while ((c = getopt(argc, argv, "H:p:n:f:R:P:c:t:d:m:A:x:y:r:w:h")) != -1) {
+        switch (c) {
+            case 'H': opt.host = optarg; break;
+            case 'p': opt.port = atoi(optarg); break;
+            case 'n': opt.students = atoi(optarg); break;
+            case 'f': opt.firstId = atoi(optarg); break;
+            case 'R': opt.rollFormat = optarg; break;
+            case 'P': opt.passFormat = optarg; break;
+            case 'c': opt.examCode = optarg; break;
+            case 't': opt.threads = atoi(optarg); break;
+            case 'd':
+                if (strcmp(optarg, "fixed") == 0) opt.thinkDist = THINK_FIXED;
+                else if (strcmp(optarg, "uniform") == 0) opt.thinkDist = THINK_UNIFORM;
+                else if (strcmp(optarg, "exp") == 0) opt.thinkDist = THINK_EXP;
+                else opt.thinkDist = -1;
+                break;
+            case 'm': opt.thinkMeanMs = atof(optarg); break;
+            case 'A': opt.accuracy = atof(optarg); break;
+            case 'x': opt.dropRate = atof(optarg); break;
+            case 'y': opt.reconnectMs = atoi(optarg); break;
+            case 'r': opt.rampPerSec = atof(optarg); break;
+            case 'w': opt.timeoutSec = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                exit(c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (opt.threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        opt.threads = cpus < 1 ? 1 : (cpus > MAX_THREADS ? MAX_THREADS : (int)cpus);
+    }
+    if (opt.port < 1 || opt.port > 65535 || opt.students < 1 || opt.threads < 1 || opt.threads > MAX_THREADS ||
+        opt.thinkDist < 0 || opt.thinkMeanMs < 0 || opt.accuracy < 0 || opt.accuracy > 1 ||
+        opt.dropRate < 0 || opt.dropRate > 1 || opt.reconnectMs < 0 || opt.rampPerSec < 0 || opt.timeoutSec < 1) {
+        printf("📛 Invalid option value\n");
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (opt.threads > opt.students) opt.threads = opt.students;
+
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.host, &serverAddr.sin_addr) <= 0) {
+        printf("📛 Invalid server address %s\n", opt.host);
+        exit(EXIT_FAILURE);
+    }
+
+    Student *all = calloc(opt.students, sizeof(Student));
+    Driver *drivers = calloc(opt.threads, sizeof(Driver));
+    if (all == NULL || drivers == NULL) {
+        printf("📛 Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("🚀 Simulating %d students with %d thread(s) against %s:%d\n", opt.students, opt.threads,
+           opt.host, opt.port);
+    runStarted = now_us();
+    atomic_store(&activeTotal, opt.students);
+    for (int t = 0; t < opt.threads; t++) {
+        Driver *d = &drivers[t];
+        int from = (int)((long long)opt.students * t / opt.threads);
+        int to = (int)((long long)opt.students * (t + 1) / opt.threads);
+        d->id = t;
+        d->students = all + from;
+        d->count = to - from;
+        d->active = d->count;
+        d->heap = calloc(d->count, sizeof(Student *));
+        d->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (d->heap == NULL || d->epfd < 0) {
+            perror("📛 Error setting up driver thread");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < d->count; i++) {
+            Student *s = &d->students[i];
+            s->id = opt.firstId + from + i;
+            s->fd = -1;
+            s->heapPos = -1;
+            s->dropAfter = -1;
+            s->seed = (unsigned int)(s->id * 2654435761u) ^ (unsigned int)runStarted;
+            snprintf(s->roll, sizeof(s->roll), opt.rollFormat, s->id);
+            snprintf(s->password, sizeof(s->password), opt.passFormat, s->id);
+            pb_init(&s->out);
+            // Ramp-up: student k connects k / rate seconds after the start
+            long long offset = opt.rampPerSec > 0 ? (long long)((from + i) * 1e6 / opt.rampPerSec) : 0;
+            timer_set(d, s, runStarted + offset);
+        }
+    }
+    for (int t = 0; t < opt.threads; t++) {
+        if (pthread_create(&drivers[t].thread, NULL, driver_run, &drivers[t]) != 0) {
+            perror("📛 Error creating driver thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Progress line while the exam runs
+    int remaining;
+    while ((remaining = atomic_load(&activeTotal)) > 0 && now_us() - runStarted < opt.timeoutSec * 1000000LL) {
+        int loggedIn = 0, started = 0;
+        for (int i = 0; i < opt.students; i++) {
+            if (all[i].loginOkAt) loggedIn++;
+            if (all[i].startDone) started++;
+        }
+        printf("⏳ logged in %d, started %d, still running %d\n", loggedIn, started, remaining);
+        fflush(stdout);
+        sleep(1);
+    }
+    for (int t = 0; t < opt.threads; t++) {
+        pthread_join(drivers[t].thread, NULL);
+    }
+
+    report(all, opt.students, now_us() - runStarted);
+    int failed = 0;
+    for (int i = 0; i < opt.students; i++) {
+        if (all[i].state != ST_DONE) failed++;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
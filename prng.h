@@ -0,0 +1,75 @@
+// ExamSys pseudo-random numbers: xoshiro256** seeded through splitmix64.
+//
+// Each generator is a plain struct owned by its caller, so threads never share state or
+// take a lock, and the same seed always gives the same sequence. That is what lets the
+// server regenerate a student's paper for an audit from its seed alone.
+#ifndef EXAMSYS_PRNG_H
+#define EXAMSYS_PRNG_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t s[4];
+} Prng;
+
+// splitmix64: advances *x and returns a well-mixed value of it.
+static inline uint64_t prng_splitmix(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Seeds a generator. Any seed, including 0, gives a valid state.
+static inline void prng_seed(Prng *p, uint64_t seed) {
+    for (int i = 0; i < 4; i++) p->s[i] = prng_splitmix(&seed);
+}
+
+static inline uint64_t prng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t prng_next(Prng *p) {
+    uint64_t *s = p->s;
+    uint64_t result = prng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = prng_rotl(s[3], 45);
+    return result;
+}
+
+// Uniform value in [0, n), n > 0, without modulo bias (Lemire's multiply and reject).
+static inline uint32_t prng_below(Prng *p, uint32_t n) {
+    uint64_t m = (uint64_t)(uint32_t)(prng_next(p) >> 32) * n;
+    if ((uint32_t)m < n) {
+        uint32_t threshold = -n % n;
+        while ((uint32_t)m < threshold) m = (uint64_t)(uint32_t)(prng_next(p) >> 32) * n;
+    }
+    return (uint32_t)(m >> 32);
+}
+
+// Fisher-Yates shuffle of n ints.
+static inline void prng_shuffle(Prng *p, int *a, int n) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)prng_below(p, (uint32_t)i + 1);
+        int temp = a[i];
+        a[i] = a[j];
+        a[j] = temp;
+    }
+}
+
+// Mixes a string into h (FNV-1a, then splitmix64), for seeds derived from names.
+static inline uint64_t prng_hash(const char *text, uint64_t h) {
+    h ^= 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        h ^= *c;
+        h *= 1099511628211ULL;
+    }
+    return prng_splitmix(&h);
+}
+
+#endif
@@ -8,8 +8,9 @@
 #include <sys/select.h>
 #include <time.h>
 #include <termios.h>
+#include "qbank.h"
+#include "prng.h"
 
-#define MAX_QUESTIONS 200
 #define MAX_LINE 512
 #define MAX_STUDENTS 100
 #define STUDENT_FILE "student_dtls.txt"
@@ -36,16 +37,6 @@ typedef struct {
     char password[MAX_LINE];
 } Instructor;
 
-typedef struct {
-    char question[MAX_LINE];
-    char optionA[MAX_LINE];
-    char optionB[MAX_LINE];
-    char optionC[MAX_LINE];
-    char optionD[MAX_LINE];
-    char correct;
-    int difficulty;
-} Question;
-
 typedef struct {
     char roll[MAX_LINE];
     char name[MAX_LINE];
@@ -60,7 +51,7 @@ typedef struct {
 DashboardStudent dashboardStudents[MAX_STUDENTS];
 int studentCount = 0;
 
-Question questions[MAX_QUESTIONS];
+QBankBuilder bank;   // Question records over one string arena, see qbank.h
 int totalQuestions = 0;
 int answerTimeout;
 float marksForCorrectAnswer;
@@ -71,7 +62,6 @@ void clear_input_buffer();
 void getPassword(char *password, int size);
 void load_rules();
 void trim(char *s);
-int read_nonempty_line(FILE *fp, char *buffer, int size);
 void load_questions();
 int verify_student(const char *roll, const char *pass, char *name, char *reg_no);
 int verify_instructor(const char *instructor_id, const char *pass, char *name);
@@ -139,21 +129,6 @@ void trim(char *s) {
     }
 }
 
-int read_nonempty_line(FILE *fp, char *buffer, int size) {
-    while(fgets(buffer, size, fp)) {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        char temp[MAX_LINE];
-        strcpy(temp, buffer);
-        char *start = temp;
-        while(*start && isspace((unsigned char)*start)) start++;
-        if(strlen(start) > 0) {
-            strcpy(buffer, start);
-            return 1;
-        }
-    }
-    return 0;
-}
-
 void load_questions() {
     FILE *fp = fopen(QUESTION_FILE, "r");
     if(fp == NULL) {
@@ -161,34 +136,12 @@ void load_questions() {
         exit(EXIT_FAILURE);
     }
 
-    char line[MAX_LINE];
-    int qIndex = 0;
-    while(qIndex < MAX_QUESTIONS) {
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        strncpy(questions[qIndex].question, line, MAX_LINE);
-
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        strncpy(questions[qIndex].optionA, line, MAX_LINE);
-
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        strncpy(questions[qIndex].optionB, line, MAX_LINE);
-
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        strncpy(questions[qIndex].optionC, line, MAX_LINE);
-
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        strncpy(questions[qIndex].optionD, line, MAX_LINE);
-
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        questions[qIndex].correct = toupper(line[0]);
-
-        if(!read_nonempty_line(fp, line, MAX_LINE)) break;
-        questions[qIndex].difficulty = atoi(line);
-
-        qIndex++;
+    qb_free(&bank);
+    if(qb_parse_text(&bank, fp, stdout) < 0) {
+        printf("📛 Out of memory loading questions\n");
+        exit(EXIT_FAILURE);
     }
-
-    totalQuestions = qIndex;
+    totalQuestions = bank.count;
     fclose(fp);
 }
 
@@ -303,18 +256,18 @@ void *exam_session(void *arg) {
     char* diffNames[] = {"", "⭐ Easy", "⭐⭐ Medium", "⭐⭐⭐ Hard"};
     float diffWeights[] = {0, 1.0, 1.5, 2.0};
 
+    // The paper's order comes from a seed of the roll number and start time, so two students
+    // starting in the same second get different papers and the seed reproduces this one
+    uint64_t seed = prng_hash(roll, (uint64_t)time(NULL));
+    Prng rng;
+    prng_seed(&rng, seed);
     int indices[totalQuestions];
     for (int i = 0; i < totalQuestions; i++)
         indices[i] = i;
-    srand(time(NULL));
-    for (int i = totalQuestions - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        int temp = indices[i];
-        indices[i] = indices[j];
-        indices[j] = temp;
-    }
+    prng_shuffle(&rng, indices, totalQuestions);
     
     printf("\n📝 Exam starting now. You will be shown %d questions.\n", NUM_EXAM_QUESTIONS);
+    printf("🎲 Paper seed: %016llx\n", (unsigned long long)seed);
     printf("⏱️  You have %d seconds per question.\n", answerTimeout);
     printf("⏳ Overall exam time: %d seconds.\n", overallExamTime);
     printf("💡 Question weights: Easy(x%.1f) Medium(x%.1f) Hard(x%.1f)\n", 
@@ -328,17 +281,17 @@ void *exam_session(void *arg) {
             break;
         }
         
-        Question *q = &questions[indices[i]];
+        const QBankRecord *q = &bank.records[indices[i]];
         totalDifficulty += q->difficulty;
 
         printf("\n--------------------------------------------------\n");
         printf("| 🔹 Q%-38d | %-12s |\n", i+1, diffNames[q->difficulty]);
         printf("--------------------------------------------------\n");
-        printf("| %-47s |\n", q->question);
-        printf("| 🅰️  %-45s |\n", q->optionA);
-        printf("| 🅱️  %-45s |\n", q->optionB);
-        printf("| ©️  %-45s |\n", q->optionC);
-        printf("| 🅳  %-45s |\n", q->optionD);
+        printf("| %-47s |\n", bank.strings + q->off[0]);
+        printf("| 🅰️  %-45s |\n", bank.strings + q->off[1]);
+        printf("| 🅱️  %-45s |\n", bank.strings + q->off[2]);
+        printf("| ©️  %-45s |\n", bank.strings + q->off[3]);
+        printf("| 🅳  %-45s |\n", bank.strings + q->off[4]);
         printf("--------------------------------------------------\n");
         
         printf("💭 Your answer (A/B/C/D or 'e' to exit): ");
@@ -518,43 +471,35 @@ void add_question() {
         return;
     }
     
-    Question newQuestion;
-    printf("📝 Enter the question: ");
+    // Lines are read without a length cap, up to QBANK_MAX_TEXT bytes each
+    const char *prompts[QBANK_FIELDS] = {
+        "📝 Enter the question: ", "🅰️  Enter option A: ", "🅱️  Enter option B: ", "©️  Enter option C: ", "🅳  Enter option D: "
+    };
+    char *texts[QBANK_FIELDS] = {0};
+    size_t caps[QBANK_FIELDS] = {0};
     clear_input_buffer();
-    fgets(newQuestion.question, MAX_LINE, stdin);
-    trim(newQuestion.question);
-    
-    printf("🅰️  Enter option A: ");
-    fgets(newQuestion.optionA, MAX_LINE, stdin);
-    trim(newQuestion.optionA);
-    
-    printf("🅱️  Enter option B: ");
-    fgets(newQuestion.optionB, MAX_LINE, stdin);
-    trim(newQuestion.optionB);
-    
-    printf("©️  Enter option C: ");
-    fgets(newQuestion.optionC, MAX_LINE, stdin);
-    trim(newQuestion.optionC);
-    
-    printf("🅳  Enter option D: ");
-    fgets(newQuestion.optionD, MAX_LINE, stdin);
-    trim(newQuestion.optionD);
+    for(int f = 0; f < QBANK_FIELDS; f++) {
+        printf("%s", prompts[f]);
+        if(getline(&texts[f], &caps[f], stdin) < 0) {
+            for(int k = 0; k < QBANK_FIELDS; k++) free(texts[k]);
+            fclose(fp);
+            return;
+        }
+        trim(texts[f]);
+    }
     
+    char correct;
+    int difficulty;
     printf("✅ Enter the correct option (A/B/C/D): ");
-    scanf(" %c", &newQuestion.correct);
-    newQuestion.correct = toupper(newQuestion.correct);
+    scanf(" %c", &correct);
+    correct = toupper(correct);
     
     printf("📊 Enter difficulty level (1=Easy, 2=Medium, 3=Hard): ");
-    scanf("%d", &newQuestion.difficulty);
+    scanf("%d", &difficulty);
     
     fprintf(fp, "%s\n%s\n%s\n%s\n%s\n%c\n%d\n", 
-           newQuestion.question, 
-           newQuestion.optionA,
-           newQuestion.optionB,
-           newQuestion.optionC,
-           newQuestion.optionD,
-           newQuestion.correct,
-           newQuestion.difficulty);
+           texts[0], texts[1], texts[2], texts[3], texts[4], correct, difficulty);
+    for(int f = 0; f < QBANK_FIELDS; f++) free(texts[f]);
     
     fclose(fp);
     printf("🎉 Question added successfully!\n");
@@ -0,0 +1,345 @@
+// ExamSys wire protocol shared by server.c and client.c.
+//
+// Every message is a frame: an 8-byte header followed by a variable-length body.
+//   u16 magic    PROTO_MAGIC, rejects connections that do not speak ExamSys
+//   u8  version  PROTO_VERSION, both sides refuse frames from another version
+//   u8  type     one of the MSG_* values below
+//   u32 length   body length in bytes
+// All integers are big-endian. Inside a body, counts and small numbers are varints
+// (7 bits per byte, low bits first) and strings are a varint length followed by the
+// bytes, without a terminating NUL.
+#ifndef EXAMSYS_PROTOCOL_H
+#define EXAMSYS_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#define PROTO_MAGIC 0x4553          // "ES"
+#define PROTO_VERSION 8
+#define PROTO_HEADER_SIZE 8
+#define PROTO_MAX_BODY (1 << 20)    // Largest body either side accepts
+#define PROTO_MAX_QUESTIONS 32      // Most questions one paper can hold, fixed or adaptive
+
+// Message types. Version 1 sent the exam config and each question as separate
+// frames (types 5 and 6); version 2 carries the whole exam in MSG_START. Version 3
+// gives every question an id and streams each answer as a MSG_ANSWER when it is given.
+// Version 4 adds the overall exam time to MSG_START; the server enforces it. Version 5
+// adds a session token to MSG_LOGIN_OK so a dropped student can resume the exam. Version 6
+// names the exam in MSG_LOGIN and MSG_RESUME, since one server hosts several. Version 7 adds
+// MSG_LOGIN_QUEUED, sent before the login response while the server is pacing logins. Version 8
+// adds adaptive papers: MSG_START gives their most questions and carries the first, and each
+// answer is followed by the next question as a MSG_QUESTION, or by MSG_ADAPTIVE_DONE.
+enum {
+    MSG_LOGIN = 1,      // Client: roll, password, exam code (empty for the default exam)
+    MSG_LOGIN_OK = 2,   // Server: name, reg_no, session token
+    MSG_LOGIN_FAIL = 3, // Server: reason
+    MSG_START = 4,      // Server: answerTimeout, exam duration, marks for correct, marks deducted,
+                        //         adaptive length (0 for a fixed paper), question count,
+                        //         then per question: id, text, options A-D, correct, difficulty
+    MSG_RESULT = 7,     // Client: roll, name, correct, attempted, flagged, total time, response times;
+                        //         the server scores the answers it received and keeps only the flag
+    MSG_ERROR = 8,      // Either side: reason, sent before closing
+    MSG_ANSWER = 9,     // Client: question id, option ('A'-'D', or 0 if unanswered), response time in ms
+    MSG_RESUME = 10,    // Client, instead of MSG_LOGIN after a dropped connection: roll, session token, exam code
+    MSG_RESUME_OK = 11, // Server: answerTimeout, seconds left, marks for correct, marks deducted, count,
+                        //         then the unanswered questions encoded as in MSG_START
+    MSG_LOGIN_QUEUED = 12, // Server: position in the login queue, estimated seconds until the check
+    MSG_QUESTION = 13,  // Server, adaptive papers: the next question, encoded as in MSG_START
+    MSG_ADAPTIVE_DONE = 14 // Server, adaptive papers: no more questions; estimated ability, its standard error
+};
+
+// Results of proto_parse_header
+enum {
+    PROTO_OK = 0,
+    PROTO_BAD_MAGIC,
+    PROTO_BAD_VERSION,
+    PROTO_TOO_BIG
+};
+
+// Growable output buffer holding one or more encoded frames
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+    int failed;     // Set when an allocation failed; the contents are then unusable
+} ProtoBuf;
+
+// Cursor over a received frame body
+typedef struct {
+    const unsigned char *p;
+    size_t len;
+    size_t off;
+    int failed;     // Set when the body was shorter than its fields claimed
+} ProtoReader;
+
+static inline void pb_init(ProtoBuf *b) {
+    b->data = NULL;
+    b->len = b->cap = 0;
+    b->failed = 0;
+}
+
+static inline void pb_free(ProtoBuf *b) {
+    free(b->data);
+    pb_init(b);
+}
+
+// Makes room for n more bytes. Returns 0 on allocation failure.
+static inline int pb_reserve(ProtoBuf *b, size_t n) {
+    if (b->failed) return 0;
+    if (b->len + n <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->len + n) cap *= 2;
+    unsigned char *grown = realloc(b->data, cap);
+    if (grown == NULL) {
+        b->failed = 1;
+        return 0;
+    }
+    b->data = grown;
+    b->cap = cap;
+    return 1;
+}
+
+static inline void pb_put_bytes(ProtoBuf *b, const void *src, size_t n) {
+    if (!pb_reserve(b, n)) return;
+    memcpy(b->data + b->len, src, n);
+    b->len += n;
+}
+
+static inline void pb_put_u8(ProtoBuf *b, uint8_t v) {
+    pb_put_bytes(b, &v, 1);
+}
+
+static inline void pb_put_u16(ProtoBuf *b, uint16_t v) {
+    unsigned char tmp[2] = { (unsigned char)(v >> 8), (unsigned char)v };
+    pb_put_bytes(b, tmp, 2);
+}
+
+static inline void pb_put_u32(ProtoBuf *b, uint32_t v) {
+    unsigned char tmp[4] = { (unsigned char)(v >> 24), (unsigned char)(v >> 16),
+                             (unsigned char)(v >> 8), (unsigned char)v };
+    pb_put_bytes(b, tmp, 4);
+}
+
+static inline void pb_put_varint(ProtoBuf *b, uint32_t v) {
+    unsigned char tmp[5];
+    int n = 0;
+    do {
+        tmp[n] = v & 0x7f;
+        v >>= 7;
+        if (v) tmp[n] |= 0x80;
+        n++;
+    } while (v);
+    pb_put_bytes(b, tmp, n);
+}
+
+// Floats travel as their IEEE-754 bit pattern in a big-endian u32.
+static inline void pb_put_f32(ProtoBuf *b, float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    pb_put_u32(b, bits);
+}
+
+static inline void pb_put_strn(ProtoBuf *b, const char *s, size_t n) {
+    pb_put_varint(b, (uint32_t)n);
+    pb_put_bytes(b, s, n);
+}
+
+static inline void pb_put_str(ProtoBuf *b, const char *s) {
+    pb_put_strn(b, s, strlen(s));
+}
+
+// Encodes a frame header for a body of len bytes built separately, e.g. to send
+// header and body with one writev.
+static inline void proto_header(unsigned char h[PROTO_HEADER_SIZE], int type, uint32_t len) {
+    h[0] = PROTO_MAGIC >> 8;
+    h[1] = PROTO_MAGIC & 0xff;
+    h[2] = PROTO_VERSION;
+    h[3] = (unsigned char)type;
+    h[4] = len >> 24;
+    h[5] = len >> 16;
+    h[6] = len >> 8;
+    h[7] = len;
+}
+
+// Starts a frame of the given type. Returns the offset to pass to proto_end.
+static inline size_t proto_begin(ProtoBuf *b, int type) {
+    size_t start = b->len;
+    pb_put_u16(b, PROTO_MAGIC);
+    pb_put_u8(b, PROTO_VERSION);
+    pb_put_u8(b, (uint8_t)type);
+    pb_put_u32(b, 0);   // Patched by proto_end
+    return start;
+}
+
+// Finishes the frame started at offset start by filling in its body length.
+static inline void proto_end(ProtoBuf *b, size_t start) {
+    if (b->failed) return;
+    uint32_t body = (uint32_t)(b->len - start - PROTO_HEADER_SIZE);
+    unsigned char *p = b->data + start + 4;
+    p[0] = body >> 24;
+    p[1] = body >> 16;
+    p[2] = body >> 8;
+    p[3] = body;
+}
+
+// Validates a frame header and extracts its type and body length.
+static inline int proto_parse_header(const unsigned char *h, int *type, uint32_t *len) {
+    uint16_t magic = (uint16_t)((h[0] << 8) | h[1]);
+    if (magic != PROTO_MAGIC) return PROTO_BAD_MAGIC;
+    if (h[2] != PROTO_VERSION) return PROTO_BAD_VERSION;
+    *type = h[3];
+    *len = ((uint32_t)h[4] << 24) | ((uint32_t)h[5] << 16) | ((uint32_t)h[6] << 8) | h[7];
+    if (*len > PROTO_MAX_BODY) return PROTO_TOO_BIG;
+    return PROTO_OK;
+}
+
+// Describes a proto_parse_header failure.
+static inline const char *proto_strerror(int code) {
+    switch (code) {
+        case PROTO_BAD_MAGIC: return "peer does not speak the ExamSys protocol";
+        case PROTO_BAD_VERSION: return "peer uses a different protocol version";
+        case PROTO_TOO_BIG: return "frame too large";
+        default: return "ok";
+    }
+}
+
+static inline void pr_init(ProtoReader *r, const void *body, size_t len) {
+    r->p = (const unsigned char *)body;
+    r->len = len;
+    r->off = 0;
+    r->failed = 0;
+}
+
+static inline int pr_has(ProtoReader *r, size_t n) {
+    if (r->failed || r->len - r->off < n) {
+        r->failed = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static inline uint8_t pr_u8(ProtoReader *r) {
+    if (!pr_has(r, 1)) return 0;
+    return r->p[r->off++];
+}
+
+static inline uint32_t pr_u32(ProtoReader *r) {
+    if (!pr_has(r, 4)) return 0;
+    const unsigned char *p = r->p + r->off;
+    r->off += 4;
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t pr_varint(ProtoReader *r) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (!pr_has(r, 1)) return 0;
+        uint8_t byte = r->p[r->off++];
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return v;
+    }
+    r->failed = 1;
+    return 0;
+}
+
+static inline float pr_f32(ProtoReader *r) {
+    uint32_t bits = pr_u32(r);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Copies a string field into dst (always NUL-terminated). A string that does not fit
+// marks the reader failed rather than being silently truncated.
+static inline void pr_str(ProtoReader *r, char *dst, size_t size) {
+    uint32_t n = pr_varint(r);
+    dst[0] = '\0';
+    if (!pr_has(r, n)) return;
+    if (n >= size) {
+        r->failed = 1;
+        return;
+    }
+    memcpy(dst, r->p + r->off, n);
+    dst[n] = '\0';
+    r->off += n;
+}
+
+// Sends the whole buffer on a blocking socket. Returns 0 on failure.
+static inline int proto_send_all(int sock, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t sent = send(sock, p, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += sent;
+        len -= sent;
+    }
+    return 1;
+}
+
+// Buffered frame reader for a blocking socket. Each recv() pulls in as much as the
+// kernel has, so a large frame or several small ones cost few system calls.
+typedef struct {
+    int sock;
+    unsigned char *buf;
+    size_t start;   // First unread byte
+    size_t end;     // One past the last received byte
+    size_t cap;
+} ProtoReaderConn;
+
+static inline void prc_init(ProtoReaderConn *rc, int sock) {
+    rc->sock = sock;
+    rc->buf = NULL;
+    rc->start = rc->end = rc->cap = 0;
+}
+
+static inline void prc_free(ProtoReaderConn *rc) {
+    free(rc->buf);
+    rc->buf = NULL;
+    rc->start = rc->end = rc->cap = 0;
+}
+
+// Reads until at least need bytes are buffered. Returns 0 on error or EOF.
+static inline int prc_fill(ProtoReaderConn *rc, size_t need) {
+    if (rc->end - rc->start >= need) return 1;
+    if (rc->start > 0) {
+        memmove(rc->buf, rc->buf + rc->start, rc->end - rc->start);
+        rc->end -= rc->start;
+        rc->start = 0;
+    }
+    if (need > rc->cap) {
+        size_t cap = rc->cap ? rc->cap : 4096;
+        while (cap < need) cap *= 2;
+        unsigned char *grown = realloc(rc->buf, cap);
+        if (grown == NULL) return 0;
+        rc->buf = grown;
+        rc->cap = cap;
+    }
+    while (rc->end < need) {
+        ssize_t n = recv(rc->sock, rc->buf + rc->end, rc->cap - rc->end, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        rc->end += n;
+    }
+    return 1;
+}
+
+// Returns the next frame. The body pointer stays valid until the next call.
+// Returns PROTO_OK, a header error code, or -1 on socket error or EOF.
+static inline int prc_next(ProtoReaderConn *rc, int *type, const unsigned char **body, uint32_t *len) {
+    if (!prc_fill(rc, PROTO_HEADER_SIZE)) return -1;
+    int code = proto_parse_header(rc->buf + rc->start, type, len);
+    if (code != PROTO_OK) return code;
+    if (!prc_fill(rc, PROTO_HEADER_SIZE + *len)) return -1;
+    *body = rc->buf + rc->start + PROTO_HEADER_SIZE;
+    rc->start += PROTO_HEADER_SIZE + *len;
+    return PROTO_OK;
+}
+
+#endif
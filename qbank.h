@@ -0,0 +1,296 @@
+// ExamSys compiled question bank, written by qbc and mapped by server.c.
+//
+// A .qbc file is a text bank (questions_with_difficulty.txt) parsed, validated and laid
+// out so the server can use it straight from an mmap:
+//   QBankHeader    magic, version, question count and where the sections start
+//   QBankRecord[]  one fixed-size record per question, in the order of the text bank
+//   index          record ids grouped by difficulty, easy first, so a paper can draw from
+//                  one level without scanning the bank
+//   strings        every question and option text, each followed by a NUL
+// Integers are in host byte order; byteOrder rejects a file compiled on a machine of the
+// other endianness. Offsets in the header are from the start of the file, offsets in a
+// record from the start of the strings section.
+#ifndef EXAMSYS_QBANK_H
+#define EXAMSYS_QBANK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+
+#define QBANK_MAGIC "EXQBANK"       // Seven characters and the NUL fill magic[8]
+#define QBANK_VERSION 2
+#define QBANK_BYTE_ORDER 0x01020304u
+#define QBANK_FIELDS 5              // Question text, then options A-D
+#define QBANK_MAX_TEXT 65535        // Longest question or option, in bytes
+#define QBANK_LEVELS 3              // Difficulties 1 (easy) to 3 (hard)
+#define QBANK_MAX_STRINGS 0xffffffffu // Largest strings section a record offset can reach
+
+// Fixed-size file header
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t count;                 // Questions in the bank
+    uint32_t recordSize;            // sizeof(QBankRecord) when compiled
+    uint64_t recordsOff;            // Where the records start
+    uint64_t stringsOff;            // Where the strings section starts
+    uint64_t stringsLen;            // Bytes in the strings section
+    uint64_t fileSize;              // Bytes in the whole file
+    uint64_t checksum;              // FNV-1a of everything after the header
+    uint64_t indexOff;              // Where the difficulty index starts
+    uint32_t levelStart[QBANK_LEVELS + 1]; // Index entries of difficulty d are [levelStart[d-1], levelStart[d])
+} QBankHeader;
+
+// One question: where its texts are and how it is marked
+typedef struct {
+    uint32_t off[QBANK_FIELDS];     // Start of each text in the strings section
+    uint16_t len[QBANK_FIELDS];     // Its length without the NUL
+    char correct;                   // 'A', 'B', 'C', or 'D'
+    uint8_t difficulty;             // 1 (easy), 2 (medium), 3 (hard)
+} QBankRecord;
+
+// A validated bank in memory, mapped from a file or built from text
+typedef struct {
+    const QBankHeader *header;
+    const QBankRecord *records;
+    const uint32_t *index;
+    const char *strings;
+    uint32_t count;
+} QBank;
+
+// Growable bank under construction: records and strings kept in two arrays
+typedef struct {
+    QBankRecord *records;
+    uint32_t count, cap;
+    char *strings;
+    size_t len, strCap;
+    int failed;                     // Set when an allocation failed or the strings overflowed
+} QBankBuilder;
+
+static inline uint64_t qbank_checksum(const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Checks that size bytes at data hold a bank this build can read and points bank at its
+// sections. Records are checked where they are used, so opening a large bank does not touch
+// its pages. Returns NULL on success, otherwise what is wrong.
+static inline const char *qbank_open(QBank *bank, const void *data, size_t size) {
+    const QBankHeader *h = (const QBankHeader *)data;
+    if (size < sizeof(QBankHeader) || memcmp(h->magic, QBANK_MAGIC, sizeof(h->magic)) != 0) {
+        return "not a compiled question bank";
+    }
+    if (h->byteOrder != QBANK_BYTE_ORDER) return "compiled on a machine of the other byte order";
+    if (h->version != QBANK_VERSION || h->recordSize != sizeof(QBankRecord)) {
+        return "compiled by a different version of qbc";
+    }
+    if (h->fileSize != size) return "truncated or resized after compiling";
+    if (h->recordsOff % sizeof(uint32_t) != 0 || h->recordsOff > size ||
+        (size - h->recordsOff) / sizeof(QBankRecord) < h->count ||
+        h->indexOff % sizeof(uint32_t) != 0 || h->indexOff > size ||
+        (size - h->indexOff) / sizeof(uint32_t) < h->count ||
+        h->stringsOff > size || size - h->stringsOff < h->stringsLen) {
+        return "sections lie outside the file";
+    }
+    if (h->levelStart[0] != 0 || h->levelStart[QBANK_LEVELS] > h->count) return "difficulty index is damaged";
+    for (int l = 0; l < QBANK_LEVELS; l++) {
+        if (h->levelStart[l] > h->levelStart[l + 1]) return "difficulty index is damaged";
+    }
+    bank->header = h;
+    bank->records = (const QBankRecord *)((const char *)data + h->recordsOff);
+    bank->index = (const uint32_t *)((const char *)data + h->indexOff);
+    bank->strings = (const char *)data + h->stringsOff;
+    bank->count = h->count;
+    return NULL;
+}
+
+// Returns the record of question id, or NULL if it points outside the strings section.
+static inline const QBankRecord *qbank_record(const QBank *bank, uint32_t id) {
+    if (id >= bank->count) return NULL;
+    const QBankRecord *rec = &bank->records[id];
+    for (int f = 0; f < QBANK_FIELDS; f++) {
+        if ((uint64_t)rec->off[f] + rec->len[f] >= bank->header->stringsLen ||
+            bank->strings[rec->off[f] + rec->len[f]] != '\0') {
+            return NULL;
+        }
+    }
+    return rec;
+}
+
+// Record ids of the questions of one difficulty (1-3); *n receives how many there are.
+// The ids are not checked; pass them to qbank_record.
+static inline const uint32_t *qbank_level(const QBank *bank, int difficulty, uint32_t *n) {
+    const uint32_t *start = bank->header->levelStart;
+    *n = start[difficulty] - start[difficulty - 1];
+    return bank->index + start[difficulty - 1];
+}
+
+// Text of one field of a record: 0 is the question, 1-4 are options A-D.
+static inline const char *qbank_text(const QBank *bank, const QBankRecord *rec, int field) {
+    return bank->strings + rec->off[field];
+}
+
+static inline void qb_init(QBankBuilder *b) {
+    memset(b, 0, sizeof(*b));
+}
+
+static inline void qb_free(QBankBuilder *b) {
+    free(b->records);
+    free(b->strings);
+    qb_init(b);
+}
+
+// Appends one question. The texts are copied into the strings array.
+static inline void qb_add(QBankBuilder *b, const char *texts[QBANK_FIELDS], const size_t lens[QBANK_FIELDS],
+                          char correct, int difficulty) {
+    if (b->failed) return;
+    size_t need = 0;
+    for (int f = 0; f < QBANK_FIELDS; f++) need += lens[f] + 1;
+    if (b->len + need > QBANK_MAX_STRINGS) {
+        b->failed = 1;
+        return;
+    }
+    if (b->count == b->cap) {
+        uint32_t cap = b->cap ? b->cap * 2 : 64;
+        QBankRecord *grown = (QBankRecord *)realloc(b->records, cap * sizeof(QBankRecord));
+        if (grown == NULL) {
+            b->failed = 1;
+            return;
+        }
+        b->records = grown;
+        b->cap = cap;
+    }
+    if (b->len + need > b->strCap) {
+        size_t cap = b->strCap ? b->strCap : 4096;
+        while (cap < b->len + need) cap *= 2;
+        char *grown = (char *)realloc(b->strings, cap);
+        if (grown == NULL) {
+            b->failed = 1;
+            return;
+        }
+        b->strings = grown;
+        b->strCap = cap;
+    }
+    QBankRecord *rec = &b->records[b->count++];
+    memset(rec, 0, sizeof(*rec));
+    for (int f = 0; f < QBANK_FIELDS; f++) {
+        rec->off[f] = (uint32_t)b->len;
+        rec->len[f] = (uint16_t)lens[f];
+        memcpy(b->strings + b->len, texts[f], lens[f]);
+        b->len += lens[f];
+        b->strings[b->len++] = '\0';
+    }
+    rec->correct = correct;
+    rec->difficulty = (uint8_t)difficulty;
+}
+
+// Reads the next line holding more than whitespace into *line, without leading whitespace
+// or the line end. Returns its length, or -1 at end of file. lineNo counts every line read.
+static inline ssize_t qb_next_line(FILE *fp, char **buf, size_t *cap, char **line, int *lineNo) {
+    ssize_t n;
+    while ((n = getline(buf, cap, fp)) != -1) {
+        (*lineNo)++;
+        while (n > 0 && ((*buf)[n - 1] == '\n' || (*buf)[n - 1] == '\r')) (*buf)[--n] = '\0';
+        char *start = *buf;
+        while (*start && isspace((unsigned char)*start)) start++;
+        if (*start != '\0') {
+            *line = start;
+            return n - (start - *buf);
+        }
+    }
+    return -1;
+}
+
+// Parses a text bank: seven non-blank lines per question (text, options A-D, correct
+// option, difficulty 1-3). Invalid questions are skipped and reported to diag if it is not
+// NULL. Returns the number of questions skipped, or -1 if memory ran out.
+static inline int qb_parse_text(QBankBuilder *b, FILE *fp, FILE *diag) {
+    // One buffer per line of a question, reused for every question
+    char *bufs[QBANK_FIELDS + 2] = {0};
+    size_t caps[QBANK_FIELDS + 2] = {0};
+    char *lines[QBANK_FIELDS + 2];
+    size_t lens[QBANK_FIELDS + 2];
+    int lineNo = 0, skipped = 0;
+    while (!b->failed) {
+        int first = 0, got;
+        for (got = 0; got < QBANK_FIELDS + 2; got++) {
+            ssize_t n = qb_next_line(fp, &bufs[got], &caps[got], &lines[got], &lineNo);
+            if (n < 0) break;
+            if (got == 0) first = lineNo;
+            lens[got] = (size_t)n;
+        }
+        if (got < QBANK_FIELDS + 2) {
+            if (got > 0 && diag) fprintf(diag, "📛 Incomplete question at line %d ignored\n", first);
+            break;
+        }
+        char correct = (char)toupper((unsigned char)lines[QBANK_FIELDS][0]);
+        int difficulty = atoi(lines[QBANK_FIELDS + 1]);
+        const char *problem = NULL;
+        for (int f = 0; f < QBANK_FIELDS; f++) {
+            if (lens[f] > QBANK_MAX_TEXT) problem = "text longer than 65535 bytes";
+        }
+        if (!strchr("ABCD", correct)) problem = "correct option is not A, B, C or D";
+        if (difficulty < 1 || difficulty > 3) problem = "difficulty is not 1, 2 or 3";
+        if (problem) {
+            if (diag) fprintf(diag, "📛 Skipping invalid question at line %d: %s\n", first, problem);
+            skipped++;
+            continue;
+        }
+        qb_add(b, (const char **)lines, lens, correct, difficulty);
+    }
+    for (int i = 0; i < QBANK_FIELDS + 2; i++) free(bufs[i]);
+    return b->failed ? -1 : skipped;
+}
+
+// Lays out the built bank as a complete .qbc image in one allocation, with the difficulty
+// index sorted by counting. Questions of no valid difficulty are left out of the index.
+// Returns NULL if memory ran out; *size receives the image size.
+static inline void *qb_image(QBankBuilder *b, size_t *size) {
+    if (b->failed) return NULL;
+    size_t recordsOff = sizeof(QBankHeader);
+    size_t indexOff = recordsOff + (size_t)b->count * sizeof(QBankRecord);
+    size_t stringsOff = indexOff + (size_t)b->count * sizeof(uint32_t);
+    size_t total = stringsOff + b->len;
+    unsigned char *image = (unsigned char *)calloc(1, total);
+    if (image == NULL) return NULL;
+    QBankHeader *h = (QBankHeader *)image;
+    memcpy(h->magic, QBANK_MAGIC, sizeof(h->magic));
+    h->version = QBANK_VERSION;
+    h->byteOrder = QBANK_BYTE_ORDER;
+    h->count = b->count;
+    h->recordSize = sizeof(QBankRecord);
+    h->recordsOff = recordsOff;
+    h->stringsOff = stringsOff;
+    h->stringsLen = b->len;
+    h->fileSize = total;
+    h->indexOff = indexOff;
+    if (b->count) memcpy(image + recordsOff, b->records, (size_t)b->count * sizeof(QBankRecord));
+    uint32_t next[QBANK_LEVELS + 1] = {0};
+    for (uint32_t i = 0; i < b->count; i++) {
+        int d = b->records[i].difficulty;
+        if (d >= 1 && d <= QBANK_LEVELS) h->levelStart[d]++;
+    }
+    for (int l = 1; l <= QBANK_LEVELS; l++) {
+        h->levelStart[l] += h->levelStart[l - 1];
+        next[l] = h->levelStart[l - 1];
+    }
+    uint32_t *index = (uint32_t *)(image + indexOff);
+    for (uint32_t i = 0; i < b->count; i++) {
+        int d = b->records[i].difficulty;
+        if (d >= 1 && d <= QBANK_LEVELS) index[next[d]++] = i;
+    }
+    if (b->len) memcpy(image + stringsOff, b->strings, b->len);
+    h->checksum = qbank_checksum(image + sizeof(QBankHeader), total - sizeof(QBankHeader));
+    *size = total;
+    return image;
+}
+
+#endif
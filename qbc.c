@@ -0,0 +1,196 @@
+// Question bank compiler: turns a text question bank into the binary .qbc format of qbank.h,
+// which the server maps instead of parsing the text at startup.
+//
+// Build: gcc -O2 qbc.c -o qbc
+// Usage: ./qbc [-o bank.qbc] [questions_with_difficulty.txt]
+//        ./qbc -c bank.qbc
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "qbank.h"
+
+#define QUESTION_FILE "questions_with_difficulty.txt"
+
+// Prints the command line options.
+void usage(const char *prog) {
+    printf("Usage: %s [-o output] [input]\n", prog);
+    printf("       %s -c bank.qbc\n", prog);
+    printf("  input      text question bank (default %s)\n", QUESTION_FILE);
+    printf("  -o output  compiled bank to write (default: input with a .qbc extension)\n");
+    printf("  -c bank    check a compiled bank: header, checksum, every record and the index\n");
+    printf("Exits with 2 if invalid questions were skipped while compiling.\n");
+}
+
+// Milliseconds elapsed since a CLOCK_MONOTONIC timestamp.
+double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000.0 + (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+// Writes the image next to path and renames it into place, so a server that has the old
+// bank mapped keeps reading the old file rather than one being rewritten under it.
+int write_image(const char *path, const void *image, size_t size) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("📛 Error creating compiled bank");
+        return 0;
+    }
+    const char *p = (const char *)image;
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, p + done, size - done);
+        if (n < 0) {
+            perror("📛 Error writing compiled bank");
+            close(fd);
+            unlink(tmp);
+            return 0;
+        }
+        done += n;
+    }
+    if (fsync(fd) < 0 || close(fd) < 0 || rename(tmp, path) < 0) {
+        perror("📛 Error saving compiled bank");
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+// Compiles a text bank. Returns the exit status.
+int compile(const char *input, const char *output) {
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    FILE *fp = fopen(input, "r");
+    if (fp == NULL) {
+        perror("📛 Error opening question bank");
+        return EXIT_FAILURE;
+    }
+    QBankBuilder b;
+    qb_init(&b);
+    int skipped = qb_parse_text(&b, fp, stderr);
+    fclose(fp);
+    if (skipped < 0) {
+        printf("📛 Out of memory, or more than 4 GB of text, compiling %s\n", input);
+        qb_free(&b);
+        return EXIT_FAILURE;
+    }
+    if (b.count == 0) {
+        printf("📛 No valid question in %s\n", input);
+        qb_free(&b);
+        return EXIT_FAILURE;
+    }
+    int perDifficulty[4] = {0};
+    for (uint32_t i = 0; i < b.count; i++) perDifficulty[b.records[i].difficulty]++;
+
+    size_t size;
+    void *image = qb_image(&b, &size);
+    uint32_t count = b.count;
+    qb_free(&b);
+    if (image == NULL) {
+        printf("📛 Out of memory laying out %s\n", output);
+        return EXIT_FAILURE;
+    }
+    int ok = write_image(output, image, size);
+    free(image);
+    if (!ok) return EXIT_FAILURE;
+    printf("📚 Compiled %u question(s) (%d easy, %d medium, %d hard) into %s\n",
+           count, perDifficulty[1], perDifficulty[2], perDifficulty[3], output);
+    printf("📏 %zu bytes, %d invalid question(s) skipped, %.1f ms\n", size, skipped, elapsed_ms(&started));
+    return skipped > 0 ? 2 : EXIT_SUCCESS;
+}
+
+// Checks a compiled bank the way the server would, plus the checksum, every record and the
+// difficulty index.
+// Returns the exit status.
+int check(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("📛 Error opening compiled bank");
+        return EXIT_FAILURE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        printf("📛 %s is empty\n", path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("📛 Error mapping compiled bank");
+        return EXIT_FAILURE;
+    }
+    QBank bank;
+    const char *problem = qbank_open(&bank, map, st.st_size);
+    if (problem == NULL &&
+        qbank_checksum((const char *)map + sizeof(QBankHeader), st.st_size - sizeof(QBankHeader)) != bank.header->checksum) {
+        problem = "checksum mismatch";
+    }
+    uint32_t bad = 0;
+    int perDifficulty[4] = {0};
+    for (uint32_t i = 0; problem == NULL && i < bank.count; i++) {
+        const QBankRecord *rec = qbank_record(&bank, i);
+        if (rec == NULL || !strchr("ABCD", rec->correct) || rec->correct == '\0' ||
+            rec->difficulty < 1 || rec->difficulty > 3) {
+            if (bad++ < 10) printf("📛 Question %u is damaged\n", i + 1);
+            continue;
+        }
+        perDifficulty[rec->difficulty]++;
+    }
+    if (problem == NULL && bad > 0) problem = "damaged questions";
+    // Every index entry must name a record of its level
+    for (int d = 1; problem == NULL && d <= QBANK_LEVELS; d++) {
+        uint32_t n;
+        const uint32_t *ids = qbank_level(&bank, d, &n);
+        if (n != (uint32_t)perDifficulty[d]) problem = "difficulty index does not match the records";
+        for (uint32_t i = 0; problem == NULL && i < n; i++) {
+            if (ids[i] >= bank.count || bank.records[ids[i]].difficulty != d) {
+                problem = "difficulty index does not match the records";
+            }
+        }
+    }
+    if (problem != NULL) {
+        printf("📛 %s: %s\n", path, problem);
+        munmap(map, st.st_size);
+        return EXIT_FAILURE;
+    }
+    printf("✅ %s: %u question(s) (%d easy, %d medium, %d hard), %lld bytes\n", path, bank.count,
+           perDifficulty[1], perDifficulty[2], perDifficulty[3], (long long)st.st_size);
+    munmap(map, st.st_size);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    const char *checkPath = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:c:h")) != -1) {
+        switch (opt) {
+            case 'o': output = optarg; break;
+            case 'c': checkPath = optarg; break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (checkPath != NULL) return check(checkPath);
+
+    const char *input = optind < argc ? argv[optind] : QUESTION_FILE;
+    char defaultOutput[4096];
+    if (output == NULL) {
+        const char *dot = strrchr(input, '.');
+        const char *slash = strrchr(input, '/');
+        int stem = dot != NULL && (slash == NULL || dot > slash) ? (int)(dot - input) : (int)strlen(input);
+        snprintf(defaultOutput, sizeof(defaultOutput), "%.*s.qbc", stem, input);
+        output = defaultOutput;
+    }
+    return compile(input, output);
+}
@@ -1,36 +1,111 @@
+#define _GNU_SOURCE // accept4()
 #include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <termios.h>
 #include <time.h>
 #include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/random.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include "protocol.h"
+#include "qbank.h"
+#include "prng.h"
+#include "irt.h"
 
 // Constants for maximum allowed entries and file names
-#define MAX_QUESTIONS 200
 #define MAX_LINE 512
 #define MAX_STUDENTS 100
 #define STUDENT_FILE "student_dtls.txt"
 #define INSTRUCTOR_FILE "instructor_dtls.txt"
 #define QUESTION_FILE "questions_with_difficulty.txt"
+#define QBANK_FILE "questions_with_difficulty.qbc" // Compiled by qbc; mapped instead of the text bank when present
 #define RESULT_FILE "results.txt"
 #define RULES_FILE "rules.txt"
+#define ANSWER_FILE "answers.txt"
+#define ROSTER_FILE "roster.txt"  // Optional per exam: roll numbers allowed to sit it
+#define EXAMS_DIR "exams"         // Every subdirectory holds one more exam, named by its code
+#define DEFAULT_EXAM "default"    // Code of the exam whose files are in the working directory
+#define MAX_EXAMS 64              // Exams hosted by one server
 #define NUM_EXAM_QUESTIONS 5
+#define BLUEPRINT_DEFAULT { 2, 2, 1 } // Questions per paper of each difficulty, easy to hard
+#define ADAPTIVE_SE_DEFAULT 0.3   // Standard error of the ability estimate an adaptive paper stops at
+#define PRIOR_DIFFICULTY { -1.0, 0.0, 1.0 } // Ability-scale difficulty assumed for an easy, medium or hard question
 #define SERVER_PORT 8080
+#define DEFAULT_BACKLOG 4096 // Pending connections per listening socket; the kernel caps it at somaxconn
+#define MAX_ACCEPTORS 64    // Upper bound on acceptor threads
+#define REGISTRY_SHARDS 64  // Independently locked parts of the session registry
+#define REGISTRY_INITIAL_BUCKETS 16 // Hash buckets per shard before the first growth
+#define SESSION_SLAB_CHUNK 64 // Sessions allocated together when a shard runs out
+#define MAX_LOOPS 64        // Upper bound on event loop threads
+#define MAX_EVENTS 256      // Events handled per epoll_wait call
+#define WORKER_THREADS 4    // Threads in the pool that runs blocking work
+#define LATENCY_BUCKETS 32  // Power-of-two microsecond buckets for task latency
+#define MAX_INBOUND_BODY 4096 // Largest frame body accepted from a student
+#define MAX_FLUSH_IOV 64    // Queued segments written per writev
+#define ANSWER_BATCH 256    // Answer events written by one pool task at most
+#define EXAM_DURATION 300   // Default overall exam time in seconds
+#define LOGIN_TIMEOUT 30    // Seconds a new connection gets to log in
+#define ANSWER_GRACE 5      // Seconds past an answer deadline before a student is presumed gone
+#define SESSION_TOKEN_BYTES 16 // Random bytes in a session token, sent as hex
+#define MIN_ANSWER_TIME 5   // Average answer time below which a closed-out student is flagged, as in the client
+#define TIMER_TICK_MS 100   // Resolution of the per-loop timer wheels
+#define TIMER_LEVELS 4      // Wheel levels; each spans TIMER_SLOTS times the level below
+#define TIMER_SLOTS 64      // Slots per wheel level; must be a power of two
+#define TIMER_SLOT_BITS 6   // log2(TIMER_SLOTS)
+#define HIST_SUB_BITS 3      // Linear sub-buckets per power of two in a histogram, as log2; values are kept within 12.5%
+#define HIST_BUCKETS 320     // Histogram buckets, enough for latencies past a week in microseconds
+#define HIST_EXPORT_MAX 26   // Largest power-of-two microsecond bound exported, about 67 seconds
+#define METRICS_REQUEST_MAX 4096 // Largest HTTP request head read by the metrics endpoint
+#define TRACE_CHUNK_EVENTS 4096 // Spans per trace buffer chunk
+#define TRACE_MAX_CHUNKS 1024   // Chunks allocated at most, about 200 MB; later spans are dropped
+#define RELOAD_POLL_SECONDS 1 // How often credential and question files are checked for changes
+#define ADMISSION_MAX_WAIT 120 // Longest estimated wait in seconds a login is queued for; later ones are turned away
+#define LOG_FILE "server.log"
+#define LOG_RING_SLOTS 512  // Records buffered per thread; must be a power of two
+#define LOG_MSG_SIZE 232    // Longest message kept per record, longer ones are cut
 
-// Global variables for exam configuration and state
-int answerTimeout = 30; // Time allowed per question in seconds
-float marksForCorrectAnswer = 1.0; // Marks for correct answer
-float marksDeductedForWrongAnswer = 0.25; // Negative marks for wrong answer
-volatile int examStarted = 0; // Flag to indicate if exam has started (shared between threads)
-pthread_mutex_t exam_mutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for exam state
-pthread_cond_t exam_cond = PTHREAD_COND_INITIALIZER;    // Condition variable for exam start
+// Log levels. Calls below LOG_COMPILE_LEVEL are removed by the compiler; build with
+// -DLOG_COMPILE_LEVEL=LOG_DEBUG to keep debug logging and hex dumps.
+#define LOG_DEBUG 0
+#define LOG_INFO 1
+#define LOG_WARN 2
+#define LOG_ERROR 3
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_INFO
+#endif
+
+#define LOG_AT(level, ...) do { \
+    if ((level) >= LOG_COMPILE_LEVEL && (level) >= atomic_load_explicit(&logLevel, memory_order_relaxed)) \
+        log_write((level), __VA_ARGS__); \
+} while (0)
+#define log_debug(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#define log_info(...) LOG_AT(LOG_INFO, __VA_ARGS__)
+#define log_warn(...) LOG_AT(LOG_WARN, __VA_ARGS__)
+#define log_error(...) LOG_AT(LOG_ERROR, __VA_ARGS__)
+
+// Overall exam time in seconds given to every exam, enforced by the server
+int examDuration = EXAM_DURATION;
+// Start each exam by itself once this many students have logged in to it; 0 leaves it to the instructor
+int autoStartCount = 0;
 
 // Data structures
 
@@ -49,23 +124,19 @@ typedef struct {
     char password[MAX_LINE];
 } Instructor;
 
-// Holds a single exam question, options, correct answer, and difficulty
+// One question's texts and marking, read from the exam's bank
 typedef struct {
-    char question[MAX_LINE];
-    char optionA[MAX_LINE];
-    char optionB[MAX_LINE];
-    char optionC[MAX_LINE];
-    char optionD[MAX_LINE];
-    char correct;           // 'A', 'B', 'C', or 'D'
-    char padding1[3];       // Padding for alignment
-    int difficulty;         // 1 (easy), 2 (medium), 3 (hard)
-} Question;
+    const char *text[QBANK_FIELDS];  // Question, then options A-D
+    char correct;
+    int difficulty;
+} QuestionView;
 
 // Holds a student's exam results for dashboard and ranking
 typedef struct {
     char roll[MAX_LINE];
     char name[MAX_LINE];
-    int responseTimes[NUM_EXAM_QUESTIONS]; // Time taken per question
+    int responseTimes[PROTO_MAX_QUESTIONS]; // Time taken per answered question
+    int answeredCount;                     // Entries in responseTimes; unanswered questions have none
     int totalTime;                         // Total time for exam
     int correctAnswers;                    // Number of correct answers
     int totalQuestions;                    // Number of questions attempted
@@ -73,20 +144,654 @@ typedef struct {
     int flagged;                           // 1 if suspicious, 0 otherwise
 } DashboardStudent;
 
-// Holds info about a connected client (student)
+struct Session;
+struct Exam;
+
+// Links of a session in one of the registry's hash chains
+typedef struct {
+    struct Session *prev, *next;
+} SessionLink;
+
+// A logged-in student in the session registry
+typedef struct Session {
+    int sock;                  // Socket descriptor, -1 while suspended
+    char roll[50];             // Student roll number
+    char token[2 * SESSION_TOKEN_BYTES + 1]; // Resume token handed out at login
+    struct SuspendedExam *suspended; // Exam state kept after a dropped connection
+    struct Exam *exam;         // Exam the student logged in to
+    unsigned int rollHash;     // roll_hash(roll)
+    SessionLink byRoll;        // Chain in the roll index
+    SessionLink bySock;        // Chain in the socket index
+    struct Session *nextFree;  // Link in the shard's free list while unused
+} Session;
+
+// One lock's worth of a registry index: a growable chained hash table. Roll shards also
+// own the slab that the sessions they index are allocated from.
+typedef struct {
+    pthread_mutex_t mutex;     // Protects everything below
+    Session **buckets;         // Chain heads; bucketCount is a power of two
+    unsigned int bucketCount;
+    int count;                 // Sessions in this shard
+    Session *freeList;         // Unused sessions from this shard's slab chunks
+} RegistryShard;
+
+// Results of register_client
+enum {
+    REGISTRY_OK = 0,
+    REGISTRY_DUPLICATE,
+    REGISTRY_NO_MEMORY
+};
+
+// A deadline in a loop's timer wheel. Owners embed it and recover themselves in fire.
+typedef struct Timer {
+    struct Timer *prev, *next;          // Links in a wheel slot
+    struct Timer **slot;                // Head of the slot it is linked into
+    unsigned long long expires;         // Wheel tick at which it fires
+    int active;                         // 1 while scheduled
+    void (*fire)(struct Timer *);       // Runs on the loop thread when the deadline passes
+} Timer;
+
+// Hierarchical timing wheel: level 0 holds timers due within TIMER_SLOTS ticks, and each
+// higher level holds timers TIMER_SLOTS times further out, cascading down as time passes.
+// Scheduling, cancelling and each tick cost O(1).
+typedef struct {
+    int fd;                             // timerfd ticking every TIMER_TICK_MS while timers are pending
+    unsigned long long now;             // Ticks elapsed while armed
+    int count;                          // Scheduled timers
+    Timer *slots[TIMER_LEVELS][TIMER_SLOTS];
+} TimerWheel;
+
+// Connection states, advanced by the event loop as data arrives or drains
+typedef enum {
+    CONN_LOGIN,     // Waiting for "roll|password" from the client
+    CONN_VERIFYING, // Credentials are being checked by the worker pool
+    CONN_WAITING,   // Logged in, waiting for the instructor to start the exam
+    CONN_EXAM,      // Exam data sent, waiting for the exam result
+    CONN_CLOSED     // Closed, freed at the end of the current event batch
+} ConnState;
+
+struct EventLoop;
+
+// Lets a writer that replaced a shared pointer wait until no reader can still be using the
+// old target. Readers register in the counter of the current epoch's parity.
+typedef struct {
+    atomic_ulong epoch;                  // Bumped by every writer; its low bit picks the readers counter
+    atomic_long readers[2];              // Readers in progress, by the parity of the epoch they entered in
+} ReadEpoch;
+
+// One immutable version of an exam's question bank. The exam's slot holds a reference, as do
+// the exam start that pinned it and every paper built from it, so a version is freed only
+// once no running exam can use it.
+typedef struct {
+    atomic_int refs;
+    unsigned int version;                // 1 for the bank loaded at startup, one more per reload
+    QBank bank;                          // Records and string arena of every question
+    void *data;                          // Memory holding the bank
+    size_t size;
+    int mapped;                          // 1 if data maps QBANK_FILE, 0 if it was built from the text bank
+    IrtTable *irt;                       // Adaptive exams: calibrated questions and information tables, else NULL
+    struct timespec textMtime, qbcMtime; // Question files this version was loaded from
+    off_t textSize, qbcSize;
+} BankSnapshot;
+
+// A published bank version that readers take references to without locks
+typedef struct {
+    _Atomic(BankSnapshot *) current;
+    ReadEpoch guard;                     // Acquires in progress, which bank_publish waits out
+} BankSlot;
+
+// The questions and option order of one paper, all derived from the paper's seed
+typedef struct {
+    int count;                           // Questions on the paper
+    int qids[NUM_EXAM_QUESTIONS];        // Question ids in paper order
+    unsigned char options[NUM_EXAM_QUESTIONS][4]; // Bank option (0-3) shown as A-D
+} PaperLayout;
+
+// A student's encoded MSG_START frame (header and body), immutable once built and shared
+// read-only by the student's sends and session
+typedef struct {
+    atomic_int refs;                     // Holders: queued sends, the connection and the session
+    struct Exam *exam;                   // Exam the paper belongs to
+    uint64_t seed;                       // Seed the paper was generated from
+    BankSnapshot *bank;                  // Bank version it was built from, held until the paper is freed
+    int answerTimeout;                   // Seconds per question on this paper
+    int examDuration;                    // Overall exam time on this paper
+    int adaptiveLength;                  // Most questions of an adaptive paper, 0 for a fixed one
+    int count;                           // Questions on the paper; an adaptive paper starts with one
+    int qids[NUM_EXAM_QUESTIONS];        // Question ids (record indexes in the exam's bank) in paper order
+    char correct[NUM_EXAM_QUESTIONS];    // Correct option of each question as shown, for live scoring
+    size_t qoff[NUM_EXAM_QUESTIONS];     // Where each encoded question starts in data
+    size_t qlen[NUM_EXAM_QUESTIONS];     // Its encoded length, so a resume re-sends it as is
+    float marksCorrect, marksWrong;      // Marking scheme on this paper
+    size_t len;                          // Bytes in data
+    unsigned char data[];
+} PaperBuf;
+
+// One queued piece of output: either a private copy stored right after the header,
+// or a reference into a shared paper buffer
+typedef struct SendSeg {
+    struct SendSeg *next;
+    const unsigned char *data;           // Bytes to send
+    size_t len;                          // Bytes in data
+    size_t off;                          // Bytes already written to the socket
+    PaperBuf *shared;                    // Released when the segment is done; NULL for copies
+    unsigned char copy[];
+} SendSeg;
+
+// A student's progress through an adaptive paper. Every question after the first is chosen
+// from their answers so far, so unlike the paper it is private to the student.
+typedef struct AdaptiveSession {
+    Prng rng;                            // Draws among the best questions, seeded from the paper's seed
+    IrtAbility ability;                  // Estimate after the answers so far
+    int asked;                           // Questions sent; all but the last one are answered
+    int done;                            // 1 once MSG_ADAPTIVE_DONE was sent
+    int qids[PROTO_MAX_QUESTIONS];       // Question ids in the order they were sent
+    char correct[PROTO_MAX_QUESTIONS];   // Correct option of each as shown
+    unsigned char options[PROTO_MAX_QUESTIONS][4]; // Bank option (0-3) shown as A-D, to send one again on resume
+} AdaptiveSession;
+
+// Spans recorded per session when tracing is on
+enum {
+    TRACE_ACCEPT,            // Accepted until its event loop adopted it
+    TRACE_ADMISSION,         // Login waiting in the admission queue for a token
+    TRACE_LOGIN_VERIFY,      // Login queued for the worker pool until the check came back
+    TRACE_REGISTRY_INSERT,   // Adding the session to the registry
+    TRACE_WAIT_START,        // Logged in until the exam started
+    TRACE_SEND,              // One send or writev to the student
+    TRACE_EXAM,              // START sent until the result arrived
+    TRACE_RESULT_RECV,       // First byte of the result frame until it was decoded
+    TRACE_APPEND_RESULT,     // Writing the result to the results file
+    TRACE_KINDS
+};
+
+const char *traceKindNames[TRACE_KINDS] = {
+    "accept", "admission", "login verify", "registry insert", "wait for START", "send", "exam", "result recv", "append_result"
+};
+
+// Holds the non-blocking state of one student connection
+typedef struct Conn {
+    int sock;                            // Socket descriptor (non-blocking)
+    ConnState state;                     // Current protocol state
+    struct EventLoop *loop;              // Loop that owns this connection
+    int registered;                      // 1 if present in the session registry
+    struct Exam *exam;                   // Exam named at login, NULL before that
+    struct EventLoop *handoff;           // Loop taking the connection over after this iteration
+    char roll[50];                       // Student roll number
+    char name[50];                       // Student name from the details file
+    char reg_no[50];                     // Registration number from the details file
+    char token[2 * SESSION_TOKEN_BYTES + 1]; // Session token for resuming after a drop
+    unsigned char inbuf[PROTO_HEADER_SIZE + MAX_INBOUND_BODY]; // Partially received frames
+    size_t in_len;                       // Bytes currently held in inbuf
+    SendSeg *sendq_head, *sendq_tail;    // Output the socket did not accept yet, in order
+    int want_write;                      // 1 while EPOLLOUT is in the interest set
+    int fanout;                          // 1 while the START of a fan-out is still queued
+    struct Conn *prev, *next;            // Links in the loop's waiting list
+    struct Conn *next_closed;            // Link in the loop's list of closed connections
+    int on_closed_list;                  // 1 while linked through next_closed
+    int pending;                         // Worker pool tasks still referring to this Conn
+    PaperBuf *paper;                     // Paper sent in START; answers are checked against it
+    struct AdaptiveSession *adaptive;    // Questions and ability estimate of an adaptive paper, else NULL
+    unsigned int answered;               // Bit i set once question i of the paper was answered
+    int answerCount;                     // Answers received so far
+    int correctCount;                    // Of those, correct ones
+    int answerSeconds[PROTO_MAX_QUESTIONS]; // Response times in the order answers arrived
+    Timer timer;                         // Login, answer or exam deadline, whichever is next
+    struct Conn *next_incoming;          // Link in the loop's queue of accepted sockets or hand-offs
+    unsigned int traceId;                // Session number in the trace, 0 when tracing is off
+    long long acceptedUs;                // Trace times of the open spans, 0 when not open
+    long long waitingUs;
+    long long examUs;
+    long long frameUs;                   // First byte of the frame being received
+} Conn;
+
+// A unit of blocking work for the worker pool. Concrete tasks embed it as their first member.
+typedef struct WorkItem {
+    void (*run)(struct WorkItem *);   // Runs on a worker thread
+    void (*done)(struct WorkItem *);  // Runs on the owning loop afterwards; NULL frees the item
+    struct EventLoop *loop;           // Loop that receives the completion
+    struct timespec queued;           // When the item was submitted
+    struct WorkItem *next;            // Link in the pool queue or a loop's completion queue
+} WorkItem;
+
+// Fixed-size pool of threads draining a FIFO work queue
+typedef struct {
+    pthread_t threads[WORKER_THREADS];
+    pthread_mutex_t mutex;            // Protects the queue and the statistics
+    pthread_cond_t cond;              // Signalled when work is queued
+    WorkItem *head, *tail;            // Pending work
+    int depth;                        // Items currently queued
+    int maxDepth;                     // Highest depth seen
+    long submitted;                   // Items ever queued
+    long completed;                   // Items finished
+    long long totalLatencyUs;         // Sum of queue wait plus run time
+    long long maxLatencyUs;           // Slowest item
+    long latencyBuckets[LATENCY_BUCKETS]; // Bucket i counts latencies below 2^i microseconds
+} WorkerPool;
+
+// Token bucket pacing logins into the worker pool, with a FIFO of logins waiting for a token
 typedef struct {
-    int sock;                  // Socket descriptor
-    char roll[MAX_LINE];       // Student roll number
-} Client;
+    pthread_mutex_t mutex;            // Protects everything below
+    pthread_cond_t cond;              // Signalled when a login is queued
+    double rate;                      // Logins admitted per second; 0 admits every login at once
+    double burst;                     // Tokens the bucket holds at most
+    double tokens;                    // Tokens available now
+    struct timespec refilled;         // When tokens was last brought up to date
+    WorkItem *head, *tail;            // Logins waiting for a token, oldest first
+    int depth;                        // Logins currently queued
+    int maxDepth;                     // Highest depth seen
+    long admitted;                    // Logins passed to the worker pool
+    long turnedAway;                  // Logins refused because the queue was full
+} Admission;
 
-// Arrays and counters for students, questions, and clients
+// Exam state of a student whose connection dropped, kept in the registry until they resume
+// or the timer on the loop that lost them expires it
+typedef struct SuspendedExam {
+    Timer timer;                         // Resume window; expiry closes the exam out
+    int claimed;                         // Set under the shard lock once resumed
+    char roll[50];
+    char name[50];
+    char reg_no[50];
+    PaperBuf *paper;                     // Reference held until the state is freed
+    struct AdaptiveSession *adaptive;    // Owned until the student resumes or the state is freed
+    unsigned int answered;
+    int answerCount;
+    int correctCount;
+    int answerSeconds[PROTO_MAX_QUESTIONS];
+} SuspendedExam;
+
+// One epoll event loop; each runs on its own thread and owns its connections
+typedef struct EventLoop {
+    int id;                    // Index in loops[]
+    int epfd;                  // epoll instance
+    int wakefd;                // eventfd used to wake the loop from other threads
+    pthread_t thread;          // Thread running event_loop_run
+    Conn *waiting;             // Logged-in students waiting for START, of any exam
+    Conn *closed;              // Connections to free after the current batch
+    pthread_mutex_t done_mutex; // Protects the completion and incoming queues
+    WorkItem *done_head, *done_tail; // Finished pool work waiting to run on this loop
+    Conn *incoming;            // Accepted or handed-over connections not yet added to epoll
+    Conn *handoffs;            // Connections to pass to their exam's loop after this iteration
+    atomic_int startRequested; // Set when an exam served here starts; waiting students then get START
+    struct AnswerBatch *answers; // Answers received in the current iteration, not yet handed off
+    TimerWheel wheel;          // Deadlines of this loop's connections
+    atomic_ulong bytesSent;    // Written by this loop only, read by the metrics endpoint
+    atomic_ulong bytesReceived;
+} EventLoop;
+
+// Lock-free latency histogram in the style of HdrHistogram: each power of two is split into
+// 2^HIST_SUB_BITS linear buckets, so any value is recorded with a bounded relative error
+typedef struct {
+    atomic_ulong counts[HIST_BUCKETS];
+    atomic_ulong count;               // Values recorded
+    atomic_ulong sum;                 // Sum of the values in microseconds
+} Histogram;
+
+// Server-wide counters and histograms, updated with relaxed atomics from any thread
+typedef struct {
+    atomic_ulong loginsAccepted;      // Students sent LOGIN_OK
+    atomic_ulong loginsRejected;      // Logins refused: credentials, roster, duplicate, unknown exam or queue full
+    atomic_ulong loginsQueued;        // Logins that had to wait for an admission token
+    atomic_ulong results;             // Results appended to a results file
+    atomic_ulong answers;             // Answer events appended to an answer log
+    Histogram loginLatency;           // MSG_LOGIN received to LOGIN_OK sent
+    Histogram admissionWait;          // MSG_LOGIN received to admitted into the worker pool
+    Histogram fanoutDelay;            // Exam start to START fully delivered, per student
+    Histogram resultAppend;           // Time to append one result under the file lock
+    Histogram answerAppend;           // Time to append one batch of answers under the file lock
+    Histogram adaptiveSelect;         // Ability update and choice of the next question of an adaptive paper
+} Metrics;
+
+// One log message waiting for the writer thread
+typedef struct {
+    struct timespec when;             // Wall-clock time of the call
+    int level;
+    char text[LOG_MSG_SIZE];
+} LogRecord;
+
+// Single-producer ring owned by one thread; the writer thread is the only consumer
+typedef struct LogRing {
+    atomic_ulong head;                // Next record the owner fills
+    atomic_ulong tail;                // Next record the writer prints
+    int id;                           // Thread number shown in the log
+    struct LogRing *next;             // Link in the list of all rings
+    LogRecord records[LOG_RING_SLOTS];
+} LogRing;
+
+// A thread accepting student connections, normally on its own SO_REUSEPORT socket
+typedef struct {
+    int id;                           // Index in acceptors[]
+    int fd;                           // Listening socket
+    pthread_t thread;                 // Thread running acceptor_run
+    int nextLoop;                     // Event loop that gets the next connection
+    atomic_long accepted;             // Connections accepted
+    atomic_long errors;               // Failed accept calls
+    long windowSecond;                // Second currently being counted
+    long windowCount;                 // Connections accepted in that second
+    atomic_long peakPerSecond;        // Most connections accepted within one second
+} Acceptor;
+
+// Answer totals of one question, kept only for questions that have been answered
+typedef struct {
+    int qid;
+    long answered;                    // Answers given
+    long correct;                     // Correct answers
+    long long responseMs;             // Sum of response times
+} LiveQuestion;
+
+// Live view of the streamed answers, updated as batches are written
+typedef struct {
+    pthread_mutex_t mutex;            // Protects everything below
+    long answers;                     // Answer events written to the answer log
+    long batches;                     // Pool tasks that wrote them
+    int maxBatch;                     // Largest batch seen
+    LiveQuestion *questions;          // Open-addressed by question id; qid -1 marks a free slot
+    int slots;                        // Slots in questions, a power of two
+    int used;                         // Questions answered at least once
+} LiveStats;
+
+// Timing of the most recent exam start, used to report start skew across students
+typedef struct {
+    pthread_mutex_t mutex;            // Protects everything below; never held during I/O
+    struct timespec started;          // When the instructor started the exam
+    int target;                       // Students registered at that moment
+    int delivered;                    // Students whose START frame has fully left the server
+    long long *delaysUs;              // Per student: microseconds from start to START delivered
+} FanoutStats;
+
+// One account from a credentials file
+typedef struct {
+    char id[50];                      // Roll number or instructor id
+    char password[50];
+    char name[50];
+    char reg_no[50];                  // Students only
+} Credential;
+
+// Immutable open-addressing hash index over one version of a credentials file
+typedef struct {
+    int count;                        // Accounts in entries
+    unsigned int mask;                // Slots - 1; there are at least twice as many slots as accounts
+    int *slots;                       // Index into entries, -1 when empty
+    Credential *entries;
+} CredIndex;
+
+// A credentials file and the index built from it, replaced as a whole when the file changes
+typedef struct {
+    const char *path;
+    int fields;                       // 4 for students (name roll reg_no password), 3 for instructors, 1 for rosters
+    _Atomic(CredIndex *) index;       // Index lookups use
+    ReadEpoch guard;                  // Lookups in progress, which cred_store_swap waits out
+    struct timespec mtime;            // Identity of the loaded file version
+    off_t size;
+    ino_t ino;
+} CredStore;
+
+// One exam hosted by the server, with its own question bank, rules, roster, results and
+// statistics. Its students are all served by a fixed range of event loops.
+typedef struct Exam {
+    int id;                           // Index in exams[]
+    char code[32];                    // Code students give at login
+    char dir[256];                    // Directory holding the exam's files
+    int answerTimeout;                // Time allowed per question in seconds
+    float marksForCorrectAnswer;      // Marks for correct answer
+    float marksDeductedForWrongAnswer; // Negative marks for wrong answer
+    int duration;                     // Overall exam time in seconds, enforced by the server
+    int blueprint[QBANK_LEVELS];      // Questions per paper of each difficulty, easy to hard
+    int adaptiveLength;               // Most questions of an adaptive paper; 0 gives papers to the blueprint
+    float adaptiveSe;                 // Standard error of the ability estimate an adaptive paper stops at
+    BankSlot bank;                    // Latest version of the question bank, replaced when its files change
+    BankSlot startBank;               // Version the current start's papers come from; empty before the first start
+    CredStore roster;                 // Indexed roster.txt; no index while the exam has no roster
+    char rosterPath[MAX_LINE];
+    atomic_int startClaimed;          // Set by the one caller of start_exam allowed to start it
+    atomic_int started;               // Set once the instructor has started the exam
+    struct timespec startedAt;        // When the instructor started it; written before started
+    int firstLoop;                    // First event loop serving its students
+    int loopSpan;                     // Consecutive loops serving them
+    atomic_ullong startSeed;          // Random seed of the current start; papers derive theirs from it
+    atomic_int registered;            // Students logged in, including dropped ones who may resume
+    atomic_int inProgress;            // Students who received START and are still connected
+    atomic_int suspended;             // Students who dropped mid-exam and may resume
+    LiveStats live;                   // Progress of the running exam
+    FanoutStats fanout;               // Start skew of the last start
+} Exam;
+
+// One recorded span, 48 bytes
+typedef struct {
+    long long startUs;                // Microseconds since the server started
+    unsigned int durUs;
+    unsigned int session;             // Conn trace id; 0 for results closed out without a connection
+    unsigned int bytes;               // Bytes sent, for send spans
+    unsigned short kind;              // TRACE_*
+    char roll[22];                    // Roll number if known yet, names the session's track
+} TraceEvent;
+
+// Fixed block of spans; filled by one thread and published through count
+typedef struct TraceChunk {
+    atomic_int count;
+    struct TraceChunk *_Atomic next;
+    TraceEvent events[TRACE_CHUNK_EVENTS];
+} TraceChunk;
+
+// Per-thread list of trace chunks, so recording a span takes no lock
+typedef struct TraceBuf {
+    TraceChunk *_Atomic first;
+    TraceChunk *current;              // Chunk being filled; only the owner uses it
+    struct TraceBuf *next;            // Link in the list of all buffers
+} TraceBuf;
+
+// Arrays and counters for students, exams, and clients
 DashboardStudent dashboardStudents[MAX_STUDENTS]; // All students' dashboard data
 int studentCount = 0;                             // Number of students in dashboard
-Question questions[MAX_QUESTIONS];                // All loaded questions
-int totalQuestions = 0;                           // Number of loaded questions
-Client clients[MAX_STUDENTS];                     // Connected clients
-int clientCount = 0;                              // Number of connected clients
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for client list
+Exam *exams[MAX_EXAMS];                           // Every hosted exam; exams[0] is the default one
+int examCount = 0;                                // Number of hosted exams
+Exam *currentExam = NULL;                         // Exam the instructor menu works on
+RegistryShard rollShards[REGISTRY_SHARDS];        // Session registry indexed by roll number
+RegistryShard sockShards[REGISTRY_SHARDS];        // Session registry indexed by socket
+atomic_int registryCount = 0;                     // Students currently registered
+EventLoop loops[MAX_LOOPS];                       // Event loops serving student connections
+int loopCount = 0;                                // Number of running event loops
+WorkerPool pool;                                  // Runs credential checks and result writes
+Admission admission;                              // Paces logins into the pool when -r is given
+Acceptor acceptors[MAX_ACCEPTORS];                // Threads accepting student connections
+int acceptorCount = 0;                            // Number of running acceptors
+struct timespec serverStarted;                    // When the acceptors started
+Metrics metrics;                                  // Served in Prometheus format by the metrics endpoint
+CredStore studentCreds = { .path = STUDENT_FILE, .fields = 4 };     // Indexed student_dtls.txt
+CredStore instructorCreds = { .path = INSTRUCTOR_FILE, .fields = 3 }; // Indexed instructor_dtls.txt
+atomic_int logLevel = LOG_INFO;                   // Lowest level written at run time
+_Atomic(LogRing *) logRings = NULL;               // Rings of every thread that has logged
+int logRingCount = 0;                             // Rings created so far
+pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER; // Serializes ring registration
+atomic_long logDropped = 0;                       // Records lost because a ring was full
+atomic_long logWritten = 0;                       // Records written to the log file
+atomic_int logRunning = 0;                        // Cleared to stop the writer thread
+pthread_t logWriter;                              // Thread draining the rings
+FILE *logFile = NULL;                             // Destination of the writer thread
+__thread LogRing *threadLogRing = NULL;           // Ring of the calling thread
+int traceEnabled = 0;                             // Set at startup by -t, never changed afterwards
+const char *tracePath = NULL;                     // Where the trace is exported
+_Atomic(TraceBuf *) traceBufs = NULL;             // Buffers of every thread that has traced
+pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER; // Serializes buffer registration
+atomic_uint traceNextSession = 0;                 // Last session number handed out
+atomic_long traceChunks = 0;                      // Chunks allocated so far
+atomic_long traceDropped = 0;                     // Spans lost to the chunk limit or out of memory
+__thread TraceBuf *threadTraceBuf = NULL;         // Trace buffer of the calling thread
+
+void conn_send(Conn *c, const void *data, size_t len);
+unsigned int roll_hash(const char *roll);
+void conn_sendv(Conn *c, struct iovec *iov, int iovcnt);
+void conn_send_frame(Conn *c, int type, const char *text);
+void conn_close(Conn *c);
+void conn_drop(Conn *c);
+void conn_fail(Conn *c, const char *reason);
+void conn_timer_fire(Timer *t);
+void loop_run_handoffs(EventLoop *loop);
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Microseconds elapsed since a CLOCK_MONOTONIC timestamp.
+long long elapsed_us(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000LL + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+// Metrics: bumps a counter. Relaxed ordering is enough, nothing else is published with it.
+void metrics_count(atomic_ulong *counter, unsigned long n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+// Histogram: bucket of a value. Values below 2^HIST_SUB_BITS get a bucket each; above that,
+// the top HIST_SUB_BITS bits after the leading one pick the sub-bucket of its power of two.
+int hist_bucket(unsigned long long v) {
+    if (v < (1ULL << HIST_SUB_BITS)) return (int)v;
+    int exp = 63 - __builtin_clzll(v);
+    int sub = (int)(v >> (exp - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1);
+    int bucket = ((exp - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + sub;
+    return bucket < HIST_BUCKETS ? bucket : HIST_BUCKETS - 1;
+}
+
+// Histogram: smallest value that falls above a bucket.
+unsigned long long hist_bucket_limit(int bucket) {
+    if (bucket < (1 << HIST_SUB_BITS)) return bucket + 1;
+    int exp = (bucket >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    int sub = bucket & ((1 << HIST_SUB_BITS) - 1);
+    return (unsigned long long)((1 << HIST_SUB_BITS) + sub + 1) << (exp - HIST_SUB_BITS);
+}
+
+// Histogram: records one latency in microseconds.
+void hist_record(Histogram *h, long long us) {
+    if (us < 0) us = 0;
+    atomic_fetch_add_explicit(&h->counts[hist_bucket(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, us, memory_order_relaxed);
+}
+
+// Histogram: upper bound of the bucket holding the given quantile, 0 if nothing was recorded.
+unsigned long long hist_percentile(Histogram *h, double q) {
+    unsigned long total = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (total == 0) return 0;
+    unsigned long want = (unsigned long)(q * total + 0.5), seen = 0;
+    if (want < 1) want = 1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= want) return hist_bucket_limit(i);
+    }
+    return hist_bucket_limit(HIST_BUCKETS - 1);
+}
+
+// Tracing: microseconds since the server started, the time base of every span.
+long long trace_us(const struct timespec *ts) {
+    return (ts->tv_sec - serverStarted.tv_sec) * 1000000LL + (ts->tv_nsec - serverStarted.tv_nsec) / 1000;
+}
+
+// Tracing: the current time on the span time base.
+long long trace_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return trace_us(&now);
+}
+
+// Tracing: returns the calling thread's buffer, creating and registering it on first use.
+TraceBuf *trace_buf_get() {
+    if (threadTraceBuf != NULL) return threadTraceBuf;
+    TraceBuf *buf = calloc(1, sizeof(TraceBuf));
+    if (buf == NULL) return NULL;
+    pthread_mutex_lock(&trace_mutex);
+    buf->next = atomic_load(&traceBufs);
+    atomic_store_explicit(&traceBufs, buf, memory_order_release);
+    pthread_mutex_unlock(&trace_mutex);
+    threadTraceBuf = buf;
+    return buf;
+}
+
+// Tracing: records one span of a session. Only the owning thread appends to its buffer; the
+// exporter reads it concurrently, so each event is published by the release store of count.
+void trace_span(int kind, unsigned int session, const char *roll, long long startUs, long long endUs,
+                unsigned int bytes) {
+    if (!traceEnabled) return;
+    TraceBuf *buf = trace_buf_get();
+    if (buf == NULL) {
+        atomic_fetch_add_explicit(&traceDropped, 1, memory_order_relaxed);
+        return;
+    }
+    TraceChunk *chunk = buf->current;
+    int n = chunk ? atomic_load_explicit(&chunk->count, memory_order_relaxed) : TRACE_CHUNK_EVENTS;
+    if (n == TRACE_CHUNK_EVENTS) {
+        TraceChunk *fresh = NULL;
+        if (atomic_fetch_add_explicit(&traceChunks, 1, memory_order_relaxed) < TRACE_MAX_CHUNKS) {
+            fresh = calloc(1, sizeof(TraceChunk));
+        }
+        if (fresh == NULL) {
+            atomic_fetch_add_explicit(&traceDropped, 1, memory_order_relaxed);
+            return;
+        }
+        if (chunk) atomic_store_explicit(&chunk->next, fresh, memory_order_release);
+        else atomic_store_explicit(&buf->first, fresh, memory_order_release);
+        buf->current = chunk = fresh;
+        n = 0;
+    }
+    TraceEvent *ev = &chunk->events[n];
+    ev->startUs = startUs;
+    ev->durUs = endUs > startUs ? (unsigned int)(endUs - startUs) : 0;
+    ev->session = session;
+    ev->bytes = bytes;
+    ev->kind = (unsigned short)kind;
+    snprintf(ev->roll, sizeof(ev->roll), "%s", roll ? roll : "");
+    atomic_store_explicit(&chunk->count, n + 1, memory_order_release);
+}
+
+// Tracing: writes a string as a JSON string literal.
+void trace_json_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') fprintf(fp, "\\%c", ch);
+        else if (ch < 0x20) fprintf(fp, "\\u%04x", ch);
+        else fputc(ch, fp);
+    }
+    fputc('"', fp);
+}
+
+// Tracing: writes every span recorded so far as Chrome trace JSON, one track per session,
+// named by the student's roll number. Open the file in chrome://tracing or Perfetto.
+int trace_export(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        log_error("📛 Error opening trace file %s: %s", path, strerror(errno));
+        return -1;
+    }
+    unsigned int sessions = atomic_load(&traceNextSession);
+    char *named = calloc(sessions + 1, 1);
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ExamSys sessions\"}},\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"closed out\"}}");
+    long written = 0;
+    for (TraceBuf *buf = atomic_load_explicit(&traceBufs, memory_order_acquire); buf != NULL; buf = buf->next) {
+        for (TraceChunk *chunk = atomic_load_explicit(&buf->first, memory_order_acquire); chunk != NULL;
+             chunk = atomic_load_explicit(&chunk->next, memory_order_acquire)) {
+            int count = atomic_load_explicit(&chunk->count, memory_order_acquire);
+            for (int i = 0; i < count; i++) {
+                TraceEvent *ev = &chunk->events[i];
+                if (named && ev->session > 0 && ev->session <= sessions && !named[ev->session] && ev->roll[0]) {
+                    named[ev->session] = 1;
+                    fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", ev->session);
+                    trace_json_string(fp, ev->roll);
+                    fprintf(fp, "}}");
+                }
+                fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"session\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%u",
+                        traceKindNames[ev->kind], ev->session, ev->startUs, ev->durUs);
+                if (ev->bytes) fprintf(fp, ",\"args\":{\"bytes\":%u}", ev->bytes);
+                fprintf(fp, "}");
+                written++;
+            }
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    free(named);
+    int ok = fclose(fp) == 0;
+    printf("🧵 Wrote %ld trace spans to %s (%ld dropped)\n", written, path, atomic_load(&traceDropped));
+    return ok ? 0 : -1;
+}
 
 // Utility: Clears stdin buffer to avoid leftover input from previous scanf/fgets
 void clear_input_buffer() {
@@ -110,68 +815,240 @@ void getPassword(char *password, int size) {
     printf("\n");
 }
 
-// Utility: Prints a hexadecimal dump of a memory buffer (for debugging)
-void log_hexdump(const void *data, size_t size) {
+// Logging: returns the calling thread's ring, creating and registering it on first use.
+LogRing *log_ring_get() {
+    if (threadLogRing != NULL) return threadLogRing;
+    LogRing *ring = calloc(1, sizeof(LogRing));
+    if (ring == NULL) return NULL;
+    pthread_mutex_lock(&log_mutex);
+    ring->id = logRingCount++;
+    ring->next = atomic_load(&logRings);
+    atomic_store_explicit(&logRings, ring, memory_order_release);
+    pthread_mutex_unlock(&log_mutex);
+    threadLogRing = ring;
+    return ring;
+}
+
+// Logging: formats a message into the calling thread's ring. Never blocks: when the
+// writer has fallen behind and the ring is full, the message is dropped and counted.
+void log_write(int level, const char *fmt, ...) {
+    LogRing *ring = log_ring_get();
+    if (ring == NULL) {
+        atomic_fetch_add(&logDropped, 1);
+        return;
+    }
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_RING_SLOTS) {
+        atomic_fetch_add_explicit(&logDropped, 1, memory_order_relaxed);
+        return;
+    }
+    LogRecord *rec = &ring->records[head & (LOG_RING_SLOTS - 1)];
+    clock_gettime(CLOCK_REALTIME, &rec->when);
+    rec->level = level;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(rec->text, sizeof(rec->text), fmt, args);
+    va_end(args);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Logging: writes every buffered record to the log file. Returns the number written.
+int log_drain() {
+    static const char *names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+    int written = 0;
+    for (LogRing *ring = atomic_load_explicit(&logRings, memory_order_acquire); ring != NULL; ring = ring->next) {
+        unsigned long tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            LogRecord *rec = &ring->records[tail & (LOG_RING_SLOTS - 1)];
+            if (logFile != NULL) {
+                struct tm tm;
+                char stamp[32];
+                localtime_r(&rec->when.tv_sec, &tm);
+                strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+                fprintf(logFile, "%s.%06ld %-5s [t%d] %s\n", stamp, rec->when.tv_nsec / 1000,
+                        names[rec->level], ring->id, rec->text);
+            }
+            atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+            written++;
+        }
+    }
+    if (written > 0) {
+        if (logFile != NULL) fflush(logFile);
+        atomic_fetch_add(&logWritten, written);
+    }
+    return written;
+}
+
+// Logging: background thread that drains the rings, napping briefly when they are empty.
+void *log_writer_run(void *arg) {
+    (void)arg;
+    struct timespec nap = { 0, 5 * 1000 * 1000 };
+    while (atomic_load(&logRunning)) {
+        if (log_drain() == 0) nanosleep(&nap, NULL);
+    }
+    log_drain();
+    return NULL;
+}
+
+// Logging: stops the writer thread after a final drain and closes the log file.
+void log_shutdown() {
+    if (!atomic_exchange(&logRunning, 0)) return;
+    pthread_join(logWriter, NULL);
+    if (logFile != NULL) fclose(logFile);
+    logFile = NULL;
+}
+
+// Logging: opens the log file and starts the writer thread. The run-time level comes from
+// EXAMSYS_LOG_LEVEL (debug, info, warn or error) and defaults to info.
+int log_init(const char *path) {
+    const char *level = getenv("EXAMSYS_LOG_LEVEL");
+    if (level != NULL) {
+        if (strcasecmp(level, "debug") == 0) atomic_store(&logLevel, LOG_DEBUG);
+        else if (strcasecmp(level, "info") == 0) atomic_store(&logLevel, LOG_INFO);
+        else if (strcasecmp(level, "warn") == 0) atomic_store(&logLevel, LOG_WARN);
+        else if (strcasecmp(level, "error") == 0) atomic_store(&logLevel, LOG_ERROR);
+        else printf("📛 Unknown EXAMSYS_LOG_LEVEL '%s', using info\n", level);
+    }
+    if (atomic_load(&logLevel) < LOG_COMPILE_LEVEL) {
+        printf("📛 Debug logging was compiled out; rebuild with -DLOG_COMPILE_LEVEL=LOG_DEBUG\n");
+    }
+    logFile = fopen(path, "a");
+    if (logFile == NULL) {
+        perror("📛 Error opening log file");
+        return 0;
+    }
+    atomic_store(&logRunning, 1);
+    if (pthread_create(&logWriter, NULL, log_writer_run, NULL) != 0) {
+        perror("📛 Error creating log writer thread");
+        atomic_store(&logRunning, 0);
+        fclose(logFile);
+        logFile = NULL;
+        return 0;
+    }
+    atexit(log_shutdown);
+    return 1;
+}
+
+// Utility: Logs a hexadecimal dump of a memory buffer at debug level, 16 bytes per line
+void log_hexdump(const char *what, const void *data, size_t size) {
+#if LOG_COMPILE_LEVEL <= LOG_DEBUG
+    if (atomic_load_explicit(&logLevel, memory_order_relaxed) > LOG_DEBUG) return;
     const unsigned char *buf = (const unsigned char *)data;
-    for (size_t i = 0; i < size; i++) {
-        printf("%02x ", buf[i]);
-        if ((i + 1) % 16 == 0) printf("\n");
+    for (size_t i = 0; i < size; i += 16) {
+        char line[16 * 3 + 1];
+        int n = 0;
+        for (size_t j = i; j < size && j < i + 16; j++) n += sprintf(line + n, "%02x ", buf[j]);
+        line[n] = '\0';
+        log_debug("%s %04zx: %s", what, i, line);
     }
-    printf("\n");
+#else
+    (void)what;
+    (void)data;
+    (void)size;
+#endif
+}
+
+// Builds the path of one of an exam's files.
+void exam_path(Exam *e, const char *file, char *path, size_t size) {
+    snprintf(path, size, "%s/%s", e->dir, file);
+}
+
+// Writes an exam's rules in the format load_rules reads.
+void write_rules(Exam *e, FILE *fp) {
+    fprintf(fp, "Time limit per question: %d\nMarks awarded for correct answer: %.2f\nMarks deducted for incorrect answer: %.2f\n", 
+            e->answerTimeout, e->marksForCorrectAnswer, e->marksDeductedForWrongAnswer);
+    fprintf(fp, "Questions per paper (easy medium hard): %d %d %d\n", e->blueprint[0], e->blueprint[1], e->blueprint[2]);
+    fprintf(fp, "Adaptive paper (most questions, stop at standard error): %d %.2f\n", e->adaptiveLength, e->adaptiveSe);
 }
 
-// Loads exam rules (time limit, marking scheme) from file or creates default if missing
-void load_rules() {
-    FILE *fp = fopen(RULES_FILE, "r");
-    answerTimeout = 30;
-    marksForCorrectAnswer = 1.0;
-    marksDeductedForWrongAnswer = 0.25;
+// Loads an exam's rules (time limit, marking scheme, paper blueprint, adaptive papers) from
+// file or creates default if missing. Rules files without a blueprint line get the default
+// blueprint, and without an adaptive line fixed papers.
+void load_rules(Exam *e) {
+    char path[MAX_LINE];
+    exam_path(e, RULES_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    int blueprint[QBANK_LEVELS] = BLUEPRINT_DEFAULT;
+    e->answerTimeout = 30;
+    e->marksForCorrectAnswer = 1.0;
+    e->marksDeductedForWrongAnswer = 0.25;
+    memcpy(e->blueprint, blueprint, sizeof(blueprint));
+    e->adaptiveLength = 0;
+    e->adaptiveSe = ADAPTIVE_SE_DEFAULT;
 
     if (fp == NULL) {
         // File missing: create with defaults
-        printf("📛 Rules file not found, creating with defaults\n");
-        fp = fopen(RULES_FILE, "w");
+        printf("📛 Rules file %s not found, creating with defaults\n", path);
+        fp = fopen(path, "w");
         if (fp == NULL) {
             perror("📛 Error creating rules file");
             return;
         }
-        fprintf(fp, "Time limit per question: %d\nMarks awarded for correct answer: %.2f\nMarks deducted for incorrect answer: %.2f\n", 
-                answerTimeout, marksForCorrectAnswer, marksDeductedForWrongAnswer);
+        write_rules(e, fp);
         fclose(fp);
     } else {
         // File exists: read and validate each rule line
         char buffer[MAX_LINE];
-        printf("📜 Reading rules file:\n");
+        log_debug("📜 Reading rules file:");
+        if (fgets(buffer, MAX_LINE, fp)) {
+            log_debug("  %.*s", (int)strcspn(buffer, "\n"), buffer);
+            buffer[strcspn(buffer, "\n")] = '\0';
+            if (sscanf(buffer, "Time limit per question: %d", &e->answerTimeout) != 1 || 
+                e->answerTimeout <= 0 || e->answerTimeout > 3600) {
+                log_warn("📛 Invalid answerTimeout in file, using default: 30");
+                e->answerTimeout = 30;
+            }
+        }
         if (fgets(buffer, MAX_LINE, fp)) {
-            printf("  %s", buffer);
+            log_debug("  %.*s", (int)strcspn(buffer, "\n"), buffer);
             buffer[strcspn(buffer, "\n")] = '\0';
-            if (sscanf(buffer, "Time limit per question: %d", &answerTimeout) != 1 || 
-                answerTimeout <= 0 || answerTimeout > 3600) {
-                printf("📛 Invalid answerTimeout in file, using default: 30\n");
-                answerTimeout = 30;
+            if (sscanf(buffer, "Marks awarded for correct answer: %f", &e->marksForCorrectAnswer) != 1 || 
+                e->marksForCorrectAnswer <= 0 || e->marksForCorrectAnswer > 100) {
+                log_warn("📛 Invalid marksForCorrectAnswer in file, using default: 1.0");
+                e->marksForCorrectAnswer = 1.0;
             }
         }
         if (fgets(buffer, MAX_LINE, fp)) {
-            printf("  %s", buffer);
+            log_debug("  %.*s", (int)strcspn(buffer, "\n"), buffer);
             buffer[strcspn(buffer, "\n")] = '\0';
-            if (sscanf(buffer, "Marks awarded for correct answer: %f", &marksForCorrectAnswer) != 1 || 
-                marksForCorrectAnswer <= 0 || marksForCorrectAnswer > 100) {
-                printf("📛 Invalid marksForCorrectAnswer in file, using default: 1.0\n");
-                marksForCorrectAnswer = 1.0;
+            if (sscanf(buffer, "Marks deducted for incorrect answer: %f", &e->marksDeductedForWrongAnswer) != 1 || 
+                e->marksDeductedForWrongAnswer < 0 || e->marksDeductedForWrongAnswer > 100) {
+                log_warn("📛 Invalid marksDeductedForWrongAnswer in file, using default: 0.25");
+                e->marksDeductedForWrongAnswer = 0.25;
             }
         }
         if (fgets(buffer, MAX_LINE, fp)) {
-            printf("  %s", buffer);
+            log_debug("  %.*s", (int)strcspn(buffer, "\n"), buffer);
             buffer[strcspn(buffer, "\n")] = '\0';
-            if (sscanf(buffer, "Marks deducted for incorrect answer: %f", &marksDeductedForWrongAnswer) != 1 || 
-                marksDeductedForWrongAnswer < 0 || marksDeductedForWrongAnswer > 100) {
-                printf("📛 Invalid marksDeductedForWrongAnswer in file, using default: 0.25\n");
-                marksDeductedForWrongAnswer = 0.25;
+            int *b = e->blueprint;
+            if (sscanf(buffer, "Questions per paper (easy medium hard): %d %d %d", &b[0], &b[1], &b[2]) != 3 ||
+                b[0] < 0 || b[1] < 0 || b[2] < 0 || b[0] + b[1] + b[2] == 0 ||
+                b[0] + b[1] + b[2] > NUM_EXAM_QUESTIONS) {
+                log_warn("📛 Invalid paper blueprint in file, using default: %d %d %d", blueprint[0], blueprint[1], blueprint[2]);
+                memcpy(e->blueprint, blueprint, sizeof(blueprint));
+            }
+        }
+        if (fgets(buffer, MAX_LINE, fp)) {
+            log_debug("  %.*s", (int)strcspn(buffer, "\n"), buffer);
+            buffer[strcspn(buffer, "\n")] = '\0';
+            if (sscanf(buffer, "Adaptive paper (most questions, stop at standard error): %d %f",
+                       &e->adaptiveLength, &e->adaptiveSe) != 2 ||
+                e->adaptiveLength < 0 || e->adaptiveLength > PROTO_MAX_QUESTIONS ||
+                e->adaptiveSe <= 0 || e->adaptiveSe >= 1) {
+                log_warn("📛 Invalid adaptive paper settings in file, using fixed papers");
+                e->adaptiveLength = 0;
+                e->adaptiveSe = ADAPTIVE_SE_DEFAULT;
             }
         }
         fclose(fp);
     }
-    printf("📜 Loaded rules: Timeout=%d, Correct=%.2f, Wrong=%.2f\n", answerTimeout, marksForCorrectAnswer, marksDeductedForWrongAnswer);
+    printf("📜 Loaded rules for %s: Timeout=%d, Correct=%.2f, Wrong=%.2f, Paper=%d/%d/%d\n", e->code, e->answerTimeout,
+           e->marksForCorrectAnswer, e->marksDeductedForWrongAnswer, e->blueprint[0], e->blueprint[1], e->blueprint[2]);
+    if (e->adaptiveLength > 0) {
+        printf("🧭 Adaptive papers for %s: up to %d questions, stopping at a standard error of %.2f\n", e->code,
+               e->adaptiveLength, e->adaptiveSe);
+    }
 }
 
 // Utility: Removes leading/trailing whitespace and newline from a string
@@ -185,225 +1062,631 @@ void trim(char *s) {
     }
 }
 
-// Reads a non-empty, non-blank line from a file into buffer, skipping empty lines
-int read_nonempty_line(FILE *fp, char *buffer, int size) {
-    while (fgets(buffer, size, fp)) {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        char temp[MAX_LINE];
-        strcpy(temp, buffer);
-        char *start = temp;
-        while (*start && isspace((unsigned char)*start)) start++;
-        if (strlen(start) > 0) {
-            strcpy(buffer, start);
-            return 1;
-        }
+// Read epochs: registers a reader and returns the epoch to pass to read_epoch_exit. A reader
+// that registered while a writer moved the epoch on retries in the new one: the writer
+// waits only on the old epoch's counter, and a later writer only on the new one's, so a
+// reader counted under a stale epoch would be waited for by neither.
+unsigned long read_epoch_enter(ReadEpoch *g) {
+    while (1) {
+        unsigned long epoch = atomic_load(&g->epoch);
+        atomic_fetch_add(&g->readers[epoch & 1], 1);
+        if (atomic_load(&g->epoch) == epoch) return epoch;
+        atomic_fetch_sub(&g->readers[epoch & 1], 1);
     }
-    return 0;
 }
 
-// Loads questions from the question file into the questions array.
-// If file is missing or incomplete, creates default questions.
-void load_questions() {
-    FILE *fp = fopen(QUESTION_FILE, "r");
-    if (fp == NULL) {
-        // File missing: create with default question
-        printf("📛 Questions file not found, creating with default question\n");
-        fp = fopen(QUESTION_FILE, "w");
-        if (fp == NULL) {
-            perror("📛 Error creating questions file");
-            exit(EXIT_FAILURE);
-        }
-        fprintf(fp, "What is the default question?\nOption A\nOption B\nOption C\nOption D\nA\n1\n");
-        fclose(fp);
-        fp = fopen(QUESTION_FILE, "r");
-        if (fp == NULL) {
-            perror("📛 Error reopening questions file");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    char line[MAX_LINE];
-    int qIndex = 0;
-    int line_number = 0;
-    printf("📜 Reading questions file:\n");
-    while (qIndex < MAX_QUESTIONS) {
-        Question q = {0}; // Initialize to zero
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 EOF or error at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        strncpy(q.question, line, MAX_LINE - 1);
-        q.question[MAX_LINE - 1] = '\0';
+void read_epoch_exit(ReadEpoch *g, unsigned long epoch) {
+    atomic_fetch_sub(&g->readers[epoch & 1], 1);
+}
 
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 Missing optionA at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        strncpy(q.optionA, line, MAX_LINE - 1);
-        q.optionA[MAX_LINE - 1] = '\0';
+// Read epochs: called by a writer after replacing the shared pointer. Moves the epoch on
+// and returns once every reader that entered before has exited. Readers entering after
+// the move see the new pointer. Writers to one ReadEpoch must not overlap.
+void read_epoch_synchronize(ReadEpoch *g) {
+    unsigned long epoch = atomic_fetch_add(&g->epoch, 1);
+    while (atomic_load(&g->readers[epoch & 1]) > 0) {
+        struct timespec pause = { 0, 100 * 1000 };
+        nanosleep(&pause, NULL);
+    }
+}
 
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 Missing optionB at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        strncpy(q.optionB, line, MAX_LINE - 1);
-        q.optionB[MAX_LINE - 1] = '\0';
+// Bank snapshots: drops one reference and frees the version with the last one.
+void bank_release(BankSnapshot *b) {
+    if (b == NULL || atomic_fetch_sub(&b->refs, 1) != 1) return;
+    if (b->mapped) munmap(b->data, b->size);
+    else free(b->data);
+    irt_table_free(b->irt);
+    free(b);
+}
 
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 Missing optionC at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        strncpy(q.optionC, line, MAX_LINE - 1);
-        q.optionC[MAX_LINE - 1] = '\0';
+// Bank snapshots: takes a reference to the version a slot holds, or returns NULL if it holds
+// none, without locks. Acquires run inside the slot's read epoch, so bank_publish knows when
+// the old version can no longer be reached through the slot.
+BankSnapshot *bank_acquire(BankSlot *slot) {
+    unsigned long epoch = read_epoch_enter(&slot->guard);
+    BankSnapshot *b = atomic_load(&slot->current);
+    if (b != NULL) atomic_fetch_add(&b->refs, 1);
+    read_epoch_exit(&slot->guard, epoch);
+    return b;
+}
 
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 Missing optionD at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        strncpy(q.optionD, line, MAX_LINE - 1);
-        q.optionD[MAX_LINE - 1] = '\0';
+// Bank snapshots: makes fresh, whose reference passes to the slot, the version readers get,
+// then drops the slot's reference to the old one. Holders of the old version keep it until
+// they release it. Each slot has one publishing thread.
+void bank_publish(BankSlot *slot, BankSnapshot *fresh) {
+    BankSnapshot *old = atomic_exchange(&slot->current, fresh);
+    read_epoch_synchronize(&slot->guard);
+    bank_release(old);
+}
 
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 Missing correct answer at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        q.correct = toupper(line[0]);
+// Records the files a bank version is loaded from, before reading them, so a file written
+// while it is read is noticed by the next check.
+void bank_stamp(Exam *e, BankSnapshot *b) {
+    char path[MAX_LINE];
+    struct stat st;
+    exam_path(e, QUESTION_FILE, path, sizeof(path));
+    if (stat(path, &st) == 0) {
+        b->textMtime = st.st_mtim;
+        b->textSize = st.st_size;
+    }
+    exam_path(e, QBANK_FILE, path, sizeof(path));
+    if (stat(path, &st) == 0) {
+        b->qbcMtime = st.st_mtim;
+        b->qbcSize = st.st_size;
+    }
+}
 
-        line_number++;
-        if (!read_nonempty_line(fp, line, MAX_LINE)) {
-            printf("📛 Missing difficulty at line %d\n", line_number);
-            break;
-        }
-        printf("  Line %d: %s\n", line_number, line);
-        q.difficulty = atoi(line);
+// Returns 1 if an exam's question files changed since bank version b was loaded from them.
+int bank_changed(Exam *e, BankSnapshot *b) {
+    BankSnapshot now;
+    memset(&now, 0, sizeof(now));
+    bank_stamp(e, &now);
+    return now.textMtime.tv_sec != b->textMtime.tv_sec || now.textMtime.tv_nsec != b->textMtime.tv_nsec ||
+           now.textSize != b->textSize || now.qbcMtime.tv_sec != b->qbcMtime.tv_sec ||
+           now.qbcMtime.tv_nsec != b->qbcMtime.tv_nsec || now.qbcSize != b->qbcSize;
+}
 
-        // Validate question structure and content
-        if (q.question[0] == '\0' || q.optionA[0] == '\0' || q.optionB[0] == '\0' ||
-            q.optionC[0] == '\0' || q.optionD[0] == '\0' || !strchr("ABCD", q.correct) || q.difficulty < 1 || q.difficulty > 3) {
-            printf("📛 Skipping invalid question %d at line %d: %s\n", 
-                   qIndex + 1, line_number - 6, q.question[0] ? q.question : "<empty>");
-            continue;
-        }
+// Reports a problem loading a bank on out, or in the log when a background reload has no
+// terminal to report to.
+void bank_warn(FILE *out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void bank_warn(FILE *out, const char *fmt, ...) {
+    char msg[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    if (out) fprintf(out, "%s\n", msg);
+    else log_warn("%s", msg);
+}
 
-        questions[qIndex] = q;
-        printf("📚 Loaded question %d: %s (Correct: %c, Difficulty: %d)\n", 
-               qIndex + 1, q.question, q.correct, q.difficulty);
-        qIndex++;
+// Maps an exam's compiled bank if it has one that is not older than its text bank. Only the
+// header is read; pages of the bank are faulted in as papers use them and are shared with
+// every other process mapping the same file. Messages go to out unless it is NULL.
+// Returns 0 if the text bank should be loaded.
+int load_compiled_questions(Exam *e, BankSnapshot *b, FILE *out) {
+    char path[MAX_LINE], textPath[MAX_LINE];
+    exam_path(e, QBANK_FILE, path, sizeof(path));
+    exam_path(e, QUESTION_FILE, textPath, sizeof(textPath));
+    struct stat st, textSt;
+    if (stat(path, &st) < 0) return 0;
+    if (stat(textPath, &textSt) == 0 &&
+        (textSt.st_mtim.tv_sec > st.st_mtim.tv_sec ||
+         (textSt.st_mtim.tv_sec == st.st_mtim.tv_sec && textSt.st_mtim.tv_nsec > st.st_mtim.tv_nsec))) {
+        bank_warn(out, "📛 %s is older than %s; using the text bank. Run qbc to recompile it.", path, textPath);
+        return 0;
     }
 
-    totalQuestions = qIndex;
-    fclose(fp);
-    printf("📚 Total loaded questions: %d\n", totalQuestions);
-    // If not enough questions, add default ones
-    if (totalQuestions < NUM_EXAM_QUESTIONS) {
-        printf("📛 Warning: Not enough questions (%d < %d), adding default\n", totalQuestions, NUM_EXAM_QUESTIONS);
-        while (totalQuestions < NUM_EXAM_QUESTIONS && totalQuestions < MAX_QUESTIONS) {
-            Question default_q = {
-                .question = "What is the default question?",
-                .optionA = "Option A",
-                .optionB = "Option B",
-                .optionC = "Option C",
-                .optionD = "Option D",
-                .correct = 'A',
-                .difficulty = 1
-            };
-            questions[totalQuestions] = default_q;
-            printf("📚 Added default question %d: %s\n", totalQuestions + 1, default_q.question);
-            totalQuestions++;
-        }
-    }
-}
-
-// Verifies student credentials by matching roll and password from the student details file.
-// On success, copies the student's name and registration number to output parameters.
-int verify_student(const char *roll, const char *pass, char *name, char *reg_no) {
-    FILE *fp = fopen(STUDENT_FILE, "r");
-    if (fp == NULL) {
-        perror("📛 Error opening student details file");
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        bank_warn(out, "📛 Error opening %s: %s", path, strerror(errno));
         return 0;
     }
-    char fileName[50], fileRoll[50], fileRegNo[50], filePass[50];
-    int valid = 0;
-    while (fscanf(fp, "%49s %49s %49s %49s", fileName, fileRoll, fileRegNo, filePass) == 4) {
-        if (strcmp(fileRoll, roll) == 0 && strcmp(filePass, pass) == 0) {
-            strncpy(name, fileName, 49);
-            name[49] = '\0';
-            strncpy(reg_no, fileRegNo, 49);
-            reg_no[49] = '\0';
-            valid = 1;
-            break;
-        }
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        bank_warn(out, "📛 %s is empty; using the text bank", path);
+        close(fd);
+        return 0;
     }
-    fclose(fp);
-    return valid;
-}
-
-// Verifies instructor credentials by matching ID and password from the instructor details file.
-// On success, copies the instructor's name to the output parameter.
-int verify_instructor(const char *instructor_id, const char *pass, char *name) {
-    FILE *fp = fopen(INSTRUCTOR_FILE, "r");
-    if (fp == NULL) {
-        perror("📛 Error opening instructor details file");
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        bank_warn(out, "📛 Error mapping %s: %s", path, strerror(errno));
         return 0;
     }
-    char fileName[50], fileInstructorID[50], filePass[50];
-    int valid = 0;
-    while (fscanf(fp, "%49s %49s %49s", fileName, fileInstructorID, filePass) == 3) {
-        if (strcmp(fileInstructorID, instructor_id) == 0 && strcmp(filePass, pass) == 0) {
-            strncpy(name, fileName, 49);
-            name[49] = '\0';
-            valid = 1;
-            break;
-        }
+    // Papers pick questions all over the bank; read-ahead would only waste memory
+    madvise(map, st.st_size, MADV_RANDOM);
+    const char *problem = qbank_open(&b->bank, map, st.st_size);
+    if (problem != NULL) {
+        bank_warn(out, "📛 %s: %s; using the text bank", path, problem);
+        munmap(map, st.st_size);
+        return 0;
     }
-    fclose(fp);
-    return valid;
+    b->data = map;
+    b->size = st.st_size;
+    b->mapped = 1;
+    if (out) fprintf(out, "📚 Mapped %u compiled questions for %s in %.2f ms\n", b->bank.count, e->code, elapsed_us(&started) / 1000.0);
+    if (out && b->bank.count < NUM_EXAM_QUESTIONS) {
+        fprintf(out, "📛 Warning: Not enough questions (%u < %d)\n", b->bank.count, NUM_EXAM_QUESTIONS);
+    }
+    return 1;
 }
 
-// Appends a student's exam result to the results file, using file locking for concurrency safety.
-void append_result(DashboardStudent *s) {
-    FILE *fp = fopen(RESULT_FILE, "a");
-    if (fp == NULL) {
-        perror("📛 Error opening result file");
+// Draws a random seed, for an exam start or a bank version, from the kernel, or the clock if that fails.
+uint64_t start_seed_new() {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        uint64_t x = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+        seed = prng_splitmix(&x);
+    }
+    return seed;
+}
+
+// Calibrates the questions of an adaptive exam's bank version from the answers in its answer
+// file and builds the information tables its papers are chosen from. Each question starts
+// from a prior set by its difficulty level, so questions nobody has answered yet are still
+// usable. Answers are matched by question id and ids past the end of this version skipped,
+// which holds as long as questions are only added at the end of the bank. Without tables
+// the exam's papers fall back to the blueprint. Messages go to out unless it is NULL.
+void bank_calibrate(Exam *e, BankSnapshot *b, FILE *out) {
+    if (e->adaptiveLength == 0) return;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    uint32_t count = b->bank.count;
+    IrtTable *t = calloc(1, sizeof(IrtTable));
+    if (t != NULL) t->items = malloc(sizeof(IrtItem) * (count ? count : 1));
+    if (t == NULL || t->items == NULL) {
+        bank_warn(out, "📛 Out of memory calibrating %s; its papers follow the blueprint", e->code);
+        irt_table_free(t);
         return;
     }
-    int fd = fileno(fp);
-    struct flock lock;
-    memset(&lock, 0, sizeof(lock));
-    lock.l_type = F_WRLCK;
-    fcntl(fd, F_SETLKW, &lock);
+    t->count = count;
+    const double priorB[QBANK_LEVELS] = PRIOR_DIFFICULTY;
+    for (uint32_t i = 0; i < count; i++) {
+        const QBankRecord *rec = qbank_record(&b->bank, i);
+        int level = rec && rec->difficulty >= 1 && rec->difficulty <= QBANK_LEVELS ? rec->difficulty : 2;
+        t->items[i].a = 1.0f;
+        t->items[i].b = (float)priorB[level - 1];
+    }
 
-    fprintf(fp, "%s|%s|%d|%d|%d|%d|", 
-           s->roll, s->name, s->correctAnswers, s->totalQuestions, s->flagged, s->totalTime);
+    // Past answers: roll|qid|option|correct|ms|timestamp. Students are told apart by a hash
+    // of their roll number in an open-addressing table.
+    char path[MAX_LINE];
+    exam_path(e, ANSWER_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    IrtResponse *responses = NULL;
+    size_t n = 0, cap = 0;
+    uint64_t *keys = NULL;
+    uint32_t *ids = NULL;
+    uint32_t slots = 0, persons = 0;
+    int failed = 0;
+    char *line = NULL;
+    size_t lineCap = 0;
+    while (fp && !failed && getline(&line, &lineCap, fp) > 0) {
+        char *bar = strchr(line, '|');
+        unsigned int qid;
+        char option;
+        int correct;
+        if (bar == NULL || sscanf(bar + 1, "%u|%c|%d|", &qid, &option, &correct) != 3 || qid >= count) continue;
+        *bar = '\0';
+        if (persons * 2 >= slots) {
+            // Grow the roll table and rehash
+            uint32_t grown = slots ? slots * 2 : 1024;
+            uint64_t *newKeys = calloc(grown, sizeof(uint64_t));
+            uint32_t *newIds = malloc(sizeof(uint32_t) * grown);
+            if (newKeys == NULL || newIds == NULL) {
+                free(newKeys);
+                free(newIds);
+                failed = 1;
+                break;
+            }
+            for (uint32_t k = 0; k < slots; k++) {
+                if (keys[k] == 0) continue;
+                uint32_t at = (uint32_t)keys[k] & (grown - 1);
+                while (newKeys[at] != 0) at = (at + 1) & (grown - 1);
+                newKeys[at] = keys[k];
+                newIds[at] = ids[k];
+            }
+            free(keys);
+            free(ids);
+            keys = newKeys;
+            ids = newIds;
+            slots = grown;
+        }
+        uint64_t key = prng_hash(line, 0) | 1;
+        uint32_t at = (uint32_t)key & (slots - 1);
+        while (keys[at] != 0 && keys[at] != key) at = (at + 1) & (slots - 1);
+        if (keys[at] == 0) {
+            keys[at] = key;
+            ids[at] = persons++;
+        }
+        if (n == cap) {
+            size_t grown = cap ? cap * 2 : 4096;
+            IrtResponse *more = realloc(responses, sizeof(IrtResponse) * grown);
+            if (more == NULL) {
+                failed = 1;
+                break;
+            }
+            responses = more;
+            cap = grown;
+        }
+        responses[n].person = ids[at];
+        responses[n].item = qid;
+        responses[n].correct = correct != 0;
+        n++;
+    }
+    free(line);
+    free(keys);
+    free(ids);
+    if (fp) fclose(fp);
+    if (!failed) failed = !irt_calibrate(t->items, count, responses, n, persons);
+    free(responses);
+    if (failed || !irt_table_build(t, start_seed_new())) {
+        bank_warn(out, "📛 Out of memory calibrating %s; its papers follow the blueprint", e->code);
+        irt_table_free(t);
+        return;
+    }
+    b->irt = t;
+    if (out) {
+        fprintf(out, "📐 Calibrated %u questions for %s from %zu answers by %u students in %.1f ms\n", count, e->code,
+                n, persons, elapsed_us(&started) / 1000.0);
+    } else {
+        log_info("📐 Calibrated %u questions for %s from %zu answers by %u students in %.1f ms", count, e->code,
+                 n, persons, elapsed_us(&started) / 1000.0);
+    }
+}
 
-    for (int i = 0; i < s->totalQuestions; i++) {
-        fprintf(fp, "%d,", s->responseTimes[i]);
+// Loads a new version of an exam's bank: its compiled bank if it has one, otherwise its
+// question file parsed into a bank laid out in memory the same way, compact records plus one
+// string arena. If the file is missing or incomplete, default questions are created. An
+// adaptive exam's version is calibrated from its past answers as well. Messages go to out
+// unless it is NULL. Returns NULL if no bank could be loaded.
+BankSnapshot *bank_load(Exam *e, FILE *out) {
+    BankSnapshot *b = calloc(1, sizeof(BankSnapshot));
+    if (b == NULL) return NULL;
+    atomic_init(&b->refs, 1);
+    b->version = 1;
+    bank_stamp(e, b);
+    if (load_compiled_questions(e, b, out)) {
+        bank_calibrate(e, b, out);
+        return b;
     }
-    fprintf(fp, "\n");
 
-    lock.l_type = F_UNLCK;
-    fcntl(fd, F_SETLK, &lock);
+    char path[MAX_LINE];
+    exam_path(e, QUESTION_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        // File missing: create with default question
+        if (out) fprintf(out, "📛 Questions file %s not found, creating with default question\n", path);
+        fp = fopen(path, "w");
+        if (fp == NULL) {
+            log_error("📛 Error creating questions file %s: %s", path, strerror(errno));
+            free(b);
+            return NULL;
+        }
+        fprintf(fp, "What is the default question?\nOption A\nOption B\nOption C\nOption D\nA\n1\n");
+        fclose(fp);
+        fp = fopen(path, "r");
+        if (fp == NULL) {
+            log_error("📛 Error reopening questions file %s: %s", path, strerror(errno));
+            free(b);
+            return NULL;
+        }
+    }
+
+    QBankBuilder builder;
+    qb_init(&builder);
+    int skipped = qb_parse_text(&builder, fp, NULL);
     fclose(fp);
+    if (skipped > 0) {
+        log_warn("📛 Skipped %d invalid question(s) in %s; run qbc on it to see which", skipped, path);
+    }
+    if (out) fprintf(out, "📚 Total loaded questions for %s: %u\n", e->code, builder.count);
+    // If not enough questions, add default ones
+    if (builder.count < NUM_EXAM_QUESTIONS) {
+        if (out) fprintf(out, "📛 Warning: Not enough questions (%u < %d), adding default\n", builder.count, NUM_EXAM_QUESTIONS);
+        const char *texts[QBANK_FIELDS] = { "What is the default question?", "Option A", "Option B", "Option C", "Option D" };
+        size_t lens[QBANK_FIELDS];
+        for (int f = 0; f < QBANK_FIELDS; f++) lens[f] = strlen(texts[f]);
+        while (builder.count < NUM_EXAM_QUESTIONS && !builder.failed) {
+            qb_add(&builder, texts, lens, 'A', 1);
+            log_info("📚 Added default question %u: %s", builder.count, texts[0]);
+        }
+    }
+
+    b->data = qb_image(&builder, &b->size);
+    qb_free(&builder);
+    if (b->data == NULL || qbank_open(&b->bank, b->data, b->size) != NULL) {
+        log_error("📛 Out of memory loading questions for %s", e->code);
+        free(b->data);
+        free(b);
+        return NULL;
+    }
+    bank_calibrate(e, b, out);
+    return b;
 }
 
-// Loads all dashboard data (student results) from the results file into memory.
-void loadDashboardData() {
-    FILE *file = fopen(RESULT_FILE, "r");
-    if (file == NULL) return;
+// Loads an exam's bank at startup and publishes it as version 1.
+void load_questions(Exam *e) {
+    BankSnapshot *b = bank_load(e, stdout);
+    if (b == NULL) {
+        printf("📛 Could not load the questions of %s\n", e->code);
+        exit(EXIT_FAILURE);
+    }
+    bank_publish(&e->bank, b);
+}
+
+// Loads a new version of an exam's bank in the background and publishes it. Sessions keep
+// running on the version they hold; papers built after the swap use the new one.
+void reload_questions(Exam *e) {
+    BankSnapshot *current = bank_acquire(&e->bank);
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    BankSnapshot *fresh = bank_load(e, NULL);
+    if (fresh == NULL) {
+        log_warn("📛 Reloading the questions of %s failed; keeping version %u", e->code, current ? current->version : 0);
+        bank_release(current);
+        return;
+    }
+    fresh->version = current ? current->version + 1 : 1;
+    unsigned int version = fresh->version, count = fresh->bank.count;
+    bank_release(current);
+    bank_publish(&e->bank, fresh);
+    log_info("🔄 Reloaded %u questions for %s as version %u in %.1f ms", count, e->code, version,
+             elapsed_us(&started) / 1000.0);
+}
+
+// Credentials: builds an index from the current contents of a store's file. Returns NULL if
+// the file cannot be read. A roll or id listed twice keeps its first entry, as the old
+// linear scan did.
+CredIndex *cred_index_build(CredStore *store) {
+    FILE *fp = fopen(store->path, "r");
+    if (fp == NULL) {
+        log_error("📛 Error opening %s: %s", store->path, strerror(errno));
+        return NULL;
+    }
+    CredIndex *idx = calloc(1, sizeof(CredIndex));
+    int cap = 64;
+    if (idx == NULL || (idx->entries = malloc(cap * sizeof(Credential))) == NULL) {
+        log_error("📛 Out of memory indexing %s", store->path);
+        free(idx);
+        fclose(fp);
+        return NULL;
+    }
+    Credential c;
+    while (1) {
+        memset(&c, 0, sizeof(c));
+        if (store->fields == 4) {
+            if (fscanf(fp, "%49s %49s %49s %49s", c.name, c.id, c.reg_no, c.password) != 4) break;
+        } else if (store->fields == 1) {
+            if (fscanf(fp, "%49s", c.id) != 1) break;
+        } else {
+            if (fscanf(fp, "%49s %49s %49s", c.name, c.id, c.password) != 3) break;
+        }
+        if (idx->count == cap) {
+            Credential *grown = realloc(idx->entries, 2 * cap * sizeof(Credential));
+            if (grown == NULL) break;
+            idx->entries = grown;
+            cap *= 2;
+        }
+        idx->entries[idx->count++] = c;
+    }
+    fclose(fp);
+
+    unsigned int slots = 16;
+    while (slots < 2u * idx->count) slots *= 2;
+    idx->mask = slots - 1;
+    idx->slots = malloc(slots * sizeof(int));
+    if (idx->slots == NULL) {
+        log_error("📛 Out of memory indexing %s", store->path);
+        free(idx->entries);
+        free(idx);
+        return NULL;
+    }
+    memset(idx->slots, 0xff, slots * sizeof(int));
+    for (int i = 0; i < idx->count; i++) {
+        unsigned int h = roll_hash(idx->entries[i].id) & idx->mask;
+        while (idx->slots[h] >= 0 && strcmp(idx->entries[idx->slots[h]].id, idx->entries[i].id) != 0) {
+            h = (h + 1) & idx->mask;
+        }
+        if (idx->slots[h] >= 0) {
+            log_warn("📛 %s lists %s more than once; keeping the first", store->path, idx->entries[i].id);
+            continue;
+        }
+        idx->slots[h] = i;
+    }
+    return idx;
+}
+
+void cred_index_free(CredIndex *idx) {
+    if (idx == NULL) return;
+    free(idx->slots);
+    free(idx->entries);
+    free(idx);
+}
+
+// Credentials: publishes a new index and frees the old one once no lookup can still see it.
+// Lookups run inside the store's read epoch. Only one thread swaps at a time: main at
+// startup, then the reload thread.
+void cred_store_swap(CredStore *store, CredIndex *fresh) {
+    CredIndex *old = atomic_exchange(&store->index, fresh);
+    read_epoch_synchronize(&store->guard);
+    cred_index_free(old);
+}
+
+// Credentials: the identity of a store's file version, to notice edits and replacements.
+int cred_file_stat(CredStore *store, struct stat *st) {
+    return stat(store->path, st);
+}
+
+// Credentials: (re)loads a store from its file. Returns the number of accounts, or -1 if the
+// file could not be read, in which case the index in use is kept.
+int cred_store_load(CredStore *store) {
+    struct stat st;
+    if (cred_file_stat(store, &st) < 0) {
+        log_error("📛 Error opening %s: %s", store->path, strerror(errno));
+        return -1;
+    }
+    CredIndex *fresh = cred_index_build(store);
+    if (fresh == NULL) return -1;
+    store->mtime = st.st_mtim;
+    store->size = st.st_size;
+    store->ino = st.st_ino;
+    int count = fresh->count;
+    cred_store_swap(store, fresh);
+    return count;
+}
+
+// Credentials: whether a store's file differs from the version loaded, by its identity.
+int cred_store_stale(CredStore *store, const struct stat *st) {
+    return st->st_mtim.tv_sec != store->mtime.tv_sec || st->st_mtim.tv_nsec != store->mtime.tv_nsec ||
+           st->st_size != store->size || st->st_ino != store->ino;
+}
+
+// Credentials: finds an id in an index. Returns NULL if it is not listed.
+Credential *cred_index_find(CredIndex *idx, const char *id) {
+    unsigned int h = roll_hash(id) & idx->mask;
+    for (int slot; (slot = idx->slots[h]) >= 0; h = (h + 1) & idx->mask) {
+        if (strcmp(idx->entries[slot].id, id) == 0) return &idx->entries[slot];
+    }
+    return NULL;
+}
+
+// Credentials: looks up an account and checks its password without locks or disk access.
+// On success the account is copied to out.
+int cred_lookup(CredStore *store, const char *id, const char *pass, Credential *out) {
+    unsigned long epoch = read_epoch_enter(&store->guard);
+    CredIndex *idx = atomic_load(&store->index);
+    Credential *c = idx ? cred_index_find(idx, id) : NULL;
+    int found = c != NULL && strcmp(c->password, pass) == 0;
+    if (found) *out = *c;
+    read_epoch_exit(&store->guard, epoch);
+    return found;
+}
+
+// Rosters: (re)loads an exam's roster, or drops it when the file is gone, so everyone may
+// sit the exam again. Returns the number of rolls, or -1 if there is no roster.
+int roster_load(Exam *e) {
+    struct stat st;
+    if (cred_file_stat(&e->roster, &st) < 0) {
+        if (atomic_load(&e->roster.index) != NULL) {
+            cred_store_swap(&e->roster, NULL);
+            memset(&e->roster.mtime, 0, sizeof(e->roster.mtime));
+            e->roster.size = 0;
+            e->roster.ino = 0;
+            log_info("🔄 Roster of %s removed; every student may sit it", e->code);
+        }
+        return -1;
+    }
+    return cred_store_load(&e->roster);
+}
+
+// Reload thread: polls the credential files and every exam's roster and question files, and
+// swaps in a fresh version of one when its files change. Accounts added during an exam can
+// log in, and questions added to a bank reach the next start, without a restart or a pause.
+void *reload_run(void *arg) {
+    (void)arg;
+    CredStore *stores[] = { &studentCreds, &instructorCreds };
+    while (1) {
+        struct timespec pause = { RELOAD_POLL_SECONDS, 0 };
+        nanosleep(&pause, NULL);
+        for (int i = 0; i < 2; i++) {
+            CredStore *store = stores[i];
+            struct stat st;
+            if (cred_file_stat(store, &st) < 0 || !cred_store_stale(store, &st)) continue;
+            int count = cred_store_load(store);
+            if (count >= 0) log_info("🔄 Reloaded %d accounts from %s", count, store->path);
+        }
+        for (int i = 0; i < examCount; i++) {
+            CredStore *roster = &exams[i]->roster;
+            struct stat st;
+            int present = cred_file_stat(roster, &st) == 0;
+            if (present ? !cred_store_stale(roster, &st) : atomic_load(&roster->index) == NULL) continue;
+            int count = roster_load(exams[i]);
+            if (count >= 0) log_info("🔄 Reloaded %d roll(s) from %s", count, roster->path);
+        }
+        for (int i = 0; i < examCount; i++) {
+            BankSnapshot *b = bank_acquire(&exams[i]->bank);
+            int changed = b != NULL && bank_changed(exams[i], b);
+            bank_release(b);
+            if (changed) reload_questions(exams[i]);
+        }
+    }
+    return NULL;
+}
+
+// Verifies student credentials against the in-memory index of the student details file.
+// On success, copies the student's name and registration number to output parameters.
+int verify_student(const char *roll, const char *pass, char *name, char *reg_no) {
+    Credential c;
+    if (!cred_lookup(&studentCreds, roll, pass, &c)) return 0;
+    memcpy(name, c.name, 50);
+    memcpy(reg_no, c.reg_no, 50);
+    return 1;
+}
+
+// Checks an exam's roster against its in-memory index. Without a roster file every student
+// may sit the exam.
+int roster_allows(Exam *e, const char *roll) {
+    CredStore *store = &e->roster;
+    unsigned long epoch = read_epoch_enter(&store->guard);
+    CredIndex *idx = atomic_load(&store->index);
+    int allowed = idx == NULL || cred_index_find(idx, roll) != NULL;
+    read_epoch_exit(&store->guard, epoch);
+    return allowed;
+}
+
+// Verifies instructor credentials against the in-memory index of the instructor details file.
+// On success, copies the instructor's name to the output parameter.
+int verify_instructor(const char *instructor_id, const char *pass, char *name) {
+    Credential c;
+    if (!cred_lookup(&instructorCreds, instructor_id, pass, &c)) return 0;
+    memcpy(name, c.name, 50);
+    return 1;
+}
+
+// Appends a student's exam result to the exam's results file, using file locking for concurrency safety.
+void append_result(Exam *e, DashboardStudent *s) {
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    char path[MAX_LINE];
+    exam_path(e, RESULT_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "a");
+    if (fp == NULL) {
+        log_error("📛 Error opening result file: %s", strerror(errno));
+        return;
+    }
+    int fd = fileno(fp);
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    fcntl(fd, F_SETLKW, &lock);
+
+    fprintf(fp, "%s|%s|%d|%d|%d|%d|", 
+           s->roll, s->name, s->correctAnswers, s->totalQuestions, s->flagged, s->totalTime);
+
+    for (int i = 0; i < s->answeredCount; i++) {
+        fprintf(fp, "%d,", s->responseTimes[i]);
+    }
+    fprintf(fp, "\n");
+
+    lock.l_type = F_UNLCK;
+    fcntl(fd, F_SETLK, &lock);
+    fclose(fp);
+    metrics_count(&metrics.results, 1);
+    hist_record(&metrics.resultAppend, elapsed_us(&started));
+}
+
+// Loads all dashboard data (student results) of an exam from its results file into memory.
+void loadDashboardData(Exam *e) {
+    char path[MAX_LINE];
+    exam_path(e, RESULT_FILE, path, sizeof(path));
+    studentCount = 0;
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return;
 
-    studentCount = 0;
     char line[MAX_LINE];
     while (fgets(line, sizeof(line), file) && studentCount < MAX_STUDENTS) {
         DashboardStudent *s = &dashboardStudents[studentCount];
@@ -423,12 +1706,14 @@ void loadDashboardData() {
         token = strtok(NULL, "|");
         s->totalTime = atoi(token);
 
-        char *timeToken = strtok(NULL, ",");
+        // One time per answered question; a paper the student did not finish lists fewer
+        char *timeToken = strtok(NULL, ",\n");
         int i = 0;
-        while (timeToken != NULL && i < NUM_EXAM_QUESTIONS) {
+        while (timeToken != NULL && i < PROTO_MAX_QUESTIONS) {
             s->responseTimes[i++] = atoi(timeToken);
-            timeToken = strtok(NULL, ",");
+            timeToken = strtok(NULL, ",\n");
         }
+        s->answeredCount = i;
 
         studentCount++;
     }
@@ -438,7 +1723,7 @@ void loadDashboardData() {
 // Flags students as suspicious if any of their response times are below 2 seconds.
 void flagSuspiciousActivity() {
     for (int i = 0; i < studentCount; ++i) {
-        for (int j = 0; j < dashboardStudents[i].totalQuestions; ++j) {
+        for (int j = 0; j < dashboardStudents[i].answeredCount; ++j) {
             if (dashboardStudents[i].responseTimes[j] < 2) {
                 dashboardStudents[i].flagged = 1;
                 break;
@@ -447,395 +1732,3070 @@ void flagSuspiciousActivity() {
     }
 }
 
-// Ranks students in the dashboard by number of correct answers (descending).
-void rankStudents() {
-    for (int i = 0; i < studentCount - 1; ++i) {
-        for (int j = 0; j < studentCount - i - 1; ++j) {
-            if (dashboardStudents[j].correctAnswers < dashboardStudents[j + 1].correctAnswers) {
-                DashboardStudent temp = dashboardStudents[j];
-                dashboardStudents[j] = dashboardStudents[j + 1];
-                dashboardStudents[j + 1] = temp;
-            }
-        }
+// Ranks students in the dashboard by number of correct answers (descending).
+void rankStudents() {
+    for (int i = 0; i < studentCount - 1; ++i) {
+        for (int j = 0; j < studentCount - i - 1; ++j) {
+            if (dashboardStudents[j].correctAnswers < dashboardStudents[j + 1].correctAnswers) {
+                DashboardStudent temp = dashboardStudents[j];
+                dashboardStudents[j] = dashboardStudents[j + 1];
+                dashboardStudents[j + 1] = temp;
+            }
+        }
+    }
+
+    for (int i = 0; i < studentCount; ++i) {
+        dashboardStudents[i].rank = i + 1;
+    }
+}
+
+// Displays an exam's dashboard with student ranks, times, accuracy, and flagged status.
+void displayDashboard(Exam *e) {
+    loadDashboardData(e);
+    flagSuspiciousActivity();
+    rankStudents();
+
+    printf("\n\n--------------------------------------------------\n");
+    printf("| 🏫 Exam %-40s |\n", e->code);
+    printf("--------------------------------------------------\n");
+    printf("| Rank | Name         | Total Time | Accuracy | Flagged |\n");
+    printf("--------------------------------------------------\n");
+
+    for (int i = 0; i < studentCount; ++i) {
+        float accuracy = dashboardStudents[i].totalQuestions > 0 ? 
+            (float)dashboardStudents[i].correctAnswers / dashboardStudents[i].totalQuestions * 100 : 0;
+        printf("| %-4d | %-12s | %-10d | %-8.2f | %-7s |\n",
+               dashboardStudents[i].rank,
+               dashboardStudents[i].name,
+               dashboardStudents[i].totalTime,
+               accuracy,
+               dashboardStudents[i].flagged ? "🚩" : "✅");
+    }
+    printf("--------------------------------------------------\n");
+}
+
+// Prompts instructor to add a new question and appends it to the exam's question file after validation.
+void add_question(Exam *e) {
+    char path[MAX_LINE];
+    exam_path(e, QUESTION_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "a");
+    if (fp == NULL) {
+        perror("📛 Error opening questions file");
+        return;
+    }
+
+    // Read without a length cap; the text bank allows up to QBANK_MAX_TEXT bytes per line
+    const char *prompts[QBANK_FIELDS] = {
+        "📝 Enter the question: ", "🅰️  Enter option A: ", "🅱️  Enter option B: ", "©️  Enter option C: ", "🅳  Enter option D: "
+    };
+    char *texts[QBANK_FIELDS] = {0};
+    size_t caps[QBANK_FIELDS] = {0};
+    int valid = 1;
+    clear_input_buffer();
+    for (int f = 0; f < QBANK_FIELDS; f++) {
+        printf("%s", prompts[f]);
+        if (getline(&texts[f], &caps[f], stdin) < 0) {
+            valid = 0;
+            break;
+        }
+        trim(texts[f]);
+        if (texts[f][0] == '\0' || strlen(texts[f]) > QBANK_MAX_TEXT) valid = 0;
+    }
+
+    char correct = 0;
+    int difficulty = 0;
+    if (valid) {
+        printf("✅ Enter the correct option (A/B/C/D): ");
+        scanf(" %c", &correct);
+        correct = toupper(correct);
+
+        printf("📊 Enter difficulty level (1=Easy, 2=Medium, 3=Hard): ");
+        scanf("%d", &difficulty);
+    }
+
+    if (!valid || !strchr("ABCD", correct) || correct == '\0' || difficulty < 1 || difficulty > 3) {
+        printf("📛 Invalid question data, not added\n");
+        for (int f = 0; f < QBANK_FIELDS; f++) free(texts[f]);
+        fclose(fp);
+        return;
+    }
+
+    fprintf(fp, "%s\n%s\n%s\n%s\n%s\n%c\n%d\n", texts[0], texts[1], texts[2], texts[3], texts[4], correct, difficulty);
+    for (int f = 0; f < QBANK_FIELDS; f++) free(texts[f]);
+
+    fclose(fp);
+    printf("🎉 Question added successfully! Papers of the next start will include it.\n");
+    BankSnapshot *b = bank_acquire(&e->bank);
+    if (b->mapped) printf("📛 %s uses a compiled bank; run qbc to include the new question\n", e->code);
+    bank_release(b);
+}
+
+// Sets an exam's time limit per question and updates its rules file.
+void set_time_limit(Exam *e) {
+    int new_time;
+    printf("⏱️  Enter the new time limit for each question (in seconds): ");
+    scanf("%d", &new_time);
+    if (new_time <= 0 || new_time > 3600) {
+        printf("📛 Invalid time limit, using default: 30 seconds\n");
+        new_time = 30;
+    }
+    e->answerTimeout = new_time;
+
+    char path[MAX_LINE];
+    exam_path(e, RULES_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("📛 Error writing rules file");
+        return;
+    }
+    write_rules(e, fp);
+    fclose(fp);
+    printf("🔄 Time limit set to %d seconds.\n", e->answerTimeout);
+}
+
+// Sets an exam's marking scheme for correct and wrong answers, and updates its rules file.
+void set_marking_scheme(Exam *e) {
+    printf("➕ Enter marks for correct answer: ");
+    scanf("%f", &e->marksForCorrectAnswer);
+    if (e->marksForCorrectAnswer <= 0 || e->marksForCorrectAnswer > 100) {
+        printf("📛 Invalid marks, using default: 1.0\n");
+        e->marksForCorrectAnswer = 1.0;
+    }
+    printf("➖ Enter marks deducted for wrong answer: ");
+    scanf("%f", &e->marksDeductedForWrongAnswer);
+    if (e->marksDeductedForWrongAnswer < 0 || e->marksDeductedForWrongAnswer > 100) {
+        printf("📛 Invalid marks, using default: 0.25\n");
+        e->marksDeductedForWrongAnswer = 0.25;
+    }
+
+    char path[MAX_LINE];
+    exam_path(e, RULES_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("📛 Error writing rules file");
+        return;
+    }
+    write_rules(e, fp);
+    fclose(fp);
+    printf("🔄 Marking scheme updated: +%.2f for correct, -%.2f for wrong.\n", 
+           e->marksForCorrectAnswer, e->marksDeductedForWrongAnswer);
+}
+
+// Timer wheel: starts or stops the periodic tick. The wheel only ticks while it has timers.
+void wheel_arm(TimerWheel *w, int on) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (on) {
+        spec.it_value.tv_nsec = TIMER_TICK_MS * 1000000L;
+        spec.it_interval = spec.it_value;
+    }
+    if (timerfd_settime(w->fd, 0, &spec, NULL) < 0) {
+        log_error("📛 Error setting loop timer: %s", strerror(errno));
+    }
+}
+
+// Timer wheel: links a timer into the level and slot matching how far off it is.
+void wheel_place(TimerWheel *w, Timer *t) {
+    unsigned long long delta = t->expires - w->now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (1ULL << (TIMER_SLOT_BITS * (level + 1)))) level++;
+    if (level == TIMER_LEVELS - 1 && delta >= (1ULL << (TIMER_SLOT_BITS * TIMER_LEVELS))) {
+        t->expires = w->now + (1ULL << (TIMER_SLOT_BITS * TIMER_LEVELS)) - 1;
+    }
+    Timer **slot = &w->slots[level][(t->expires >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)];
+    t->slot = slot;
+    t->prev = NULL;
+    t->next = *slot;
+    if (*slot) (*slot)->prev = t;
+    *slot = t;
+}
+
+// Timer wheel: removes a scheduled timer from its slot.
+void wheel_unlink(Timer *t) {
+    if (t->prev) t->prev->next = t->next;
+    else *t->slot = t->next;
+    if (t->next) t->next->prev = t->prev;
+    t->prev = t->next = NULL;
+    t->slot = NULL;
+}
+
+// Schedules (or reschedules) a timer to fire after ms milliseconds, rounded up to a tick.
+void timer_schedule(TimerWheel *w, Timer *t, long ms) {
+    if (t->active) {
+        wheel_unlink(t);
+    } else {
+        t->active = 1;
+        if (w->count++ == 0) wheel_arm(w, 1);
+    }
+    long ticks = (ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    t->expires = w->now + (ticks < 1 ? 1 : ticks);
+    wheel_place(w, t);
+}
+
+// Cancels a timer if it is scheduled.
+void timer_cancel(TimerWheel *w, Timer *t) {
+    if (!t->active) return;
+    wheel_unlink(t);
+    t->active = 0;
+    w->count--;
+}
+
+// Timer wheel: advances one tick. When level 0 wraps, the next slot of each higher level
+// is redistributed downwards first; then every timer due at the new tick fires.
+void wheel_tick(TimerWheel *w) {
+    w->now++;
+    for (int level = 1; level < TIMER_LEVELS; level++) {
+        if ((w->now >> (TIMER_SLOT_BITS * (level - 1))) & (TIMER_SLOTS - 1)) break;
+        Timer **slot = &w->slots[level][(w->now >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)];
+        Timer *t = *slot;
+        *slot = NULL;
+        while (t != NULL) {
+            Timer *next = t->next;
+            wheel_place(w, t);
+            t = next;
+        }
+    }
+    Timer **slot = &w->slots[0][w->now & (TIMER_SLOTS - 1)];
+    while (*slot != NULL) {
+        Timer *t = *slot;
+        wheel_unlink(t);
+        t->active = 0;
+        w->count--;
+        t->fire(t);
+    }
+}
+
+// Timer wheel: handles the timerfd becoming readable, catching up on missed ticks.
+void wheel_on_timerfd(TimerWheel *w) {
+    uint64_t ticks;
+    if (read(w->fd, &ticks, sizeof(ticks)) != sizeof(ticks)) return;
+    while (ticks-- > 0 && w->count > 0) wheel_tick(w);
+    if (w->count == 0) wheel_arm(w, 0);
+}
+
+// Queues a completed item on its loop and wakes the loop to run it.
+void loop_post_done(WorkItem *item) {
+    EventLoop *loop = item->loop;
+    item->next = NULL;
+    pthread_mutex_lock(&loop->done_mutex);
+    if (loop->done_tail) loop->done_tail->next = item;
+    else loop->done_head = item;
+    loop->done_tail = item;
+    pthread_mutex_unlock(&loop->done_mutex);
+    uint64_t one = 1;
+    if (write(loop->wakefd, &one, sizeof(one)) != sizeof(one)) {
+        log_error("📛 Error waking event loop: %s", strerror(errno));
+    }
+}
+
+// Worker thread: takes items off the queue, runs them, and hands completions back to their loop.
+void *worker_run(void *arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&pool.mutex);
+        while (pool.head == NULL) {
+            pthread_cond_wait(&pool.cond, &pool.mutex);
+        }
+        WorkItem *item = pool.head;
+        pool.head = item->next;
+        if (pool.head == NULL) pool.tail = NULL;
+        pool.depth--;
+        pthread_mutex_unlock(&pool.mutex);
+
+        item->run(item);
+
+        long long latency = elapsed_us(&item->queued);
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && latency >= (1LL << bucket)) bucket++;
+        pthread_mutex_lock(&pool.mutex);
+        pool.completed++;
+        pool.totalLatencyUs += latency;
+        if (latency > pool.maxLatencyUs) pool.maxLatencyUs = latency;
+        pool.latencyBuckets[bucket]++;
+        pthread_mutex_unlock(&pool.mutex);
+
+        if (item->done) loop_post_done(item);
+        else free(item);
+    }
+    return NULL;
+}
+
+// Starts the worker threads. Returns 0 if none could be started.
+int worker_pool_init() {
+    memset(&pool, 0, sizeof(pool));
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.cond, NULL);
+    int started = 0;
+    for (int i = 0; i < WORKER_THREADS; i++) {
+        if (pthread_create(&pool.threads[i], NULL, worker_run, NULL) != 0) {
+            perror("📛 Error creating worker thread");
+            continue;
+        }
+        pthread_detach(pool.threads[i]);
+        started++;
+    }
+    return started > 0;
+}
+
+// Queues blocking work for the pool. The item must be heap-allocated.
+void worker_pool_submit(WorkItem *item) {
+    clock_gettime(CLOCK_MONOTONIC, &item->queued);
+    item->next = NULL;
+    pthread_mutex_lock(&pool.mutex);
+    if (pool.tail) pool.tail->next = item;
+    else pool.head = item;
+    pool.tail = item;
+    pool.depth++;
+    pool.submitted++;
+    if (pool.depth > pool.maxDepth) pool.maxDepth = pool.depth;
+    pthread_cond_signal(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+// Sets up login pacing at rate logins per second with room for a burst. A rate of 0 turns
+// pacing off.
+void admission_init(double rate, double burst) {
+    memset(&admission, 0, sizeof(admission));
+    pthread_mutex_init(&admission.mutex, NULL);
+    pthread_cond_init(&admission.cond, NULL);
+    admission.rate = rate;
+    admission.burst = burst < 1 ? 1 : burst;
+    admission.tokens = admission.burst;
+    clock_gettime(CLOCK_MONOTONIC, &admission.refilled);
+}
+
+// Adds the tokens earned since the last refill. Called with the admission mutex held.
+void admission_refill() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - admission.refilled.tv_sec) + (now.tv_nsec - admission.refilled.tv_nsec) / 1e9;
+    admission.refilled = now;
+    admission.tokens += elapsed * admission.rate;
+    if (admission.tokens > admission.burst) admission.tokens = admission.burst;
+}
+
+// Passes a login to the worker pool, straight away if a token is free and nobody is queued,
+// otherwise behind the logins already waiting. Returns 0 if it was admitted at once, its
+// position in the queue if it waits, or -1 if the queue is full. waitSeconds receives the
+// estimated wait in the last two cases.
+int admission_submit(WorkItem *item, int *waitSeconds) {
+    if (admission.rate <= 0) {
+        worker_pool_submit(item);
+        return 0;
+    }
+    pthread_mutex_lock(&admission.mutex);
+    admission_refill();
+    if (admission.head == NULL && admission.tokens >= 1) {
+        admission.tokens -= 1;
+        admission.admitted++;
+        pthread_mutex_unlock(&admission.mutex);
+        worker_pool_submit(item);
+        return 0;
+    }
+    double wait = (admission.depth + 1 - admission.tokens) / admission.rate;
+    *waitSeconds = (int)wait + 1;
+    if (wait > ADMISSION_MAX_WAIT) {
+        admission.turnedAway++;
+        pthread_mutex_unlock(&admission.mutex);
+        return -1;
+    }
+    item->next = NULL;
+    if (admission.tail) admission.tail->next = item;
+    else admission.head = item;
+    admission.tail = item;
+    int position = ++admission.depth;
+    if (admission.depth > admission.maxDepth) admission.maxDepth = admission.depth;
+    pthread_cond_signal(&admission.cond);
+    pthread_mutex_unlock(&admission.mutex);
+    return position;
+}
+
+// Admission thread: hands queued logins to the worker pool in arrival order, one per token,
+// sleeping until the next token is due.
+void *admission_run(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&admission.mutex);
+    while (1) {
+        while (admission.head == NULL) {
+            pthread_cond_wait(&admission.cond, &admission.mutex);
+        }
+        admission_refill();
+        if (admission.tokens < 1) {
+            long long ns = (long long)((1 - admission.tokens) / admission.rate * 1e9) + 1;
+            struct timespec pause = { ns / 1000000000LL, ns % 1000000000LL };
+            pthread_mutex_unlock(&admission.mutex);
+            nanosleep(&pause, NULL);
+            pthread_mutex_lock(&admission.mutex);
+            continue;
+        }
+        WorkItem *item = admission.head;
+        admission.head = item->next;
+        if (admission.head == NULL) admission.tail = NULL;
+        admission.depth--;
+        admission.tokens -= 1;
+        admission.admitted++;
+        pthread_mutex_unlock(&admission.mutex);
+        worker_pool_submit(item);
+        pthread_mutex_lock(&admission.mutex);
+    }
+    return NULL;
+}
+
+// Returns the smallest bucket bound covering the given fraction of completed items.
+long long worker_pool_percentile(double fraction) {
+    long target = (long)(pool.completed * fraction);
+    long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += pool.latencyBuckets[i];
+        if (seen > target) return 1LL << i;
+    }
+    return pool.maxLatencyUs;
+}
+
+// Orders microsecond delays for qsort.
+int compare_delays(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Prints how long an exam's last start took to reach every student: the time from the
+// instructor starting the exam until each student's START frame had fully left the server.
+void display_fanout_stats(Exam *e) {
+    pthread_mutex_lock(&e->fanout.mutex);
+    int delivered = e->fanout.delivered;
+    int target = e->fanout.target;
+    long long *sorted = delivered > 0 ? malloc(delivered * sizeof(long long)) : NULL;
+    if (sorted) memcpy(sorted, e->fanout.delaysUs, delivered * sizeof(long long));
+    pthread_mutex_unlock(&e->fanout.mutex);
+
+    if (target == 0) return;
+    printf("| START delivered      : %-10d / %-10d |\n", delivered, target);
+    if (sorted == NULL) return;
+    qsort(sorted, delivered, sizeof(long long), compare_delays);
+    printf("| Start skew p50       : %-20lld us |\n", sorted[(delivered - 1) / 2]);
+    printf("| Start skew p99       : %-20lld us |\n", sorted[(int)((delivered - 1) * 0.99)]);
+    printf("| Start skew max       : %-20lld us |\n", sorted[delivered - 1]);
+    printf("| First to last start  : %-20lld us |\n", sorted[delivered - 1] - sorted[0]);
+    free(sorted);
+}
+
+// Shows connection accept totals and rates across all acceptor threads.
+void display_accept_stats() {
+    long accepted = 0, errors = 0, peak = 0;
+    for (int i = 0; i < acceptorCount; i++) {
+        accepted += atomic_load(&acceptors[i].accepted);
+        errors += atomic_load(&acceptors[i].errors);
+        // Acceptors run side by side, so the sum of their peaks bounds the combined peak
+        peak += atomic_load(&acceptors[i].peakPerSecond);
+    }
+    long long upUs = elapsed_us(&serverStarted);
+    printf("| Acceptor threads     : %-23d |\n", acceptorCount);
+    printf("| Connections accepted : %-23ld |\n", accepted);
+    printf("| Accept errors        : %-23ld |\n", errors);
+    printf("| Accept rate avg      : %-19.1f /s |\n", upUs > 0 ? accepted * 1000000.0 / upUs : 0.0);
+    printf("| Accept rate peak     : %-19ld /s |\n", peak);
+}
+
+// Describes where an exam is in its lifecycle.
+const char *exam_status(Exam *e) {
+    if (!atomic_load(&e->started)) return "waiting";
+    if (e->duration * 1000000LL - elapsed_us(&e->startedAt) > 0) return "running";
+    return "over";
+}
+
+// Lists every hosted exam with its loops and student counts.
+void display_exam_table() {
+    printf("| %-10s | %-7s | %-5s | %-5s | %-5s | %-4s |\n", "Exam", "Status", "Loops", "Reg", "In", "Drop");
+    printf("--------------------------------------------------\n");
+    for (int i = 0; i < examCount; i++) {
+        Exam *e = exams[i];
+        char loopRange[16];
+        snprintf(loopRange, sizeof(loopRange), "%d-%d", e->firstLoop, e->firstLoop + e->loopSpan - 1);
+        printf("| %-10.10s | %-7s | %-5s | %-5d | %-5d | %-4d |\n", e->code, exam_status(e), loopRange,
+               atomic_load(&e->registered), atomic_load(&e->inProgress), atomic_load(&e->suspended));
+    }
+    printf("--------------------------------------------------\n");
+}
+
+// Prints worker pool queue depth, task latency and exam start skew, used to size the server for a hall.
+void display_server_stats() {
+    int count = atomic_load(&registryCount);
+
+    pthread_mutex_lock(&pool.mutex);
+    printf("\n--------------------------------------------------\n");
+    printf("| 📊 Server Statistics                           |\n");
+    printf("--------------------------------------------------\n");
+    printf("| Event loops          : %-23d |\n", loopCount);
+    printf("| Registered students  : %-23d |\n", count);
+    printf("| Worker threads       : %-23d |\n", WORKER_THREADS);
+    printf("| Queue depth (now/max): %-10d / %-10d |\n", pool.depth, pool.maxDepth);
+    printf("| Tasks submitted      : %-23ld |\n", pool.submitted);
+    printf("| Tasks completed      : %-23ld |\n", pool.completed);
+    if (pool.completed > 0) {
+        printf("| Task latency avg     : %-20lld us |\n", pool.totalLatencyUs / pool.completed);
+        printf("| Task latency p50     : <%-19lld us |\n", worker_pool_percentile(0.50));
+        printf("| Task latency p99     : <%-19lld us |\n", worker_pool_percentile(0.99));
+        printf("| Task latency max     : %-20lld us |\n", pool.maxLatencyUs);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    if (atomic_load(&metrics.loginLatency.count) > 0) {
+        printf("| Login latency p50    : <%-19llu us |\n", hist_percentile(&metrics.loginLatency, 0.50));
+        printf("| Login latency p99    : <%-19llu us |\n", hist_percentile(&metrics.loginLatency, 0.99));
+    }
+    if (admission.rate > 0) {
+        pthread_mutex_lock(&admission.mutex);
+        printf("| Login pacing         : %-14.1f logins/s |\n", admission.rate);
+        printf("| Login queue (now/max): %-10d / %-10d |\n", admission.depth, admission.maxDepth);
+        printf("| Logins turned away   : %-23ld |\n", admission.turnedAway);
+        pthread_mutex_unlock(&admission.mutex);
+        if (atomic_load(&metrics.admissionWait.count) > 0) {
+            printf("| Login queue wait p99 : <%-19llu us |\n", hist_percentile(&metrics.admissionWait, 0.99));
+        }
+    }
+    if (atomic_load(&metrics.resultAppend.count) > 0) {
+        printf("| Result append p99    : <%-19llu us |\n", hist_percentile(&metrics.resultAppend, 0.99));
+    }
+    if (atomic_load(&metrics.adaptiveSelect.count) > 0) {
+        printf("| Adaptive choice p99  : <%-19llu us |\n", hist_percentile(&metrics.adaptiveSelect, 0.99));
+    }
+    display_accept_stats();
+    display_fanout_stats(currentExam);
+    printf("| Log records written  : %-23ld |\n", atomic_load(&logWritten));
+    printf("| Log records dropped  : %-23ld |\n", atomic_load(&logDropped));
+    printf("--------------------------------------------------\n");
+    display_exam_table();
+}
+
+// Drops one reference to a paper buffer and frees it with the last one.
+void paper_release(PaperBuf *paper) {
+    if (atomic_fetch_sub(&paper->refs, 1) != 1) return;
+    bank_release(paper->bank);
+    free(paper);
+}
+
+// Fills v with question qid of a bank. Returns 0 if the question is missing or invalid.
+int bank_question(const QBank *bank, int qid, QuestionView *v) {
+    const QBankRecord *rec = qbank_record(bank, qid);
+    if (rec == NULL) return 0;
+    for (int f = 0; f < QBANK_FIELDS; f++) v->text[f] = qbank_text(bank, rec, f);
+    v->correct = rec->correct;
+    v->difficulty = rec->difficulty;
+    return v->text[0][0] != '\0' && v->correct != '\0' && strchr("ABCD", v->correct) &&
+           v->difficulty >= 1 && v->difficulty <= 3;
+}
+
+// Samples a paper to the exam's blueprint into qids and returns its length. Each difficulty's
+// questions are drawn from its bucket of the bank index with Floyd's algorithm, so a paper
+// costs O(k) in its length whatever the size of the bank. A level with too few questions
+// borrows from the nearest other level. The paper is shuffled so levels are not in order.
+int paper_sample(Exam *e, const QBank *bank, Prng *rng, int qids[NUM_EXAM_QUESTIONS]) {
+    int take[QBANK_LEVELS], spare[QBANK_LEVELS];
+    for (int l = 0; l < QBANK_LEVELS; l++) {
+        uint32_t n;
+        qbank_level(bank, l + 1, &n);
+        take[l] = (uint32_t)e->blueprint[l] < n ? e->blueprint[l] : (int)n;
+        spare[l] = n - take[l] < NUM_EXAM_QUESTIONS ? (int)(n - take[l]) : NUM_EXAM_QUESTIONS;
+    }
+    for (int l = 0; l < QBANK_LEVELS; l++) {
+        int missing = e->blueprint[l] - take[l];
+        for (int dist = 1; missing > 0 && dist < QBANK_LEVELS; dist++) {
+            int near[2] = { l - dist, l + dist };
+            for (int k = 0; k < 2 && missing > 0; k++) {
+                int m = near[k];
+                if (m < 0 || m >= QBANK_LEVELS) continue;
+                int borrow = missing < spare[m] ? missing : spare[m];
+                take[m] += borrow;
+                spare[m] -= borrow;
+                missing -= borrow;
+            }
+        }
+    }
+
+    int count = 0;
+    uint32_t picked[NUM_EXAM_QUESTIONS];
+    for (int l = 0; l < QBANK_LEVELS; l++) {
+        uint32_t n;
+        const uint32_t *ids = qbank_level(bank, l + 1, &n);
+        int first = count;
+        // Floyd: for the last take[l] positions j, pick t in [0, j], or j itself if t is taken
+        for (uint32_t j = n - take[l]; j < n; j++) {
+            uint32_t t = prng_below(rng, j + 1);
+            for (int i = first; i < count; i++) {
+                if (picked[i] == t) {
+                    t = j;
+                    break;
+                }
+            }
+            picked[count++] = t;
+        }
+        for (int i = first; i < count; i++) qids[i] = ids[picked[i]];
+    }
+    prng_shuffle(rng, qids, count);
+    return count;
+}
+
+// Seed of one student's paper: the start's seed mixed with the exam code and roll number.
+uint64_t paper_seed(Exam *e, uint64_t startSeed, const char *roll) {
+    return prng_hash(roll, prng_hash(e->code, startSeed));
+}
+
+// Lays out a paper from its seed: the questions, their order and the order of each one's
+// options. The same seed and bank version always give the same layout, so a paper never
+// needs to be stored to be audited. An adaptive paper's layout is its first question, chosen
+// for the average ability; the ones after it depend on the student's answers.
+void paper_layout(Exam *e, const BankSnapshot *b, uint64_t seed, PaperLayout *l) {
+    Prng rng;
+    prng_seed(&rng, seed);
+    if (b->irt) {
+        l->qids[0] = irt_select(b->irt, 0.0, NULL, 0, &rng);
+        l->count = l->qids[0] >= 0;
+    } else {
+        l->count = paper_sample(e, &b->bank, &rng, l->qids);
+    }
+    for (int i = 0; i < l->count; i++) {
+        int order[4] = { 0, 1, 2, 3 };
+        prng_shuffle(&rng, order, 4);
+        for (int k = 0; k < 4; k++) l->options[i][k] = (unsigned char)order[k];
+    }
+}
+
+// Encodes question qid of a bank as MSG_START and MSG_QUESTION carry it, with its options in
+// the given order, and returns the correct letter as shown. A damaged question goes out as
+// the default question.
+char paper_put_question(ProtoBuf *frame, const QBank *bank, int qid, const unsigned char order[4]) {
+    QuestionView q;
+    if (!bank_question(bank, qid, &q)) {
+        log_warn("📛 Invalid question %d, sending default", qid);
+        QuestionView default_q = {
+            { "What is the default question?", "Option A", "Option B", "Option C", "Option D" }, 'A', 1
+        };
+        q = default_q;
+    }
+    // Options go out in the given order; the correct letter is the one shown
+    char shown = q.correct;
+    pb_put_varint(frame, qid);
+    pb_put_str(frame, q.text[0]);
+    for (int k = 0; k < 4; k++) {
+        pb_put_str(frame, q.text[1 + order[k]]);
+        if (order[k] == q.correct - 'A') shown = (char)('A' + k);
+    }
+    pb_put_u8(frame, (uint8_t)shown);
+    pb_put_u8(frame, (uint8_t)q.difficulty);
+    log_debug("📤 Question %d: %s", qid, q.text[0]);
+    return shown;
+}
+
+// Builds the paper of a seed from bank version b as a complete MSG_START frame: configuration
+// followed by the questions of its layout, each with its options in the layout's order. The
+// paper takes its own reference to b.
+PaperBuf *paper_build(Exam *e, BankSnapshot *b, uint64_t seed) {
+    int valid_answerTimeout = 30;
+    float valid_marksForCorrectAnswer = 1.0;
+    float valid_marksDeductedForWrongAnswer = 0.25;
+
+    // Validate rules before sending
+    if (e->answerTimeout > 0 && e->answerTimeout <= 3600) valid_answerTimeout = e->answerTimeout;
+    if (e->marksForCorrectAnswer > 0 && e->marksForCorrectAnswer <= 100) valid_marksForCorrectAnswer = e->marksForCorrectAnswer;
+    if (e->marksDeductedForWrongAnswer >= 0 && e->marksDeductedForWrongAnswer <= 100) valid_marksDeductedForWrongAnswer = e->marksDeductedForWrongAnswer;
+
+    // Select questions to send
+    PaperLayout layout;
+    paper_layout(e, b, seed, &layout);
+    int num_questions = layout.count;
+    int *qids = layout.qids;
+    int adaptiveLength = 0;
+    if (b->irt && num_questions > 0) {
+        adaptiveLength = (uint32_t)e->adaptiveLength < b->bank.count ? e->adaptiveLength : (int)b->bank.count;
+    }
+
+    log_debug("📜 %s paper %016llx rules: Timeout=%d, Correct=%.2f, Wrong=%.2f, Questions=%d", e->code,
+           (unsigned long long)seed, valid_answerTimeout, valid_marksForCorrectAnswer, valid_marksDeductedForWrongAnswer, num_questions);
+
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_START);
+    pb_put_varint(&frame, valid_answerTimeout);
+    pb_put_varint(&frame, e->duration);
+    pb_put_f32(&frame, valid_marksForCorrectAnswer);
+    pb_put_f32(&frame, valid_marksDeductedForWrongAnswer);
+    pb_put_varint(&frame, adaptiveLength);
+    pb_put_varint(&frame, num_questions);
+
+    char correct[NUM_EXAM_QUESTIONS];
+    size_t qoff[NUM_EXAM_QUESTIONS], qlen[NUM_EXAM_QUESTIONS];
+    for (int i = 0; i < num_questions; i++) {
+        qoff[i] = frame.len;
+        correct[i] = paper_put_question(&frame, &b->bank, qids[i], layout.options[i]);
+        qlen[i] = frame.len - qoff[i];
+    }
+    proto_end(&frame, start);
+
+    PaperBuf *paper = frame.failed ? NULL : malloc(sizeof(PaperBuf) + frame.len);
+    if (paper == NULL) {
+        log_error("📛 Out of memory encoding paper %016llx", (unsigned long long)seed);
+        pb_free(&frame);
+        return NULL;
+    }
+    atomic_init(&paper->refs, 1);
+    paper->exam = e;
+    paper->seed = seed;
+    paper->bank = b;
+    atomic_fetch_add(&b->refs, 1);
+    paper->answerTimeout = valid_answerTimeout;
+    paper->examDuration = e->duration;
+    paper->adaptiveLength = adaptiveLength;
+    paper->count = num_questions;
+    memcpy(paper->qids, qids, sizeof(layout.qids));
+    memcpy(paper->correct, correct, sizeof(correct));
+    memcpy(paper->qoff, qoff, sizeof(qoff));
+    memcpy(paper->qlen, qlen, sizeof(qlen));
+    paper->marksCorrect = valid_marksForCorrectAnswer;
+    paper->marksWrong = valid_marksDeductedForWrongAnswer;
+    paper->len = frame.len;
+    memcpy(paper->data, frame.data, frame.len);
+    pb_free(&frame);
+    char label[48];
+    snprintf(label, sizeof(label), "📤 Paper %016llx", (unsigned long long)seed);
+    log_hexdump(label, paper->data, paper->len);
+    return paper;
+}
+
+// Builds a student's paper for the exam's current start. Papers are built when they are
+// sent, on the event loop serving the student, so no two students share a generator.
+// Returns NULL if the exam has not started or memory ran out.
+PaperBuf *paper_acquire(Exam *e, const char *roll) {
+    if (!atomic_load(&e->started)) return NULL;
+    BankSnapshot *b = bank_acquire(&e->startBank);
+    if (b == NULL) return NULL;
+    PaperBuf *paper = paper_build(e, b, paper_seed(e, atomic_load(&e->startSeed), roll));
+    bank_release(b);
+    return paper;
+}
+
+// Starts an exam for all its registered students. Every event loop serving the exam fans
+// START and the exam data out to its own students in parallel, so no socket I/O happens on
+// the instructor thread or under a global lock.
+void start_exam(Exam *e) {
+    // A second start would move every running student's deadline and change the start
+    // seed and bank version that late joiners' papers come from. The menu and the -s
+    // auto-start may race here, so the start is claimed before any work; started itself is
+    // set last, once everything it publishes is in place.
+    int unclaimed = 0;
+    if (!atomic_compare_exchange_strong(&e->startClaimed, &unclaimed, 1)) {
+        if (strcmp(exam_status(e), "over") == 0) printf("📛 Exam %s has already finished.\n", e->code);
+        else printf("📛 Exam %s has already been started.\n", e->code);
+        return;
+    }
+    int count = atomic_load(&e->registered);
+    if (count == 0) {
+        printf("📛 No students registered for exam %s.\n", e->code);
+        atomic_store(&e->startClaimed, 0);
+        return;
+    }
+    printf("📢 Starting exam %s for %d registered students...\n", e->code, count);
+    // The start pins the latest bank version; its papers all come from it, even if the bank
+    // is reloaded while the exam runs
+    BankSnapshot *b = bank_acquire(&e->bank);
+    int wanted = e->blueprint[0] + e->blueprint[1] + e->blueprint[2];
+    uint32_t available = b->bank.header->levelStart[QBANK_LEVELS];
+    if (b->irt) {
+        printf("🧭 Papers are adaptive: up to %d questions, stopping at a standard error of %.2f\n",
+               (uint32_t)e->adaptiveLength < available ? e->adaptiveLength : (int)available, e->adaptiveSe);
+    } else if (available < (uint32_t)wanted) {
+        printf("📛 Warning: Only %u questions available for %s, papers will be short\n", available, e->code);
+    }
+    printf("📚 Papers come from version %u of the question bank (%u questions)\n", b->version, b->bank.count);
+    bank_publish(&e->startBank, b);
+    uint64_t seed = start_seed_new();
+    atomic_store(&e->startSeed, seed);
+    printf("🎲 Paper seed: %016llx (keep it to regenerate papers for an audit)\n", (unsigned long long)seed);
+    log_info("🎲 %s started with paper seed %016llx", e->code, (unsigned long long)seed);
+
+    long long *delays = calloc(count, sizeof(long long));
+    pthread_mutex_lock(&e->fanout.mutex);
+    free(e->fanout.delaysUs);
+    e->fanout.delaysUs = delays;
+    e->fanout.target = delays ? count : 0;
+    e->fanout.delivered = 0;
+    clock_gettime(CLOCK_MONOTONIC, &e->fanout.started);
+    pthread_mutex_unlock(&e->fanout.mutex);
+
+    // startedAt is published by the store to started, which loops read before using it
+    clock_gettime(CLOCK_MONOTONIC, &e->startedAt);
+    atomic_store(&e->started, 1);
+    printf("⏳ The exam ends in %d seconds.\n", e->duration);
+
+    uint64_t one = 1;
+    for (int i = 0; i < e->loopSpan; i++) {
+        EventLoop *loop = &loops[(e->firstLoop + i) % loopCount];
+        atomic_store(&loop->startRequested, 1);
+        if (write(loop->wakefd, &one, sizeof(one)) != sizeof(one)) {
+            log_error("📛 Error waking event loop: %s", strerror(errno));
+        }
+    }
+}
+
+// Registry: hashes a roll number (FNV-1a).
+unsigned int roll_hash(const char *roll) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)roll; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Registry: prepares the shard locks. Tables and sessions are allocated on demand.
+void registry_init() {
+    for (int i = 0; i < REGISTRY_SHARDS; i++) {
+        pthread_mutex_init(&rollShards[i].mutex, NULL);
+        pthread_mutex_init(&sockShards[i].mutex, NULL);
+    }
+}
+
+// Registry: the key a session is indexed under, and its chain links, in either index.
+unsigned int registry_key(Session *s, int byRoll) {
+    return byRoll ? s->rollHash : (unsigned int)s->sock;
+}
+
+SessionLink *registry_links(Session *s, int byRoll) {
+    return byRoll ? &s->byRoll : &s->bySock;
+}
+
+// Registry: chain head for a key. The low bits of the key already picked the shard.
+Session **registry_bucket(RegistryShard *shard, unsigned int key) {
+    return &shard->buckets[(key / REGISTRY_SHARDS) & (shard->bucketCount - 1)];
+}
+
+// Registry: doubles a shard's bucket array and rehashes its chains. On allocation failure
+// the old table stays in use with longer chains.
+void registry_grow(RegistryShard *shard, int byRoll) {
+    unsigned int count = shard->bucketCount ? shard->bucketCount * 2 : REGISTRY_INITIAL_BUCKETS;
+    Session **buckets = calloc(count, sizeof(Session *));
+    if (buckets == NULL) return;
+    Session **old = shard->buckets;
+    unsigned int oldCount = shard->bucketCount;
+    shard->buckets = buckets;
+    shard->bucketCount = count;
+    for (unsigned int i = 0; i < oldCount; i++) {
+        Session *s = old[i];
+        while (s != NULL) {
+            Session *next = registry_links(s, byRoll)->next;
+            Session **head = registry_bucket(shard, registry_key(s, byRoll));
+            registry_links(s, byRoll)->prev = NULL;
+            registry_links(s, byRoll)->next = *head;
+            if (*head) registry_links(*head, byRoll)->prev = s;
+            *head = s;
+            s = next;
+        }
+    }
+    free(old);
+}
+
+// Registry: adds a session to a shard's chains, growing the table to keep about one
+// session per bucket. Returns 0 if no table could be allocated.
+int registry_link(RegistryShard *shard, Session *s, int byRoll) {
+    if ((unsigned int)shard->count >= shard->bucketCount) registry_grow(shard, byRoll);
+    if (shard->bucketCount == 0) return 0;
+    Session **head = registry_bucket(shard, registry_key(s, byRoll));
+    SessionLink *link = registry_links(s, byRoll);
+    link->prev = NULL;
+    link->next = *head;
+    if (*head) registry_links(*head, byRoll)->prev = s;
+    *head = s;
+    shard->count++;
+    return 1;
+}
+
+// Registry: removes a session from a shard's chains in O(1).
+void registry_unlink(RegistryShard *shard, Session *s, int byRoll) {
+    SessionLink *link = registry_links(s, byRoll);
+    if (link->prev) registry_links(link->prev, byRoll)->next = link->next;
+    else *registry_bucket(shard, registry_key(s, byRoll)) = link->next;
+    if (link->next) registry_links(link->next, byRoll)->prev = link->prev;
+    link->prev = link->next = NULL;
+    shard->count--;
+}
+
+// Registry: takes a session from a roll shard's slab, adding a chunk when it is empty.
+Session *registry_alloc(RegistryShard *shard) {
+    if (shard->freeList == NULL) {
+        Session *chunk = calloc(SESSION_SLAB_CHUNK, sizeof(Session));
+        if (chunk == NULL) return NULL;
+        for (int i = SESSION_SLAB_CHUNK - 1; i >= 0; i--) {
+            chunk[i].nextFree = shard->freeList;
+            shard->freeList = &chunk[i];
+        }
+    }
+    Session *s = shard->freeList;
+    shard->freeList = s->nextFree;
+    return s;
+}
+
+// Registry: returns a session to its roll shard's slab.
+void registry_release(RegistryShard *shard, Session *s) {
+    s->nextFree = shard->freeList;
+    shard->freeList = s;
+}
+
+// Registry: finds the session of a socket. The socket shard must be locked.
+Session *registry_find_sock(RegistryShard *shard, int sock) {
+    if (shard->bucketCount == 0) return NULL;
+    for (Session *s = *registry_bucket(shard, (unsigned int)sock); s != NULL; s = s->bySock.next) {
+        if (s->sock == sock) return s;
+    }
+    return NULL;
+}
+
+// Adds a student to the session registry. Returns REGISTRY_OK, REGISTRY_DUPLICATE when the
+// roll number is already logged in, or REGISTRY_NO_MEMORY.
+int register_client(Conn *c) {
+    unsigned int hash = roll_hash(c->roll);
+    RegistryShard *rs = &rollShards[hash % REGISTRY_SHARDS];
+    RegistryShard *ss = &sockShards[(unsigned int)c->sock % REGISTRY_SHARDS];
+
+    // Lock order is always roll shard, then socket shard
+    pthread_mutex_lock(&rs->mutex);
+    if (rs->bucketCount > 0) {
+        for (Session *s = *registry_bucket(rs, hash); s != NULL; s = s->byRoll.next) {
+            if (s->rollHash == hash && strcmp(s->roll, c->roll) == 0) {
+                pthread_mutex_unlock(&rs->mutex);
+                return REGISTRY_DUPLICATE;
+            }
+        }
+    }
+    Session *s = registry_alloc(rs);
+    if (s == NULL) {
+        pthread_mutex_unlock(&rs->mutex);
+        return REGISTRY_NO_MEMORY;
+    }
+    s->sock = c->sock;
+    snprintf(s->roll, sizeof(s->roll), "%s", c->roll);
+    memcpy(s->token, c->token, sizeof(s->token));
+    s->suspended = NULL;
+    s->exam = c->exam;
+    s->rollHash = hash;
+    if (!registry_link(rs, s, 1)) {
+        registry_release(rs, s);
+        pthread_mutex_unlock(&rs->mutex);
+        return REGISTRY_NO_MEMORY;
+    }
+    pthread_mutex_lock(&ss->mutex);
+    int linked = registry_link(ss, s, 0);
+    pthread_mutex_unlock(&ss->mutex);
+    if (!linked) {
+        registry_unlink(rs, s, 1);
+        registry_release(rs, s);
+        pthread_mutex_unlock(&rs->mutex);
+        return REGISTRY_NO_MEMORY;
+    }
+    pthread_mutex_unlock(&rs->mutex);
+
+    int total = atomic_fetch_add(&registryCount, 1) + 1;
+    atomic_fetch_add(&c->exam->registered, 1);
+    c->registered = 1;
+    log_info("🎉 Student %s (Roll: %s) registered. Total clients: %d", c->name, c->roll, total);
+    return REGISTRY_OK;
+}
+
+// Removes a student from the session registry by socket.
+void unregister_client(Conn *c) {
+    RegistryShard *ss = &sockShards[(unsigned int)c->sock % REGISTRY_SHARDS];
+    pthread_mutex_lock(&ss->mutex);
+    Session *s = registry_find_sock(ss, c->sock);
+    unsigned int hash = s ? s->rollHash : 0;
+    pthread_mutex_unlock(&ss->mutex);
+    c->registered = 0;
+    if (s == NULL) return;
+
+    // Only the connection's own loop removes its socket, so the session stays put while
+    // the locks are retaken in roll-then-socket order
+    RegistryShard *rs = &rollShards[hash % REGISTRY_SHARDS];
+    pthread_mutex_lock(&rs->mutex);
+    pthread_mutex_lock(&ss->mutex);
+    registry_unlink(ss, s, 0);
+    pthread_mutex_unlock(&ss->mutex);
+    registry_unlink(rs, s, 1);
+    log_info("🗑️ Removing client %s (socket %d)", s->roll, c->sock);
+    registry_release(rs, s);
+    pthread_mutex_unlock(&rs->mutex);
+
+    int total = atomic_fetch_sub(&registryCount, 1) - 1;
+    atomic_fetch_sub(&c->exam->registered, 1);
+    log_info("📊 Total clients after removal: %d", total);
+}
+
+// Registry: finds the session of a roll number. The roll shard must be locked.
+Session *registry_find_roll(RegistryShard *shard, const char *roll, unsigned int hash) {
+    if (shard->bucketCount == 0) return NULL;
+    for (Session *s = *registry_bucket(shard, hash); s != NULL; s = s->byRoll.next) {
+        if (s->rollHash == hash && strcmp(s->roll, roll) == 0) return s;
+    }
+    return NULL;
+}
+
+// Compares two tokens in time independent of where they differ.
+int token_equal(const char *a, const char *b) {
+    size_t n = strlen(a);
+    if (n != strlen(b)) return 0;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < n; i++) diff |= (unsigned char)(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+// Keeps a dropped student's session in the registry with their exam state attached. The
+// socket is unlinked; the roll number stays taken until the student resumes or it expires.
+int registry_suspend(Conn *c, SuspendedExam *se) {
+    unsigned int hash = roll_hash(c->roll);
+    RegistryShard *rs = &rollShards[hash % REGISTRY_SHARDS];
+    RegistryShard *ss = &sockShards[(unsigned int)c->sock % REGISTRY_SHARDS];
+    pthread_mutex_lock(&rs->mutex);
+    Session *s = registry_find_roll(rs, c->roll, hash);
+    if (s == NULL || s->sock != c->sock) {
+        pthread_mutex_unlock(&rs->mutex);
+        return 0;
+    }
+    pthread_mutex_lock(&ss->mutex);
+    registry_unlink(ss, s, 0);
+    pthread_mutex_unlock(&ss->mutex);
+    s->sock = -1;
+    s->suspended = se;
+    pthread_mutex_unlock(&rs->mutex);
+    c->registered = 0;
+    atomic_fetch_add(&c->exam->suspended, 1);
+    return 1;
+}
+
+// Reattaches a suspended session to a new connection when the token matches, copying the
+// exam state into the Conn. Returns 0 if there is nothing to resume.
+int registry_resume(Conn *c, const char *token) {
+    unsigned int hash = roll_hash(c->roll);
+    RegistryShard *rs = &rollShards[hash % REGISTRY_SHARDS];
+    RegistryShard *ss = &sockShards[(unsigned int)c->sock % REGISTRY_SHARDS];
+    pthread_mutex_lock(&rs->mutex);
+    Session *s = registry_find_roll(rs, c->roll, hash);
+    if (s == NULL || s->suspended == NULL || s->exam != c->exam || !token_equal(s->token, token)) {
+        pthread_mutex_unlock(&rs->mutex);
+        return 0;
+    }
+    s->sock = c->sock;
+    pthread_mutex_lock(&ss->mutex);
+    int linked = registry_link(ss, s, 0);
+    pthread_mutex_unlock(&ss->mutex);
+    if (!linked) {
+        s->sock = -1;
+        pthread_mutex_unlock(&rs->mutex);
+        return 0;
+    }
+    // The expiry timer frees the state later; it sees claimed and leaves the session alone
+    SuspendedExam *se = s->suspended;
+    s->suspended = NULL;
+    se->claimed = 1;
+    memcpy(c->name, se->name, sizeof(c->name));
+    memcpy(c->reg_no, se->reg_no, sizeof(c->reg_no));
+    memcpy(c->token, s->token, sizeof(c->token));
+    c->paper = se->paper;
+    atomic_fetch_add(&c->paper->refs, 1);
+    c->adaptive = se->adaptive;
+    se->adaptive = NULL;
+    c->answered = se->answered;
+    c->answerCount = se->answerCount;
+    c->correctCount = se->correctCount;
+    memcpy(c->answerSeconds, se->answerSeconds, sizeof(c->answerSeconds));
+    pthread_mutex_unlock(&rs->mutex);
+    c->registered = 1;
+    atomic_fetch_sub(&c->exam->suspended, 1);
+    return 1;
+}
+
+// Removes a suspended session whose resume window ran out. Returns 1 if it was still
+// suspended, i.e. the student never came back.
+int registry_expire(SuspendedExam *se) {
+    unsigned int hash = roll_hash(se->roll);
+    RegistryShard *rs = &rollShards[hash % REGISTRY_SHARDS];
+    pthread_mutex_lock(&rs->mutex);
+    if (se->claimed) {
+        pthread_mutex_unlock(&rs->mutex);
+        return 0;
+    }
+    Session *s = registry_find_roll(rs, se->roll, hash);
+    if (s != NULL && s->suspended == se) {
+        registry_unlink(rs, s, 1);
+        registry_release(rs, s);
+    }
+    pthread_mutex_unlock(&rs->mutex);
+    atomic_fetch_sub(&registryCount, 1);
+    atomic_fetch_sub(&se->paper->exam->registered, 1);
+    atomic_fetch_sub(&se->paper->exam->suspended, 1);
+    return 1;
+}
+
+// Unlinks a connection from its loop's waiting list.
+void conn_unlink_waiting(Conn *c) {
+    if (c->prev) c->prev->next = c->next;
+    else if (c->loop->waiting == c) c->loop->waiting = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->prev = c->next = NULL;
+}
+
+// Closes a connection. The Conn itself is freed once the current event batch is done,
+// because later events in the same batch may still point at it.
+void conn_close(Conn *c) {
+    if (c->state == CONN_CLOSED) return;
+    if (c->state == CONN_WAITING) conn_unlink_waiting(c);
+    if (c->state == CONN_EXAM && c->paper) atomic_fetch_sub(&c->exam->inProgress, 1);
+    timer_cancel(&c->loop->wheel, &c->timer);
+    if (c->registered) unregister_client(c);
+    epoll_ctl(c->loop->epfd, EPOLL_CTL_DEL, c->sock, NULL);
+    close(c->sock);
+    log_info("🔌 Closed client socket %d", c->sock);
+    c->state = CONN_CLOSED;
+    c->next_closed = c->loop->closed;
+    c->loop->closed = c;
+    c->on_closed_list = 1;
+}
+
+// Updates the epoll interest set so EPOLLOUT is only watched while output is queued.
+void conn_update_events(Conn *c) {
+    int want = c->sendq_head != NULL;
+    if (want == c->want_write) return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (want ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(c->loop->epfd, EPOLL_CTL_MOD, c->sock, &ev);
+    c->want_write = want;
+}
+
+// Frees everything still queued on a connection.
+void conn_free_sendq(Conn *c) {
+    while (c->sendq_head != NULL) {
+        SendSeg *seg = c->sendq_head;
+        c->sendq_head = seg->next;
+        if (seg->shared) paper_release(seg->shared);
+        free(seg);
+    }
+    c->sendq_tail = NULL;
+}
+
+// Records that a fan-out START has fully left the server for this student.
+void fanout_record_delivery(Conn *c) {
+    c->fanout = 0;
+    FanoutStats *fanout = &c->exam->fanout;
+    long long delay = elapsed_us(&fanout->started);
+    hist_record(&metrics.fanoutDelay, delay);
+    pthread_mutex_lock(&fanout->mutex);
+    if (fanout->delaysUs != NULL && fanout->delivered < fanout->target) {
+        fanout->delaysUs[fanout->delivered++] = delay;
+    }
+    pthread_mutex_unlock(&fanout->mutex);
+}
+
+// Writes queued output with writev until the queue is empty or the socket is full.
+// Returns 0 if the connection was closed.
+int conn_flush(Conn *c) {
+    while (c->sendq_head != NULL) {
+        struct iovec iov[MAX_FLUSH_IOV];
+        int n = 0;
+        for (SendSeg *seg = c->sendq_head; seg != NULL && n < MAX_FLUSH_IOV; seg = seg->next, n++) {
+            iov[n].iov_base = (void *)(seg->data + seg->off);
+            iov[n].iov_len = seg->len - seg->off;
+        }
+        long long sendUs = c->traceId ? trace_now() : 0;
+        ssize_t sent = writev(c->sock, iov, n);
+        if (c->traceId && sent > 0) trace_span(TRACE_SEND, c->traceId, c->roll, sendUs, trace_now(), sent);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            log_warn("📛 Error sending to socket %d: %s", c->sock, strerror(errno));
+            conn_drop(c);
+            return 0;
+        }
+        metrics_count(&c->loop->bytesSent, sent);
+        while (sent > 0) {
+            SendSeg *seg = c->sendq_head;
+            size_t left = seg->len - seg->off;
+            if ((size_t)sent < left) {
+                seg->off += sent;
+                break;
+            }
+            sent -= left;
+            c->sendq_head = seg->next;
+            if (seg->shared) paper_release(seg->shared);
+            free(seg);
+        }
+        if (c->sendq_head == NULL) c->sendq_tail = NULL;
+    }
+    if (c->sendq_head == NULL && c->fanout) fanout_record_delivery(c);
+    conn_update_events(c);
+    return 1;
+}
+
+// Sends a set of buffers on a connection without blocking. With nothing queued the
+// buffers go straight out with one writev; whatever the socket does not accept is
+// copied into the connection's send queue and written when epoll reports it writable.
+void conn_sendv(Conn *c, struct iovec *iov, int iovcnt) {
+    if (c->state == CONN_CLOSED) return;
+    size_t skip = 0;
+    if (c->sendq_head == NULL) {
+        while (1) {
+            long long sendUs = c->traceId ? trace_now() : 0;
+            ssize_t sent = writev(c->sock, iov, iovcnt);
+            if (c->traceId && sent > 0) trace_span(TRACE_SEND, c->traceId, c->roll, sendUs, trace_now(), sent);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                log_warn("📛 Error sending to socket %d: %s", c->sock, strerror(errno));
+                conn_drop(c);
+                return;
+            }
+            skip = sent;
+            metrics_count(&c->loop->bytesSent, sent);
+            break;
+        }
+    }
+    size_t rest = 0;
+    for (int i = 0; i < iovcnt; i++) rest += iov[i].iov_len;
+    if (skip >= rest) return;
+    rest -= skip;
+
+    SendSeg *seg = malloc(sizeof(SendSeg) + rest);
+    if (seg == NULL) {
+        log_error("📛 Out of memory queueing output for socket %d", c->sock);
+        conn_close(c);
+        return;
+    }
+    seg->next = NULL;
+    seg->data = seg->copy;
+    seg->len = rest;
+    seg->off = 0;
+    seg->shared = NULL;
+    size_t filled = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size_t len = iov[i].iov_len;
+        const unsigned char *p = iov[i].iov_base;
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        memcpy(seg->copy + filled, p + skip, len - skip);
+        filled += len - skip;
+        skip = 0;
+    }
+    if (c->sendq_tail) c->sendq_tail->next = seg;
+    else c->sendq_head = seg;
+    c->sendq_tail = seg;
+    conn_update_events(c);
+}
+
+// Sends data on a connection without blocking.
+void conn_send(Conn *c, const void *data, size_t len) {
+    struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+    conn_sendv(c, &iov, 1);
+}
+
+// Sends a shared paper without copying it: straight from the shared buffer when nothing is
+// queued, otherwise by queueing a segment that references the buffer.
+void conn_send_paper(Conn *c, PaperBuf *paper) {
+    if (c->state == CONN_CLOSED) return;
+    size_t sent = 0;
+    if (c->sendq_head == NULL) {
+        long long sendUs = c->traceId ? trace_now() : 0;
+        while (sent < paper->len) {
+            ssize_t n = send(c->sock, paper->data + sent, paper->len - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                log_warn("📛 Error sending to socket %d: %s", c->sock, strerror(errno));
+                conn_drop(c);
+                return;
+            }
+            sent += n;
+        }
+        metrics_count(&c->loop->bytesSent, sent);
+        if (c->traceId && sent > 0) trace_span(TRACE_SEND, c->traceId, c->roll, sendUs, trace_now(), sent);
+        if (sent == paper->len) return;
+    }
+    SendSeg *seg = malloc(sizeof(SendSeg));
+    if (seg == NULL) {
+        log_error("📛 Out of memory queueing output for socket %d", c->sock);
+        conn_close(c);
+        return;
+    }
+    atomic_fetch_add(&paper->refs, 1);
+    seg->next = NULL;
+    seg->data = paper->data;
+    seg->len = paper->len;
+    seg->off = sent;
+    seg->shared = paper;
+    if (c->sendq_tail) c->sendq_tail->next = seg;
+    else c->sendq_head = seg;
+    c->sendq_tail = seg;
+    conn_update_events(c);
+}
+
+// Milliseconds left until the end of the exam, negative once it is over.
+long exam_remaining_ms(PaperBuf *paper) {
+    return paper->examDuration * 1000L - (long)(elapsed_us(&paper->exam->startedAt) / 1000);
+}
+
+// Arms a student's answer deadline: the next answer is due within the per-question limit
+// plus a grace period, and never later than the end of the exam plus the same grace.
+void conn_arm_answer_deadline(Conn *c) {
+    long ms = (c->paper->answerTimeout + ANSWER_GRACE) * 1000L;
+    long left = exam_remaining_ms(c->paper) + ANSWER_GRACE * 1000L;
+    timer_schedule(&c->loop->wheel, &c->timer, left < ms ? left : ms);
+}
+
+// Starts a student's progress through an adaptive paper, whose first question is the one
+// in START. Returns NULL if memory ran out.
+AdaptiveSession *adaptive_begin(PaperBuf *paper) {
+    AdaptiveSession *a = calloc(1, sizeof(AdaptiveSession));
+    if (a == NULL) return NULL;
+    prng_seed(&a->rng, prng_hash("adaptive", paper->seed));
+    irt_ability_init(&a->ability);
+    a->asked = 1;
+    a->qids[0] = paper->qids[0];
+    a->correct[0] = paper->correct[0];
+    return a;
+}
+
+// Sends MSG_ADAPTIVE_DONE with the ability estimate of a finished adaptive paper.
+void conn_send_adaptive_done(Conn *c) {
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_ADAPTIVE_DONE);
+    pb_put_f32(&frame, (float)c->adaptive->ability.theta);
+    pb_put_f32(&frame, (float)c->adaptive->ability.se);
+    proto_end(&frame, start);
+    if (frame.failed) {
+        log_error("📛 Out of memory encoding frame for socket %d", c->sock);
+        conn_close(c);
+    } else {
+        conn_send(c, frame.data, frame.len);
+    }
+    pb_free(&frame);
+}
+
+// Folds the answer to the latest question of an adaptive paper into the student's ability
+// estimate, then sends the next question, picked from the information table at the new
+// estimate, as MSG_QUESTION. Once the paper has its most questions or the estimate is as
+// precise as the exam asks, MSG_ADAPTIVE_DONE is sent instead and only the result is left.
+void conn_adaptive_next(Conn *c, int correct) {
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    AdaptiveSession *a = c->adaptive;
+    const IrtTable *t = c->paper->bank->irt;
+    irt_ability_update(&a->ability, &t->items[a->qids[a->asked - 1]], correct);
+    int next = -1;
+    if (a->asked < c->paper->adaptiveLength && a->ability.se > c->exam->adaptiveSe) {
+        next = irt_select(t, a->ability.theta, a->qids, a->asked, &a->rng);
+    }
+    hist_record(&metrics.adaptiveSelect, elapsed_us(&started));
+    if (next < 0) {
+        a->done = 1;
+        log_info("🧭 Roll %s finished an adaptive paper after %d question(s): ability %.2f, standard error %.2f",
+                 c->roll, a->asked, a->ability.theta, a->ability.se);
+        timer_schedule(&c->loop->wheel, &c->timer, ANSWER_GRACE * 1000L); // Only the result is left
+        conn_send_adaptive_done(c);
+        return;
+    }
+
+    int i = a->asked++;
+    int order[4] = { 0, 1, 2, 3 };
+    prng_shuffle(&a->rng, order, 4);
+    for (int k = 0; k < 4; k++) a->options[i][k] = (unsigned char)order[k];
+    a->qids[i] = next;
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_QUESTION);
+    a->correct[i] = paper_put_question(&frame, &c->paper->bank->bank, next, a->options[i]);
+    proto_end(&frame, start);
+    if (frame.failed) {
+        log_error("📛 Out of memory encoding frame for socket %d", c->sock);
+        conn_close(c);
+    } else {
+        conn_arm_answer_deadline(c);
+        conn_send(c, frame.data, frame.len);
+    }
+    pb_free(&frame);
+}
+
+// Sends START with the exam data to a student and moves it to the exam state.
+// Students started by the instructor's fan-out are counted in the start skew statistics.
+void conn_start_exam(Conn *c, int counted) {
+    if (c->state == CONN_WAITING) conn_unlink_waiting(c);
+    if (c->traceId) {
+        c->examUs = trace_now();
+        if (c->waitingUs) trace_span(TRACE_WAIT_START, c->traceId, c->roll, c->waitingUs, c->examUs, 0);
+    }
+    c->state = CONN_EXAM;
+    c->fanout = counted;
+    PaperBuf *paper = paper_acquire(c->exam, c->roll);
+    if (paper == NULL) {
+        conn_fail(c, "Exam paper unavailable");
+        return;
+    }
+    if (exam_remaining_ms(paper) <= 0) {
+        paper_release(paper);
+        conn_fail(c, "Exam time is over");
+        return;
+    }
+    if (paper->adaptiveLength > 0) {
+        c->adaptive = adaptive_begin(paper);
+        if (c->adaptive == NULL) {
+            paper_release(paper);
+            conn_fail(c, "Out of memory");
+            return;
+        }
+    }
+    log_info("📢 Sending START with paper %016llx to client %s (socket %d)", (unsigned long long)paper->seed, c->roll, c->sock);
+    c->paper = paper;   // The Conn's reference, dropped when it is freed
+    c->answered = 0;
+    atomic_fetch_add(&c->exam->inProgress, 1);
+    conn_arm_answer_deadline(c);
+    conn_send_paper(c, paper);
+    if (c->state == CONN_CLOSED) return;
+    if (c->fanout && c->sendq_head == NULL) fanout_record_delivery(c);
+    log_info("✅ START sent to client %s", c->roll);
+}
+
+// Sends a frame whose body is a single string, or an empty frame if text is NULL.
+void conn_send_frame(Conn *c, int type, const char *text) {
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, type);
+    if (text) pb_put_str(&frame, text);
+    proto_end(&frame, start);
+    if (frame.failed) {
+        log_error("📛 Out of memory encoding frame for socket %d", c->sock);
+        conn_close(c);
+    } else {
+        conn_send(c, frame.data, frame.len);
+    }
+    pb_free(&frame);
+}
+
+// Tells the client why it is being disconnected, then closes the connection.
+void conn_fail(Conn *c, const char *reason) {
+    log_warn("📛 Closing socket %d: %s", c->sock, reason);
+    conn_send_frame(c, MSG_ERROR, reason);
+    conn_close(c);
+}
+
+// Credential check handed to the worker pool so the loop never blocks on the details file
+typedef struct {
+    WorkItem item;
+    Conn *conn;              // Connection that sent the login
+    Exam *exam;              // Exam named in the login
+    char roll[50];
+    char password[50];
+    struct timespec received; // When the login arrived, before any wait for admission
+    int valid;               // Result of verify_student
+    int enrolled;            // Result of roster_allows
+    char name[50];
+    char reg_no[50];
+} LoginTask;
+
+// Result write handed to the worker pool; owns a copy of the result
+typedef struct {
+    WorkItem item;
+    Exam *exam;              // Exam whose results file receives it
+    unsigned int traceId;    // Session that sent it, 0 if closed out or not traced
+    DashboardStudent result;
+} ResultTask;
+
+// Worker side of a login: checks the credential index and the exam's roster index.
+void login_task_run(WorkItem *item) {
+    LoginTask *t = (LoginTask *)item;
+    t->valid = verify_student(t->roll, t->password, t->name, t->reg_no);
+    t->enrolled = t->valid && roster_allows(t->exam, t->roll);
+}
+
+// Loop side of a login: answers the client and registers it for the exam.
+void login_task_done(WorkItem *item) {
+    LoginTask *t = (LoginTask *)item;
+    Conn *c = t->conn;
+    struct timespec received = t->received;
+    c->pending--;
+    if (admission.rate > 0) {
+        hist_record(&metrics.admissionWait, (t->item.queued.tv_sec - received.tv_sec) * 1000000LL +
+                                            (t->item.queued.tv_nsec - received.tv_nsec) / 1000);
+    }
+    if (c->traceId) {
+        trace_span(TRACE_ADMISSION, c->traceId, c->roll, trace_us(&received), trace_us(&t->item.queued), 0);
+        trace_span(TRACE_LOGIN_VERIFY, c->traceId, c->roll, trace_us(&t->item.queued), trace_now(), 0);
+    }
+    if (c->state == CONN_CLOSED) {
+        // The client went away while its credentials were being checked
+        if (c->pending == 0 && !c->on_closed_list) {
+            c->next_closed = c->loop->closed;
+            c->loop->closed = c;
+            c->on_closed_list = 1;
+        }
+        free(t);
+        return;
+    }
+
+    if (!t->valid) {
+        log_warn("📛 Invalid credentials for roll %s", c->roll);
+        conn_send_frame(c, MSG_LOGIN_FAIL, "Invalid credentials");
+        metrics_count(&metrics.loginsRejected, 1);
+        conn_close(c);
+        free(t);
+        return;
+    }
+    if (!t->enrolled) {
+        log_warn("📛 Roll %s is not on the roster of exam %s", c->roll, c->exam->code);
+        conn_send_frame(c, MSG_LOGIN_FAIL, "Not enrolled in this exam");
+        metrics_count(&metrics.loginsRejected, 1);
+        conn_close(c);
+        free(t);
+        return;
+    }
+    memcpy(c->name, t->name, sizeof(c->name));
+    memcpy(c->reg_no, t->reg_no, sizeof(c->reg_no));
+    free(t);
+
+    unsigned char random[SESSION_TOKEN_BYTES];
+    if (getrandom(random, sizeof(random), 0) != (ssize_t)sizeof(random)) {
+        log_error("📛 Error generating session token: %s", strerror(errno));
+        conn_fail(c, "Server could not create a session");
+        return;
+    }
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i++) sprintf(c->token + 2 * i, "%02x", random[i]);
+
+    long long insertUs = c->traceId ? trace_now() : 0;
+    int registered = register_client(c);
+    if (c->traceId) trace_span(TRACE_REGISTRY_INSERT, c->traceId, c->roll, insertUs, trace_now(), 0);
+    if (registered != REGISTRY_OK) {
+        const char *reason = registered == REGISTRY_DUPLICATE ? "Roll number already logged in" : "Server out of memory";
+        log_warn("📛 Rejecting roll %s: %s", c->roll, reason);
+        conn_send_frame(c, MSG_LOGIN_FAIL, reason);
+        metrics_count(&metrics.loginsRejected, 1);
+        conn_close(c);
+        return;
+    }
+
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_LOGIN_OK);
+    pb_put_str(&frame, c->name);
+    pb_put_str(&frame, c->reg_no);
+    pb_put_str(&frame, c->token);
+    proto_end(&frame, start);
+    if (frame.failed) {
+        pb_free(&frame);
+        conn_close(c);
+        return;
+    }
+    conn_send(c, frame.data, frame.len);
+    pb_free(&frame);
+    if (c->state == CONN_CLOSED) return;
+    log_info("📤 Sent login response: %s|%s", c->name, c->reg_no);
+    metrics_count(&metrics.loginsAccepted, 1);
+    hist_record(&metrics.loginLatency, elapsed_us(&received));
+
+    if (atomic_load(&c->exam->started)) {
+        conn_start_exam(c, 0);
+        return;
+    }
+    timer_cancel(&c->loop->wheel, &c->timer);
+    c->state = CONN_WAITING;
+    if (c->traceId) c->waitingUs = trace_now();
+    c->prev = NULL;
+    c->next = c->loop->waiting;
+    if (c->next) c->next->prev = c;
+    c->loop->waiting = c;
+    log_info("⏳ Client %s (socket %d) waiting for exam %s to start", c->roll, c->sock, c->exam->code);
+}
+
+// Worker side of a result: appends it to the results file under the file lock.
+void result_task_run(WorkItem *item) {
+    ResultTask *t = (ResultTask *)item;
+    long long startUs = traceEnabled ? trace_now() : 0;
+    append_result(t->exam, &t->result);
+    if (traceEnabled) trace_span(TRACE_APPEND_RESULT, t->traceId, t->result.roll, startUs, trace_now(), 0);
+}
+
+// Finds a hosted exam by code; an empty code means the default exam.
+Exam *exam_find(const char *code) {
+    if (code[0] == '\0') return exams[0];
+    for (int i = 0; i < examCount; i++) {
+        if (strcmp(exams[i]->code, code) == 0) return exams[i];
+    }
+    return NULL;
+}
+
+// The loop serving a student of an exam. A roll number always maps to the same loop, so a
+// resumed session comes back to where it was.
+EventLoop *exam_loop(Exam *e, const char *roll) {
+    return &loops[(e->firstLoop + roll_hash(roll) % e->loopSpan) % loopCount];
+}
+
+// Queues a connection for handing over to another loop at the end of this iteration. The
+// frame being handled stays in the input buffer and is handled again by the new loop.
+void conn_hand_off(Conn *c, EventLoop *target) {
+    c->handoff = target;
+    c->next_incoming = c->loop->handoffs;
+    c->loop->handoffs = c;
+}
+
+// Attaches a connection to the exam named in its first frame. Returns 1 if the frame can be
+// handled on this loop, 0 if it was rejected or handed over to the loop serving the exam.
+int conn_route(Conn *c, const char *code, const char *roll) {
+    Exam *e = exam_find(code);
+    if (e == NULL) {
+        log_warn("📛 Unknown exam code '%s' from roll %s", code, roll);
+        conn_send_frame(c, MSG_LOGIN_FAIL, "Unknown exam code");
+        conn_close(c);
+        return 0;
+    }
+    c->exam = e;
+    EventLoop *target = exam_loop(e, roll);
+    if (target == c->loop) return 1;
+    log_debug("🔀 Handing roll %s (socket %d) to loop %d for exam %s", roll, c->sock, target->id, e->code);
+    conn_hand_off(c, target);
+    return 0;
+}
+
+// Handles a MSG_LOGIN frame by queueing the credential check. A login that arrived on a
+// loop not serving the exam is handed over to the right loop and handled there.
+void conn_handle_login(Conn *c, ProtoReader *r) {
+    LoginTask *t = calloc(1, sizeof(LoginTask));
+    if (t == NULL) {
+        log_error("📛 Out of memory handling login on socket %d", c->sock);
+        conn_close(c);
+        return;
+    }
+    char code[32];
+    pr_str(r, t->roll, sizeof(t->roll));
+    pr_str(r, t->password, sizeof(t->password));
+    pr_str(r, code, sizeof(code));
+    if (r->failed || t->roll[0] == '\0') {
+        free(t);
+        conn_fail(c, "Malformed login");
+        return;
+    }
+    if (!conn_route(c, code, t->roll)) {
+        // Closed for an unknown exam code, or handed over and handled again on the exam's loop
+        if (c->state == CONN_CLOSED) metrics_count(&metrics.loginsRejected, 1);
+        free(t);
+        return;
+    }
+    log_info("📥 Received login data for roll %s (exam %s)", t->roll, c->exam->code);
+    memcpy(c->roll, t->roll, sizeof(c->roll));
+
+    t->exam = c->exam;
+    t->item.run = login_task_run;
+    t->item.done = login_task_done;
+    t->item.loop = c->loop;
+    t->conn = c;
+    clock_gettime(CLOCK_MONOTONIC, &t->received);
+    int waitSeconds = 0;
+    int position = admission_submit(&t->item, &waitSeconds);
+    if (position < 0) {
+        log_warn("📛 Login queue full, turning away roll %s", c->roll);
+        char reason[64];
+        snprintf(reason, sizeof(reason), "Server busy, try again in %d seconds", waitSeconds);
+        conn_send_frame(c, MSG_LOGIN_FAIL, reason);
+        metrics_count(&metrics.loginsRejected, 1);
+        conn_close(c);
+        free(t);
+        return;
+    }
+    c->pending++;
+    c->state = CONN_VERIFYING;
+    if (position == 0) return;
+
+    // The check happens once the queue ahead has been admitted; the client is told where it
+    // stands and the login deadline is moved past the expected wait
+    metrics_count(&metrics.loginsQueued, 1);
+    log_info("🚦 Roll %s is number %d in the login queue, about %d seconds", c->roll, position, waitSeconds);
+    timer_schedule(&c->loop->wheel, &c->timer, (waitSeconds + LOGIN_TIMEOUT) * 1000L);
+    ProtoBuf frame;
+    pb_init(&frame);
+    size_t start = proto_begin(&frame, MSG_LOGIN_QUEUED);
+    pb_put_varint(&frame, position);
+    pb_put_varint(&frame, waitSeconds);
+    proto_end(&frame, start);
+    if (!frame.failed) conn_send(c, frame.data, frame.len);
+    pb_free(&frame);
+}
+
+// Questions a student was given: the whole paper, or the ones sent so far of an adaptive one.
+int paper_given(PaperBuf *paper, AdaptiveSession *adaptive) {
+    return adaptive ? adaptive->asked : paper->count;
+}
+
+// Builds the result row of a student from the answers the server scored itself; unanswered
+// questions count as attempted and wrong. Returns NULL if memory ran out.
+ResultTask *result_task_new(Exam *exam, const char *roll, const char *name, int questions, int answerCount,
+                            int correctCount, const int *answerSeconds) {
+    ResultTask *t = calloc(1, sizeof(ResultTask));
+    if (t == NULL) {
+        log_error("📛 Out of memory storing result for roll %s", roll);
+        return NULL;
+    }
+    DashboardStudent *result = &t->result;
+    snprintf(result->roll, sizeof(result->roll), "%s", roll);
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->correctAnswers = correctCount;
+    result->totalQuestions = questions;
+    result->answeredCount = answerCount;
+    for (int i = 0; i < answerCount; i++) {
+        result->responseTimes[i] = answerSeconds[i];
+        result->totalTime += answerSeconds[i];
+    }
+    result->flagged = answerCount > 0 && result->totalTime / answerCount < MIN_ANSWER_TIME;
+    t->exam = exam;
+    t->item.run = result_task_run;
+    t->item.done = NULL;
+    return t;
+}
+
+// Handles a MSG_RESULT frame: queues the student's result for writing and closes the
+// connection. The row comes from the answers the server scored, never from the client's
+// own tally, so a client cannot claim marks or write under another roll; only the client's
+// cheating flag is taken, and only to raise one.
+void conn_handle_result(Conn *c, ProtoReader *r) {
+    char text[50];
+    pr_str(r, text, sizeof(text));  // Roll
+    pr_str(r, text, sizeof(text));  // Name
+    pr_varint(r);                   // Correct answers
+    pr_varint(r);                   // Questions
+    uint32_t flagged = pr_varint(r);
+    pr_varint(r);                   // Total time
+    uint32_t times = pr_varint(r);
+    for (uint32_t i = 0; i < times && !r->failed; i++) pr_varint(r);
+    if (r->failed) {
+        conn_fail(c, "Malformed exam result");
+        return;
+    }
+    log_info("📥 Received exam result for roll %s", c->roll);
+    ResultTask *t = result_task_new(c->exam, c->roll, c->name, paper_given(c->paper, c->adaptive),
+                                    c->answerCount, c->correctCount, c->answerSeconds);
+    if (t == NULL) {
+        conn_close(c);
+        return;
+    }
+    if (flagged) t->result.flagged = 1;
+    if (c->traceId) {
+        long long now = trace_now();
+        if (c->frameUs) trace_span(TRACE_RESULT_RECV, c->traceId, c->roll, c->frameUs, now, 0);
+        if (c->examUs) trace_span(TRACE_EXAM, c->traceId, c->roll, c->examUs, now, 0);
+    }
+    t->traceId = c->traceId;
+    worker_pool_submit(&t->item);
+    conn_close(c);
+}
+
+// One streamed answer as it goes to the answer log
+typedef struct {
+    Exam *exam;              // Exam the answer belongs to
+    char roll[50];
+    int qid;                 // Question id
+    char option;             // 'A'-'D', or 0 if the student gave no valid answer
+    int correct;             // 1 if option matches the paper's answer key
+    int responseMs;          // Time the student took, as measured by the client
+    time_t received;         // When the server received it
+} AnswerEvent;
+
+// Answers collected by one loop iteration, written to the answer log by a pool task
+typedef struct AnswerBatch {
+    WorkItem item;
+    int count;
+    AnswerEvent events[ANSWER_BATCH];
+} AnswerBatch;
+
+// Finds the totals of a question in the live view, adding them on its first answer. Called
+// with the live mutex held. Returns NULL if memory ran out.
+LiveQuestion *live_question(LiveStats *live, int qid) {
+    if (live->used * 2 >= live->slots) {
+        int slots = live->slots ? live->slots * 2 : 64;
+        LiveQuestion *grown = malloc(slots * sizeof(LiveQuestion));
+        if (grown == NULL) return NULL;
+        for (int i = 0; i < slots; i++) grown[i].qid = -1;
+        for (int i = 0; i < live->slots; i++) {
+            if (live->questions[i].qid < 0) continue;
+            int j = (unsigned int)live->questions[i].qid * 2654435761u & (slots - 1);
+            while (grown[j].qid >= 0) j = (j + 1) & (slots - 1);
+            grown[j] = live->questions[i];
+        }
+        free(live->questions);
+        live->questions = grown;
+        live->slots = slots;
+    }
+    int j = (unsigned int)qid * 2654435761u & (live->slots - 1);
+    while (live->questions[j].qid >= 0 && live->questions[j].qid != qid) j = (j + 1) & (live->slots - 1);
+    if (live->questions[j].qid < 0) {
+        memset(&live->questions[j], 0, sizeof(LiveQuestion));
+        live->questions[j].qid = qid;
+        live->used++;
+    }
+    return &live->questions[j];
+}
+
+// Orders live question totals by question id for qsort.
+int compare_live_questions(const void *a, const void *b) {
+    return ((const LiveQuestion *)a)->qid - ((const LiveQuestion *)b)->qid;
+}
+
+// Writes the events of one exam in a batch, starting at first, to that exam's answer log
+// with one file open and lock, then folds them into its live statistics.
+void answer_batch_write(AnswerBatch *b, int first, char *written) {
+    Exam *exam = b->events[first].exam;
+    char path[MAX_LINE];
+    exam_path(exam, ANSWER_FILE, path, sizeof(path));
+    FILE *fp = fopen(path, "a");
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    if (fp == NULL) {
+        log_error("📛 Error opening answer file %s: %s", path, strerror(errno));
+    } else {
+        lock.l_type = F_WRLCK;
+        fcntl(fileno(fp), F_SETLKW, &lock);
+    }
+    int count = 0;
+    for (int i = first; i < b->count; i++) {
+        AnswerEvent *e = &b->events[i];
+        if (e->exam != exam) continue;
+        written[i] = 1;
+        count++;
+        if (fp) {
+            fprintf(fp, "%s|%d|%c|%d|%d|%ld\n", e->roll, e->qid, e->option ? e->option : '-',
+                    e->correct, e->responseMs, (long)e->received);
+        }
+    }
+    if (fp) {
+        fflush(fp);
+        lock.l_type = F_UNLCK;
+        fcntl(fileno(fp), F_SETLK, &lock);
+        fclose(fp);
+        metrics_count(&metrics.answers, count);
+        hist_record(&metrics.answerAppend, elapsed_us(&started));
+    }
+
+    LiveStats *live = &exam->live;
+    pthread_mutex_lock(&live->mutex);
+    live->answers += count;
+    live->batches++;
+    if (count > live->maxBatch) live->maxBatch = count;
+    for (int i = first; i < b->count; i++) {
+        AnswerEvent *e = &b->events[i];
+        if (e->exam != exam) continue;
+        LiveQuestion *q = live_question(live, e->qid);
+        if (q == NULL) continue;
+        q->answered++;
+        q->correct += e->correct;
+        q->responseMs += e->responseMs;
+    }
+    pthread_mutex_unlock(&live->mutex);
+}
+
+// Worker side of an answer batch. A loop may serve several exams, so the batch is written
+// out one exam at a time.
+void answer_batch_run(WorkItem *item) {
+    AnswerBatch *b = (AnswerBatch *)item;
+    char written[ANSWER_BATCH] = {0};
+    for (int i = 0; i < b->count; i++) {
+        if (!written[i]) answer_batch_write(b, i, written);
+    }
+}
+
+// Hands the loop's pending answers to the worker pool. Called once per loop iteration, so
+// answers arriving together are written together.
+void loop_flush_answers(EventLoop *loop) {
+    if (loop->answers == NULL) return;
+    loop->answers->item.run = answer_batch_run;
+    loop->answers->item.done = NULL;
+    worker_pool_submit(&loop->answers->item);
+    loop->answers = NULL;
+}
+
+// Records a streamed answer. It must name a question of the student's paper; a repeated
+// answer to the same question is ignored so a retransmission cannot count twice.
+void conn_handle_answer(Conn *c, ProtoReader *r) {
+    uint32_t qid = pr_varint(r);
+    uint8_t option = pr_u8(r);
+    uint32_t responseMs = pr_varint(r);
+    if (r->failed || (option != 0 && !strchr("ABCD", option))) {
+        conn_fail(c, "Malformed answer");
+        return;
+    }
+    // An adaptive paper's questions are the ones sent so far
+    int count = c->adaptive ? c->adaptive->asked : c->paper->count;
+    const int *qids = c->adaptive ? c->adaptive->qids : c->paper->qids;
+    const char *key = c->adaptive ? c->adaptive->correct : c->paper->correct;
+    int index = -1;
+    for (int i = 0; i < count; i++) {
+        if (qids[i] == (int)qid) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        conn_fail(c, "Answer for a question not on the paper");
+        return;
+    }
+    if (c->answered & (1u << index)) {
+        log_warn("📛 Duplicate answer from roll %s for question %u ignored", c->roll, qid);
+        return;
+    }
+    c->answered |= 1u << index;
+    int correct = option != 0 && option == key[index];
+    c->correctCount += correct;
+    c->answerSeconds[c->answerCount++] = (responseMs + 500) / 1000;
+    if (c->adaptive) conn_adaptive_next(c, correct);
+    else if (c->answerCount < c->paper->count) conn_arm_answer_deadline(c);
+    else timer_schedule(&c->loop->wheel, &c->timer, ANSWER_GRACE * 1000L); // Only the result is left
+
+    EventLoop *loop = c->loop;
+    if (loop->answers == NULL) {
+        loop->answers = malloc(sizeof(AnswerBatch));
+        if (loop->answers == NULL) {
+            log_error("📛 Out of memory recording answer for roll %s", c->roll);
+            return;
+        }
+        loop->answers->count = 0;
+    }
+    AnswerEvent *e = &loop->answers->events[loop->answers->count++];
+    e->exam = c->exam;
+    snprintf(e->roll, sizeof(e->roll), "%s", c->roll);
+    e->qid = qid;
+    e->option = option;
+    e->correct = correct;
+    e->responseMs = responseMs;
+    e->received = time(NULL);
+    log_debug("📥 Answer from roll %s: question %u -> %c in %u ms", c->roll, qid, option ? option : '-', responseMs);
+    if (loop->answers->count == ANSWER_BATCH) loop_flush_answers(loop);
+}
+
+// Records the result of an exam the server had to end, built from the answers streamed so far.
+void record_closed_out_result(Exam *exam, const char *roll, const char *name, int questions, int answerCount,
+                              int correctCount, const int *answerSeconds) {
+    ResultTask *t = result_task_new(exam, roll, name, questions, answerCount, correctCount, answerSeconds);
+    if (t) worker_pool_submit(&t->item);
+}
+
+// Ends the exam of a student who ran out of time or stopped responding.
+void conn_close_out(Conn *c, const char *reason) {
+    record_closed_out_result(c->exam, c->roll, c->name, paper_given(c->paper, c->adaptive), c->answerCount,
+                             c->correctCount, c->answerSeconds);
+    log_info("⏰ Closing out roll %s after %d answer(s): %s", c->roll, c->answerCount, reason);
+    conn_fail(c, reason);
+}
+
+// Fires when a dropped student's resume window ends. If they never came back, their exam is
+// closed out like any other expired one; either way the saved state is freed here.
+void suspended_expire(Timer *t) {
+    SuspendedExam *se = (SuspendedExam *)((char *)t - offsetof(SuspendedExam, timer));
+    if (registry_expire(se)) {
+        record_closed_out_result(se->paper->exam, se->roll, se->name, paper_given(se->paper, se->adaptive),
+                                 se->answerCount, se->correctCount, se->answerSeconds);
+        log_info("⏰ Closing out roll %s after %d answer(s): did not reconnect", se->roll, se->answerCount);
+    }
+    paper_release(se->paper);
+    free(se->adaptive);
+    free(se);
+}
+
+// Handles a connection lost to a network error. A student in the middle of the exam keeps
+// their session for resuming until the exam would have closed them out; anyone else is
+// simply disconnected.
+void conn_drop(Conn *c) {
+    if (c->state != CONN_EXAM || c->paper == NULL || !c->registered) {
+        conn_close(c);
+        return;
+    }
+    SuspendedExam *se = calloc(1, sizeof(SuspendedExam));
+    if (se == NULL) {
+        conn_close(c);
+        return;
+    }
+    // Another loop may resume the session as soon as it is suspended, so fill it in first
+    memcpy(se->roll, c->roll, sizeof(se->roll));
+    memcpy(se->name, c->name, sizeof(se->name));
+    memcpy(se->reg_no, c->reg_no, sizeof(se->reg_no));
+    se->paper = c->paper;
+    se->adaptive = c->adaptive;
+    se->answered = c->answered;
+    se->answerCount = c->answerCount;
+    se->correctCount = c->correctCount;
+    memcpy(se->answerSeconds, c->answerSeconds, sizeof(se->answerSeconds));
+    se->timer.fire = suspended_expire;
+    if (!registry_suspend(c, se)) {
+        free(se);
+        conn_close(c);
+        return;
+    }
+    long window = exam_remaining_ms(c->paper) + ANSWER_GRACE * 1000L;
+    log_info("🔌 Roll %s dropped mid-exam; session kept for %ld s", c->roll, window / 1000);
+    conn_close(c);
+    c->paper = NULL;   // The Conn's reference moves to the saved state
+    c->adaptive = NULL;
+    timer_schedule(&c->loop->wheel, &se->timer, window);
+}
+
+// Fires when a connection's deadline passes: a login that never completed, or a student
+// in the exam whose answer or exam time ran out.
+void conn_timer_fire(Timer *t) {
+    Conn *c = (Conn *)((char *)t - offsetof(Conn, timer));
+    if (c->state == CONN_LOGIN || c->state == CONN_VERIFYING) {
+        conn_fail(c, "Login timed out");
+    } else if (c->state == CONN_EXAM) {
+        conn_close_out(c, exam_remaining_ms(c->paper) <= 0 ? "Exam time is over" : "No answer within the time limit");
+    }
+}
+
+// Resumes a dropped student's exam on this connection. Only the questions they have not
+// answered yet are sent again, as slices of the shared paper. An adaptive paper's latest
+// question is encoded again if it came after START, and a finished adaptive paper is
+// followed by MSG_ADAPTIVE_DONE again.
+void conn_handle_resume(Conn *c, ProtoReader *r) {
+    char token[2 * SESSION_TOKEN_BYTES + 1];
+    char code[32];
+    pr_str(r, c->roll, sizeof(c->roll));
+    pr_str(r, token, sizeof(token));
+    pr_str(r, code, sizeof(code));
+    if (r->failed) {
+        conn_fail(c, "Malformed resume request");
+        return;
+    }
+    if (!conn_route(c, code, c->roll)) return;
+    if (!registry_resume(c, token)) {
+        log_warn("📛 Rejecting resume for roll %s", c->roll);
+        conn_send_frame(c, MSG_LOGIN_FAIL, "Session cannot be resumed");
+        conn_close(c);
+        return;
+    }
+    long left = exam_remaining_ms(c->paper);
+    if (left <= 0) {
+        conn_close_out(c, "Exam time is over");
+        return;
+    }
+
+    PaperBuf *paper = c->paper;
+    ProtoBuf head;
+    pb_init(&head);
+    pb_put_varint(&head, paper->answerTimeout);
+    pb_put_varint(&head, (uint32_t)((left + 999) / 1000));
+    pb_put_f32(&head, paper->marksCorrect);
+    pb_put_f32(&head, paper->marksWrong);
+    pb_put_varint(&head, paper_given(paper, c->adaptive) - c->answerCount);
+    AdaptiveSession *a = c->adaptive;
+    if (a && a->asked > 1 && !(c->answered & (1u << (a->asked - 1)))) {
+        // All earlier questions are answered, so this is the only one listed
+        int last = a->asked - 1;
+        paper_put_question(&head, &paper->bank->bank, a->qids[last], a->options[last]);
+    }
+    if (head.failed) {
+        pb_free(&head);
+        conn_fail(c, "Out of memory");
+        return;
+    }
+    unsigned char header[PROTO_HEADER_SIZE];
+    struct iovec iov[2 + NUM_EXAM_QUESTIONS];
+    int n = 2;
+    size_t bodyLen = head.len;
+    for (int i = 0; i < paper->count; i++) {
+        if (c->answered & (1u << i)) continue;
+        iov[n].iov_base = paper->data + paper->qoff[i];
+        iov[n].iov_len = paper->qlen[i];
+        bodyLen += paper->qlen[i];
+        n++;
+    }
+    proto_header(header, MSG_RESUME_OK, (uint32_t)bodyLen);
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = head.data;
+    iov[1].iov_len = head.len;
+
+    timer_cancel(&c->loop->wheel, &c->timer);
+    c->state = CONN_EXAM;
+    if (c->traceId) c->examUs = trace_now();
+    atomic_fetch_add(&c->exam->inProgress, 1);
+    if (a && a->done) timer_schedule(&c->loop->wheel, &c->timer, ANSWER_GRACE * 1000L); // Only the result is left
+    else conn_arm_answer_deadline(c);
+    conn_sendv(c, iov, n);
+    pb_free(&head);
+    if (c->state == CONN_CLOSED) return;
+    if (a && a->done) conn_send_adaptive_done(c);
+    if (c->state == CONN_CLOSED) return;
+    log_info("🔁 Roll %s resumed with %d unanswered question(s), %ld s left", c->roll,
+             paper_given(paper, a) - c->answerCount, left / 1000);
+}
+
+// Dispatches one complete frame according to the connection state.
+void conn_handle_frame(Conn *c, int type, const unsigned char *body, uint32_t len) {
+    ProtoReader r;
+    pr_init(&r, body, len);
+    if (c->state == CONN_LOGIN && type == MSG_LOGIN) {
+        conn_handle_login(c, &r);
+    } else if (c->state == CONN_LOGIN && type == MSG_RESUME) {
+        conn_handle_resume(c, &r);
+    } else if (c->state == CONN_EXAM && type == MSG_ANSWER) {
+        conn_handle_answer(c, &r);
+    } else if (c->state == CONN_EXAM && type == MSG_RESULT) {
+        conn_handle_result(c, &r);
+    } else {
+        log_warn("📛 Unexpected message type %d in state %d on socket %d", type, c->state, c->sock);
+        conn_fail(c, "Unexpected message");
+    }
+}
+
+// Handles every complete frame in a connection's input buffer. Stops early when the
+// connection is being handed over, leaving that frame for the new loop.
+void conn_process_input(Conn *c) {
+    size_t off = 0;
+    while (c->state != CONN_CLOSED && c->in_len - off >= PROTO_HEADER_SIZE) {
+        int type;
+        uint32_t len;
+        int rc = proto_parse_header(c->inbuf + off, &type, &len);
+        if (rc == PROTO_OK && len > MAX_INBOUND_BODY) rc = PROTO_TOO_BIG;
+        if (rc != PROTO_OK) {
+            conn_fail(c, proto_strerror(rc));
+            return;
+        }
+        if (c->in_len - off < PROTO_HEADER_SIZE + len) break;
+        conn_handle_frame(c, type, c->inbuf + off + PROTO_HEADER_SIZE, len);
+        if (c->handoff != NULL) break;
+        off += PROTO_HEADER_SIZE + len;
+    }
+    if (c->state == CONN_CLOSED) return;
+    if (off > 0) {
+        memmove(c->inbuf, c->inbuf + off, c->in_len - off);
+        c->in_len -= off;
+    }
+}
+
+// Reads whatever is available on a connection and handles every complete frame in it.
+void conn_on_readable(Conn *c) {
+    while (c->state != CONN_CLOSED && c->handoff == NULL) {
+        ssize_t n = recv(c->sock, c->inbuf + c->in_len, sizeof(c->inbuf) - c->in_len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            log_warn("📛 Error receiving from socket %d: %s", c->sock, strerror(errno));
+            conn_drop(c);
+            return;
+        }
+        if (n == 0) {
+            if (c->state == CONN_EXAM) log_warn("📛 Error receiving exam result for roll %s: connection closed", c->roll);
+            conn_drop(c);
+            return;
+        }
+        if (c->traceId && c->in_len == 0) c->frameUs = trace_now();
+        c->in_len += n;
+        metrics_count(&c->loop->bytesReceived, n);
+        conn_process_input(c);
+    }
+}
+
+// Registers a newly accepted or handed-over connection with this loop's epoll and gives
+// it LOGIN_TIMEOUT seconds to log in. Runs on the loop thread, which owns it from now on.
+void loop_adopt(EventLoop *loop, Conn *c) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = c;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, c->sock, &ev) < 0) {
+        log_error("📛 Error registering client socket: %s", strerror(errno));
+        close(c->sock);
+        free(c);
+        return;
     }
-
-    for (int i = 0; i < studentCount; ++i) {
-        dashboardStudents[i].rank = i + 1;
+    c->timer.fire = conn_timer_fire;
+    timer_schedule(&loop->wheel, &c->timer, LOGIN_TIMEOUT * 1000L);
+    if (c->acceptedUs) {
+        trace_span(TRACE_ACCEPT, c->traceId, c->roll, c->acceptedUs, trace_now(), 0);
+        c->acceptedUs = 0;
     }
+    // A handed-over connection brings the frame that named its exam
+    if (c->in_len > 0) conn_process_input(c);
 }
 
-// Displays the dashboard with student ranks, times, accuracy, and flagged status.
-void displayDashboard() {
-    loadDashboardData();
-    flagSuspiciousActivity();
-    rankStudents();
+// Adopts newly accepted connections, runs finished pool work and starts the exam for every
+// student waiting on this loop once the instructor has started it.
+void loop_handle_wakeup(EventLoop *loop) {
+    uint64_t value;
+    while (read(loop->wakefd, &value, sizeof(value)) > 0);
 
-    printf("\n\n--------------------------------------------------\n");
-    printf("| Rank | Name         | Total Time | Accuracy | Flagged |\n");
-    printf("--------------------------------------------------\n");
+    pthread_mutex_lock(&loop->done_mutex);
+    WorkItem *item = loop->done_head;
+    loop->done_head = loop->done_tail = NULL;
+    Conn *incoming = loop->incoming;
+    loop->incoming = NULL;
+    pthread_mutex_unlock(&loop->done_mutex);
+    while (item != NULL) {
+        WorkItem *next = item->next;
+        item->done(item);
+        item = next;
+    }
+    while (incoming != NULL) {
+        Conn *next = incoming->next_incoming;
+        loop_adopt(loop, incoming);
+        incoming = next;
+    }
 
-    for (int i = 0; i < studentCount; ++i) {
-        float accuracy = dashboardStudents[i].totalQuestions > 0 ? 
-            (float)dashboardStudents[i].correctAnswers / dashboardStudents[i].totalQuestions * 100 : 0;
-        printf("| %-4d | %-12s | %-10d | %-8.2f | %-7s |\n",
-               dashboardStudents[i].rank,
-               dashboardStudents[i].name,
-               dashboardStudents[i].totalTime,
-               accuracy,
-               dashboardStudents[i].flagged ? "🚩" : "✅");
+    // Fan-out: queue START on every waiting connection of a started exam first; slow sockets
+    // keep their remainder in their own send queue and never hold up the rest of the loop
+    if (!atomic_exchange(&loop->startRequested, 0)) return;
+    Conn *c = loop->waiting;
+    while (c != NULL) {
+        Conn *next = c->next;
+        if (atomic_load(&c->exam->started)) conn_start_exam(c, 1);
+        c = next;
     }
-    printf("--------------------------------------------------\n");
 }
 
-// Prompts instructor to add a new question and appends it to the question file after validation.
-void add_question() {
-    FILE *fp = fopen(QUESTION_FILE, "a");
-    if (fp == NULL) {
-        perror("📛 Error opening questions file");
-        return;
+// Event loop thread: waits for socket readiness and drives each connection's state machine.
+void *event_loop_run(void *arg) {
+    EventLoop *loop = (EventLoop *)arg;
+    struct epoll_event events[MAX_EVENTS];
+    while (1) {
+        int n = epoll_wait(loop->epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_error("📛 Error waiting for events: %s", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == loop) {
+                loop_handle_wakeup(loop);
+                continue;
+            }
+            if (events[i].data.ptr == &loop->wheel) {
+                wheel_on_timerfd(&loop->wheel);
+                continue;
+            }
+            Conn *c = (Conn *)events[i].data.ptr;
+            if (c->state == CONN_CLOSED) continue;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                conn_on_readable(c);
+            }
+            if (c->state != CONN_CLOSED && (events[i].events & EPOLLOUT)) {
+                conn_flush(c);
+            }
+        }
+        loop_run_handoffs(loop);
+        while (loop->closed != NULL) {
+            Conn *c = loop->closed;
+            loop->closed = c->next_closed;
+            c->on_closed_list = 0;
+            if (c->pending > 0) continue; // Freed when its last pool task completes
+            conn_free_sendq(c);
+            if (c->paper) paper_release(c->paper);
+            free(c->adaptive);
+            free(c);
+        }
+        loop_flush_answers(loop);
     }
+    return NULL;
+}
 
-    Question newQuestion = {0};
-    printf("📝 Enter the question: ");
-    clear_input_buffer();
-    fgets(newQuestion.question, MAX_LINE, stdin);
-    trim(newQuestion.question);
-
-    printf("🅰️  Enter option A: ");
-    fgets(newQuestion.optionA, MAX_LINE, stdin);
-    trim(newQuestion.optionA);
-
-    printf("🅱️  Enter option B: ");
-    fgets(newQuestion.optionB, MAX_LINE, stdin);
-    trim(newQuestion.optionB);
-
-    printf("©️  Enter option C: ");
-    fgets(newQuestion.optionC, MAX_LINE, stdin);
-    trim(newQuestion.optionC);
+// Creates the epoll instance and wakeup eventfd for a loop and starts its thread.
+int event_loop_init(EventLoop *loop, int id) {
+    memset(loop, 0, sizeof(*loop));
+    loop->id = id;
+    pthread_mutex_init(&loop->done_mutex, NULL);
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd < 0) {
+        perror("📛 Error creating epoll instance");
+        return 0;
+    }
+    loop->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->wakefd < 0) {
+        perror("📛 Error creating eventfd");
+        close(loop->epfd);
+        return 0;
+    }
+    loop->wheel.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->wheel.fd < 0) {
+        perror("📛 Error creating timerfd");
+        close(loop->wakefd);
+        close(loop->epfd);
+        return 0;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = loop;
+    struct epoll_event tick;
+    tick.events = EPOLLIN;
+    tick.data.ptr = &loop->wheel;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wakefd, &ev) < 0 ||
+        epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wheel.fd, &tick) < 0 ||
+        pthread_create(&loop->thread, NULL, event_loop_run, loop) != 0) {
+        perror("📛 Error starting event loop");
+        close(loop->wheel.fd);
+        close(loop->wakefd);
+        close(loop->epfd);
+        return 0;
+    }
+    pthread_detach(loop->thread);
+    return 1;
+}
 
-    printf("🅳  Enter option D: ");
-    fgets(newQuestion.optionD, MAX_LINE, stdin);
-    trim(newQuestion.optionD);
+// Queues a connection on a loop's incoming queue. The loop adds it to epoll itself, after
+// which only the owning loop touches it.
+void loop_queue(EventLoop *loop, Conn *c) {
+    // Only the first connection queued since the loop last looked needs to wake it
+    pthread_mutex_lock(&loop->done_mutex);
+    int wake = loop->incoming == NULL && loop->done_head == NULL;
+    c->next_incoming = loop->incoming;
+    loop->incoming = c;
+    pthread_mutex_unlock(&loop->done_mutex);
+    uint64_t one = 1;
+    if (wake && write(loop->wakefd, &one, sizeof(one)) != sizeof(one)) {
+        log_error("📛 Error waking event loop: %s", strerror(errno));
+    }
+}
 
-    printf("✅ Enter the correct option (A/B/C/D): ");
-    scanf(" %c", &newQuestion.correct);
-    newQuestion.correct = toupper(newQuestion.correct);
+// Hands a freshly accepted, non-blocking socket to an event loop.
+int loop_add_client(EventLoop *loop, int client_sock) {
+    Conn *c = calloc(1, sizeof(Conn));
+    if (c == NULL) {
+        log_error("📛 Out of memory accepting socket %d", client_sock);
+        return 0;
+    }
+    c->sock = client_sock;
+    c->state = CONN_LOGIN;
+    c->loop = loop;
+    if (traceEnabled) {
+        c->traceId = atomic_fetch_add(&traceNextSession, 1) + 1;
+        c->acceptedUs = trace_now();
+    }
+    loop_queue(loop, c);
+    return 1;
+}
 
-    printf("📊 Enter difficulty level (1=Easy, 2=Medium, 3=Hard): ");
-    scanf("%d", &newQuestion.difficulty);
+// Passes the connections queued by conn_hand_off to their new loops. Runs after the event
+// batch, once nothing on this loop refers to them any more.
+void loop_run_handoffs(EventLoop *loop) {
+    while (loop->handoffs != NULL) {
+        Conn *c = loop->handoffs;
+        loop->handoffs = c->next_incoming;
+        if (c->state == CONN_CLOSED) continue; // Freed with the closed connections
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, c->sock, NULL);
+        timer_cancel(&loop->wheel, &c->timer);
+        c->loop = c->handoff;
+        c->handoff = NULL;
+        loop_queue(c->loop, c);
+    }
+}
+// Opens a listening socket on the port. With reuseport set, every acceptor gets its own
+// socket and the kernel spreads incoming connections across them.
+int open_listener(int port, int backlog, int reuseport) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("📛 Error creating socket");
+        return -1;
+    }
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        perror("📛 Error setting socket options");
+        close(fd);
+        return -1;
+    }
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        close(fd);
+        return -2;
+    }
 
-    if (newQuestion.question[0] == '\0' || newQuestion.optionA[0] == '\0' ||
-        newQuestion.optionB[0] == '\0' || newQuestion.optionC[0] == '\0' ||
-        newQuestion.optionD[0] == '\0' || !strchr("ABCD", newQuestion.correct) ||
-        newQuestion.difficulty < 1 || newQuestion.difficulty > 3) {
-        printf("📛 Invalid question data, not added\n");
-        fclose(fp);
-        return;
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        perror("📛 Error binding socket");
+        close(fd);
+        return -1;
     }
+    if (listen(fd, backlog) < 0) {
+        perror("📛 Error listening on socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
 
-    fprintf(fp, "%s\n%s\n%s\n%s\n%s\n%c\n%d\n", 
-           newQuestion.question, 
-           newQuestion.optionA,
-           newQuestion.optionB,
-           newQuestion.optionC,
-           newQuestion.optionD,
-           newQuestion.correct,
-           newQuestion.difficulty);
+// Acceptor thread: accepts students and hands them to the event loops round-robin.
+void *acceptor_run(void *arg) {
+    Acceptor *a = (Acceptor *)arg;
+    while (1) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_sock = accept4(a->fd, (struct sockaddr*)&client_addr, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_sock < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            atomic_fetch_add(&a->errors, 1);
+            log_error("📛 Error accepting client: %s", strerror(errno));
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Out of descriptors or memory: back off instead of spinning on the error
+                struct timespec pause = { 0, 10 * 1000 * 1000 };
+                nanosleep(&pause, NULL);
+            }
+            continue;
+        }
+        atomic_fetch_add_explicit(&a->accepted, 1, memory_order_relaxed);
+        long second = time(NULL);
+        if (second != a->windowSecond) {
+            a->windowSecond = second;
+            a->windowCount = 0;
+        }
+        if (++a->windowCount > atomic_load_explicit(&a->peakPerSecond, memory_order_relaxed)) {
+            atomic_store_explicit(&a->peakPerSecond, a->windowCount, memory_order_relaxed);
+        }
+        log_info("📥 Accepted new client connection (socket %d)", client_sock);
 
-    fclose(fp);
-    printf("🎉 Question added successfully!\n");
+        if (!loop_add_client(&loops[a->nextLoop], client_sock)) {
+            close(client_sock);
+        }
+        a->nextLoop = (a->nextLoop + 1) % loopCount;
+    }
+    return NULL;
 }
 
-// Sets the time limit per question and updates the rules file.
-void set_time_limit() {
-    int new_time;
-    printf("⏱️  Enter the new time limit for each question (in seconds): ");
-    scanf("%d", &new_time);
-    if (new_time <= 0 || new_time > 3600) {
-        printf("📛 Invalid time limit, using default: 30 seconds\n");
-        new_time = 30;
+// Opens the listening sockets and starts the acceptor threads. Returns how many started.
+int start_acceptors(int wanted, int port, int backlog) {
+    int shared = -1;
+    for (int i = 0; i < wanted; i++) {
+        Acceptor *a = &acceptors[acceptorCount];
+        memset(a, 0, sizeof(*a));
+        a->id = acceptorCount;
+        a->nextLoop = acceptorCount % loopCount;
+        if (shared < 0) {
+            a->fd = open_listener(port, backlog, 1);
+            if (a->fd == -2) {
+                // No SO_REUSEPORT: all acceptors take turns on one socket instead
+                printf("📛 SO_REUSEPORT unavailable, acceptors will share one socket\n");
+                a->fd = shared = open_listener(port, backlog, 0);
+            }
+            if (a->fd < 0) break;
+        } else {
+            a->fd = shared;
+        }
+        if (pthread_create(&a->thread, NULL, acceptor_run, a) != 0) {
+            perror("📛 Error creating acceptor thread");
+            if (a->fd != shared) close(a->fd);
+            break;
+        }
+        acceptorCount++;
     }
-    answerTimeout = new_time;
+    return acceptorCount;
+}
 
-    FILE *fp = fopen(RULES_FILE, "w");
-    if (fp == NULL) {
-        perror("📛 Error writing rules file");
-        return;
+// Creates an exam from the files in a directory and loads its rules and questions.
+Exam *exam_create(const char *code, const char *dir) {
+    Exam *e = calloc(1, sizeof(Exam));
+    if (e == NULL) {
+        printf("📛 Out of memory loading exam %s\n", code);
+        return NULL;
     }
-    fprintf(fp, "Time limit per question: %d\nMarks awarded for correct answer: %.2f\nMarks deducted for incorrect answer: %.2f\n", 
-            answerTimeout, marksForCorrectAnswer, marksDeductedForWrongAnswer);
-    fclose(fp);
-    printf("🔄 Time limit set to %d seconds.\n", answerTimeout);
+    e->id = examCount;
+    snprintf(e->code, sizeof(e->code), "%s", code);
+    snprintf(e->dir, sizeof(e->dir), "%s", dir);
+    e->duration = examDuration;
+    pthread_mutex_init(&e->live.mutex, NULL);
+    pthread_mutex_init(&e->fanout.mutex, NULL);
+    exam_path(e, ROSTER_FILE, e->rosterPath, sizeof(e->rosterPath));
+    e->roster.path = e->rosterPath;
+    e->roster.fields = 1;
+    load_rules(e);
+    load_questions(e);
+    int rolls = roster_load(e);
+    if (rolls >= 0) printf("📋 Roster of %s lists %d roll(s)\n", e->code, rolls);
+    exams[examCount++] = e;
+    return e;
 }
 
-// Sets the marking scheme for correct and wrong answers, and updates the rules file.
-void set_marking_scheme() {
-    printf("➕ Enter marks for correct answer: ");
-    scanf("%f", &marksForCorrectAnswer);
-    if (marksForCorrectAnswer <= 0 || marksForCorrectAnswer > 100) {
-        printf("📛 Invalid marks, using default: 1.0\n");
-        marksForCorrectAnswer = 1.0;
+// Orders exam codes for qsort.
+int compare_codes(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// Loads the default exam from the working directory and one more exam per subdirectory of
+// EXAMS_DIR, in order of their codes.
+void load_exams() {
+    if (exam_create(DEFAULT_EXAM, ".") == NULL) exit(EXIT_FAILURE);
+    DIR *dir = opendir(EXAMS_DIR);
+    if (dir == NULL) return;
+    char codes[MAX_EXAMS][32];
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < MAX_EXAMS - 1) {
+        char path[MAX_LINE];
+        struct stat st;
+        if (entry->d_name[0] == '.' || strlen(entry->d_name) >= sizeof(codes[0])) continue;
+        snprintf(path, sizeof(path), "%s/%s", EXAMS_DIR, entry->d_name);
+        if (stat(path, &st) < 0 || !S_ISDIR(st.st_mode)) continue;
+        snprintf(codes[count++], sizeof(codes[0]), "%s", entry->d_name);
     }
-    printf("➖ Enter marks deducted for wrong answer: ");
-    scanf("%f", &marksDeductedForWrongAnswer);
-    if (marksDeductedForWrongAnswer < 0 || marksDeductedForWrongAnswer > 100) {
-        printf("📛 Invalid marks, using default: 0.25\n");
-        marksDeductedForWrongAnswer = 0.25;
+    closedir(dir);
+    qsort(codes, count, sizeof(codes[0]), compare_codes);
+    for (int i = 0; i < count; i++) {
+        char path[MAX_LINE];
+        snprintf(path, sizeof(path), "%s/%.31s", EXAMS_DIR, codes[i]);
+        exam_create(codes[i], path);
     }
+}
 
-    FILE *fp = fopen(RULES_FILE, "w");
-    if (fp == NULL) {
-        perror("📛 Error writing rules file");
-        return;
+// Spreads the exams over the event loops. Each exam gets an equal share of consecutive loops,
+// or a single loop when there are more exams than loops, so exams do not compete for a core.
+void assign_exam_loops() {
+    int span = loopCount / examCount;
+    if (span < 1) span = 1;
+    for (int i = 0; i < examCount; i++) {
+        exams[i]->firstLoop = (i * span) % loopCount;
+        exams[i]->loopSpan = span;
+        printf("🏫 Exam %s served by event loop(s) %d-%d\n", exams[i]->code, exams[i]->firstLoop,
+               exams[i]->firstLoop + span - 1);
     }
-    fprintf(fp, "Time limit per question: %d\nMarks awarded for correct answer: %.2f\nMarks deducted for incorrect answer: %.2f\n", 
-            answerTimeout, marksForCorrectAnswer, marksDeductedForWrongAnswer);
-    fclose(fp);
-    printf("🔄 Marking scheme updated: +%.2f for correct, -%.2f for wrong.\n", 
-           marksForCorrectAnswer, marksDeductedForWrongAnswer);
 }
 
-// Sends exam configuration and selected questions to a connected student client.
-void send_exam_data(int client_sock) {
-    printf("📤 Sending exam data to socket %d\n", client_sock);
-    int valid_answerTimeout = 30;
-    float valid_marksForCorrectAnswer = 1.0;
-    float valid_marksDeductedForWrongAnswer = 0.25;
-    int num_questions = NUM_EXAM_QUESTIONS;
+// Metrics: appends formatted text to a buffer.
+void metrics_printf(ProtoBuf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void metrics_printf(ProtoBuf *b, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0 || !pb_reserve(b, n + 1)) return;
+    va_start(ap, fmt);
+    vsnprintf((char *)b->data + b->len, n + 1, fmt, ap);
+    va_end(ap);
+    b->len += n;
+}
 
-    // Validate rules before sending
-    if (answerTimeout > 0 && answerTimeout <= 3600) valid_answerTimeout = answerTimeout;
-    if (marksForCorrectAnswer > 0 && marksForCorrectAnswer <= 100) valid_marksForCorrectAnswer = marksForCorrectAnswer;
-    if (marksDeductedForWrongAnswer >= 0 && marksDeductedForWrongAnswer <= 100) valid_marksDeductedForWrongAnswer = marksDeductedForWrongAnswer;
-    if (totalQuestions < NUM_EXAM_QUESTIONS) {
-        printf("📛 Warning: Only %d questions available\n", totalQuestions);
-        num_questions = totalQuestions;
+// Metrics: escapes a label value as the exposition format requires: backslash, double quote
+// and newline become \\, \" and \n. out must hold twice the value's length plus one.
+void metrics_label(const char *value, char *out) {
+    for (; *value; value++) {
+        if (*value == '\\' || *value == '"') {
+            *out++ = '\\';
+            *out++ = *value;
+        } else if (*value == '\n') {
+            *out++ = '\\';
+            *out++ = 'n';
+        } else {
+            *out++ = *value;
+        }
     }
+    *out = '\0';
+}
 
-    printf("📜 Rules: Timeout=%d, Correct=%.2f, Wrong=%.2f, Questions=%d\n",
-           valid_answerTimeout, valid_marksForCorrectAnswer, valid_marksDeductedForWrongAnswer, num_questions);
+// Metrics: writes the HELP and TYPE lines that precede a metric's samples.
+void metrics_header(ProtoBuf *b, const char *name, const char *type, const char *help) {
+    metrics_printf(b, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
 
-    if (send(client_sock, &valid_answerTimeout, sizeof(int), 0) != sizeof(int)) {
-        perror("📛 Error sending answerTimeout");
-        return;
+// Metrics: writes a histogram in seconds. The fine buckets are folded into power-of-two
+// bounds from 1 us up, so every scrape exposes the same bucket set.
+void metrics_histogram(ProtoBuf *b, const char *name, const char *labels, Histogram *h) {
+    const char *sep = labels[0] ? "," : "";
+    unsigned long cumulative = 0;
+    int bucket = 0;
+    for (int k = 0; k <= HIST_EXPORT_MAX; k++) {
+        while (bucket < HIST_BUCKETS && hist_bucket_limit(bucket) <= (1ULL << k)) {
+            cumulative += atomic_load_explicit(&h->counts[bucket++], memory_order_relaxed);
+        }
+        metrics_printf(b, "%s_bucket{%s%sle=\"%g\"} %lu\n", name, labels, sep, (1ULL << k) / 1e6, cumulative);
     }
-    printf("📤 Sent answerTimeout: %d\n", valid_answerTimeout);
+    unsigned long count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    metrics_printf(b, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, count);
+    const char *open = labels[0] ? "{" : "", *close = labels[0] ? "}" : "";
+    metrics_printf(b, "%s_sum%s%s%s %.6f\n", name, open, labels, close,
+                   atomic_load_explicit(&h->sum, memory_order_relaxed) / 1e6);
+    metrics_printf(b, "%s_count%s%s%s %lu\n", name, open, labels, close, count);
+}
 
-    if (send(client_sock, &valid_marksForCorrectAnswer, sizeof(float), 0) != sizeof(float)) {
-        perror("📛 Error sending marksForCorrectAnswer");
-        return;
-    }
-    printf("📤 Sent marksForCorrectAnswer: %.2f\n", valid_marksForCorrectAnswer);
+// Metrics: renders every metric in the Prometheus text exposition format.
+void metrics_render(ProtoBuf *b) {
+    metrics_header(b, "examsys_logins_total", "counter", "Student logins by outcome.");
+    metrics_printf(b, "examsys_logins_total{result=\"accepted\"} %lu\n", atomic_load(&metrics.loginsAccepted));
+    metrics_printf(b, "examsys_logins_total{result=\"rejected\"} %lu\n", atomic_load(&metrics.loginsRejected));
+    metrics_header(b, "examsys_login_latency_seconds", "histogram", "Time from a login request to LOGIN_OK.");
+    metrics_histogram(b, "examsys_login_latency_seconds", "", &metrics.loginLatency);
+    pthread_mutex_lock(&admission.mutex);
+    int queued = admission.depth;
+    pthread_mutex_unlock(&admission.mutex);
+    metrics_header(b, "examsys_login_queue_depth", "gauge", "Logins waiting for an admission token.");
+    metrics_printf(b, "examsys_login_queue_depth %d\n", queued);
+    metrics_header(b, "examsys_logins_queued_total", "counter", "Logins that waited in the admission queue.");
+    metrics_printf(b, "examsys_logins_queued_total %lu\n", atomic_load(&metrics.loginsQueued));
+    metrics_header(b, "examsys_login_queue_wait_seconds", "histogram", "Time from a login request to its admission into the worker pool.");
+    metrics_histogram(b, "examsys_login_queue_wait_seconds", "", &metrics.admissionWait);
 
-    if (send(client_sock, &valid_marksDeductedForWrongAnswer, sizeof(float), 0) != sizeof(float)) {
-        perror("📛 Error sending marksDeductedForWrongAnswer");
-        return;
+    metrics_header(b, "examsys_active_sessions", "gauge", "Students currently registered, including dropped ones who may resume.");
+    metrics_printf(b, "examsys_active_sessions %d\n", atomic_load(&registryCount));
+    metrics_header(b, "examsys_exam_students", "gauge", "Students of each exam by state.");
+    for (int i = 0; i < examCount; i++) {
+        Exam *e = exams[i];
+        char code[2 * sizeof(e->code)];
+        metrics_label(e->code, code);
+        metrics_printf(b, "examsys_exam_students{exam=\"%s\",state=\"registered\"} %d\n", code, atomic_load(&e->registered));
+        metrics_printf(b, "examsys_exam_students{exam=\"%s\",state=\"in_progress\"} %d\n", code, atomic_load(&e->inProgress));
+        metrics_printf(b, "examsys_exam_students{exam=\"%s\",state=\"suspended\"} %d\n", code, atomic_load(&e->suspended));
     }
-    printf("📤 Sent marksDeductedForWrongAnswer: %.2f\n", valid_marksDeductedForWrongAnswer);
 
-    if (send(client_sock, &num_questions, sizeof(int), 0) != sizeof(int)) {
-        perror("📛 Error sending num_questions");
-        return;
+    unsigned long sent = 0, received = 0, accepted = 0;
+    for (int i = 0; i < loopCount; i++) {
+        sent += atomic_load_explicit(&loops[i].bytesSent, memory_order_relaxed);
+        received += atomic_load_explicit(&loops[i].bytesReceived, memory_order_relaxed);
     }
-    printf("📤 Sent num_questions: %d\n", num_questions);
+    for (int i = 0; i < acceptorCount; i++) accepted += atomic_load(&acceptors[i].accepted);
+    metrics_header(b, "examsys_connections_accepted_total", "counter", "Student connections accepted.");
+    metrics_printf(b, "examsys_connections_accepted_total %lu\n", accepted);
+    metrics_header(b, "examsys_bytes_sent_total", "counter", "Bytes written to student connections.");
+    metrics_printf(b, "examsys_bytes_sent_total %lu\n", sent);
+    metrics_header(b, "examsys_bytes_received_total", "counter", "Bytes read from student connections.");
+    metrics_printf(b, "examsys_bytes_received_total %lu\n", received);
 
-    // Shuffle and select questions to send
-    int indices[MAX_QUESTIONS];
-    for (int i = 0; i < totalQuestions; i++) {
-        indices[i] = i;
-    }
-    srand(time(NULL));
-    for (int i = totalQuestions - 1; i > 0 && i >= totalQuestions - num_questions; i--) {
-        int j = rand() % (i + 1);
-        int temp = indices[i];
-        indices[i] = indices[j];
-        indices[j] = temp;
-    }
+    metrics_header(b, "examsys_start_fanout_seconds", "histogram", "Time from an exam start to START delivered, per student.");
+    metrics_histogram(b, "examsys_start_fanout_seconds", "", &metrics.fanoutDelay);
+    metrics_header(b, "examsys_results_total", "counter", "Results written to the results files.");
+    metrics_printf(b, "examsys_results_total %lu\n", atomic_load(&metrics.results));
+    metrics_header(b, "examsys_answers_total", "counter", "Streamed answers written to the answer logs.");
+    metrics_printf(b, "examsys_answers_total %lu\n", atomic_load(&metrics.answers));
+    metrics_header(b, "examsys_file_append_seconds", "histogram", "Time to append to a results file or answer log under its lock.");
+    metrics_histogram(b, "examsys_file_append_seconds", "file=\"results\"", &metrics.resultAppend);
+    metrics_histogram(b, "examsys_file_append_seconds", "file=\"answers\"", &metrics.answerAppend);
+    metrics_header(b, "examsys_adaptive_select_seconds", "histogram", "Time to update the ability estimate and choose the next adaptive question.");
+    metrics_histogram(b, "examsys_adaptive_select_seconds", "", &metrics.adaptiveSelect);
 
-    for (int i = 0; i < num_questions; i++) {
-        Question *q = &questions[indices[i]];
-        if (q->question[0] == '\0' || !strchr("ABCD", q->correct) || q->difficulty < 1 || q->difficulty > 3) {
-            printf("📛 Invalid question %d, sending default\n", i+1);
-            Question default_q = {
-                .question = "What is the default question?",
-                .optionA = "Option A",
-                .optionB = "Option B",
-                .optionC = "Option C",
-                .optionD = "Option D",
-                .correct = 'A',
-                .difficulty = 1
-            };
-            q = &default_q;
-        }
-        printf("📤 Sending question %d: %s\n", i+1, q->question);
-        printf("📤 Question %d hexdump:\n", i+1);
-        log_hexdump(q, sizeof(Question));
-        ssize_t sent = send(client_sock, q, sizeof(Question), 0);
-        if (sent != sizeof(Question)) {
-            fprintf(stderr, "📛 Error sending question %d: sent %zd bytes, expected %zu\n", i+1, sent, sizeof(Question));
-            return;
+    pthread_mutex_lock(&pool.mutex);
+    int depth = pool.depth;
+    pthread_mutex_unlock(&pool.mutex);
+    metrics_header(b, "examsys_worker_queue_depth", "gauge", "Tasks waiting for a worker thread.");
+    metrics_printf(b, "examsys_worker_queue_depth %d\n", depth);
+    metrics_header(b, "examsys_log_records_dropped_total", "counter", "Log records lost because a ring was full.");
+    metrics_printf(b, "examsys_log_records_dropped_total %ld\n", atomic_load(&logDropped));
+}
+
+// Opens the metrics endpoint: a Unix socket when the endpoint is a path, otherwise a TCP
+// port on the loopback interface only.
+int open_metrics_listener(const char *endpoint) {
+    int fd;
+    if (strchr(endpoint, '/') != NULL) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(endpoint) >= sizeof(addr.sun_path)) {
+            printf("📛 Metrics socket path too long: %s\n", endpoint);
+            return -1;
+        }
+        strcpy(addr.sun_path, endpoint);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            perror("📛 Error creating metrics socket");
+            return -1;
+        }
+        unlink(endpoint); // Left over from a previous run
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("📛 Error binding metrics socket");
+            close(fd);
+            return -1;
+        }
+    } else {
+        int port = atoi(endpoint);
+        if (port < 1 || port > 65535) {
+            printf("📛 Invalid metrics port: %s\n", endpoint);
+            return -1;
+        }
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            perror("📛 Error creating metrics socket");
+            return -1;
+        }
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("📛 Error binding metrics socket");
+            close(fd);
+            return -1;
         }
-        printf("📤 Sent question %d: %s (%zd bytes)\n", i+1, q->question, sent);
     }
+    if (listen(fd, 16) < 0) {
+        perror("📛 Error listening on metrics socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
 
-// Starts the exam for all registered students, sending them the START signal and exam data.
-void start_exam() {
-    pthread_mutex_lock(&clients_mutex);
-    if (clientCount == 0) {
-        printf("📛 No students registered for the exam.\n");
-        pthread_mutex_unlock(&clients_mutex);
-        return;
+// Answers one HTTP request on the metrics endpoint and closes the connection.
+void metrics_serve(int client) {
+    // A stalled scraper must not hold up the next one
+    struct timeval timeout = { 2, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char request[METRICS_REQUEST_MAX + 1];
+    size_t len = 0;
+    while (len < METRICS_REQUEST_MAX) {
+        ssize_t n = recv(client, request + len, METRICS_REQUEST_MAX - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
     }
-    printf("📢 Starting exam for %d registered students...\n", clientCount);
-    pthread_mutex_lock(&exam_mutex);
-    examStarted = 1;
-    pthread_cond_broadcast(&exam_cond);
-    pthread_mutex_unlock(&exam_mutex);
+    request[len] = '\0';
 
-    for (int i = 0; i < clientCount; i++) {
-        printf("📢 Sending START to client %s (socket %d)\n", clients[i].roll, clients[i].sock);
-        if (send(clients[i].sock, "START", 6, 0) != 6) {
-            perror("📛 Error sending START signal");
-        } else {
-            printf("✅ START sent to client %s\n", clients[i].roll);
-            send_exam_data(clients[i].sock);
-        }
+    ProtoBuf body, head;
+    pb_init(&body);
+    pb_init(&head);
+    const char *status = "200 OK";
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0) {
+        metrics_render(&body);
+    } else {
+        status = "404 Not Found";
+        metrics_printf(&body, "Only GET /metrics is served here\n");
+    }
+    metrics_printf(&head, "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: %zu\r\nConnection: close\r\n\r\n", status, body.len);
+    if (!head.failed && !body.failed) {
+        if (proto_send_all(client, head.data, head.len)) proto_send_all(client, body.data, body.len);
     }
-    pthread_mutex_unlock(&clients_mutex);
+    pb_free(&head);
+    pb_free(&body);
+    close(client);
 }
 
-// Handles an individual client (student) connection in a separate thread.
-// Manages login, registration, exam waiting, receiving results, and cleanup.
-void *handle_client(void *arg) {
-    int client_sock = *(int*)arg;
+// Metrics thread: serves scrapes one at a time; each takes well under a millisecond.
+void *metrics_run(void *arg) {
+    int fd = *(int *)arg;
     free(arg);
+    while (1) {
+        int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            log_error("📛 Error accepting metrics connection: %s", strerror(errno));
+            struct timespec pause = { 0, 100 * 1000 * 1000 };
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        metrics_serve(client);
+    }
+    return NULL;
+}
 
-    printf("📥 Handling new client (socket %d)\n", client_sock);
-
-    char buffer[MAX_LINE];
-    int n = recv(client_sock, buffer, MAX_LINE - 1, 0);
-    if (n <= 0) {
-        printf("📛 Error receiving login data: %s\n", strerror(errno));
-        close(client_sock);
-        return NULL;
+// Opens the metrics endpoint and starts the thread serving it. Returns 0 on failure.
+int start_metrics(const char *endpoint) {
+    int *fd = malloc(sizeof(int));
+    if (fd == NULL) return 0;
+    *fd = open_metrics_listener(endpoint);
+    if (*fd < 0) {
+        free(fd);
+        return 0;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, metrics_run, fd) != 0) {
+        perror("📛 Error creating metrics thread");
+        close(*fd);
+        free(fd);
+        return 0;
     }
-    buffer[n] = '\0';
-    printf("📥 Received login data: %s\n", buffer);
+    pthread_detach(thread);
+    return 1;
+}
 
-    char roll[50], password[50], name[50], reg_no[50];
-    sscanf(buffer, "%49[^|]|%49s", roll, password);
+// Exports the trace each time the server receives SIGUSR1, for headless runs without the menu.
+void *trace_signal_run(void *arg) {
+    sigset_t *set = (sigset_t *)arg;
+    int sig;
+    while (sigwait(set, &sig) == 0) {
+        trace_export(tracePath);
+    }
+    return NULL;
+}
 
-    if (!verify_student(roll, password, name, reg_no)) {
-        printf("📛 Invalid credentials for roll %s\n", roll);
-        if (send(client_sock, "INVALID", 8, 0) != 8) {
-            perror("📛 Error sending INVALID response");
+// Starts every exam that has not started yet once autoStartCount students have logged in to it.
+void *auto_start_run(void *arg) {
+    (void)arg;
+    int pending = examCount;
+    while (pending > 0) {
+        struct timespec pause = { 0, 100 * 1000 * 1000 };
+        nanosleep(&pause, NULL);
+        pending = 0;
+        for (int i = 0; i < examCount; i++) {
+            if (atomic_load(&exams[i]->startClaimed)) continue;
+            if (atomic_load(&exams[i]->registered) >= autoStartCount) {
+                start_exam(exams[i]);
+            } else {
+                pending++;
+            }
         }
-        close(client_sock);
-        return NULL;
     }
+    return NULL;
+}
 
-    char response[100]; // Smaller buffer since name and reg_no are max 49 each
-    snprintf(response, sizeof(response), "%s|%s", name, reg_no);
-    if (send(client_sock, response, strlen(response) + 1, 0) != strlen(response) + 1) {
-        perror("📛 Error sending login response");
-        close(client_sock);
-        return NULL;
-    }
-    printf("📤 Sent login response: %s\n", response);
+// Prints the command line options.
+void usage(const char *prog) {
+    printf("Usage: %s [-p port] [-a acceptors] [-b backlog] [-l loops] [-d seconds] [-s students] [-r rate] [-B burst] [-m endpoint] [-t file]\n", prog);
+    printf("  -p port       TCP port for students (default %d)\n", SERVER_PORT);
+    printf("  -a acceptors  threads accepting connections (default: one per CPU)\n");
+    printf("  -b backlog    pending connections per listening socket (default %d)\n", DEFAULT_BACKLOG);
+    printf("  -l loops      event loop threads (default: one per CPU)\n");
+    printf("  -d seconds    overall exam time (default %d)\n", EXAM_DURATION);
+    printf("  -s students   start an exam by itself once this many students have logged in\n");
+    printf("  -r rate       admit at most this many logins per second; later ones queue in order (default: no limit)\n");
+    printf("  -B burst      logins admitted at once before -r pacing applies (default: one second's worth)\n");
+    printf("  -m endpoint   serve Prometheus metrics at /metrics on this local port or Unix socket path\n");
+    printf("  -t file       trace every session; export Chrome trace JSON to file from the menu or on SIGUSR1\n");
+}
 
-    pthread_mutex_lock(&clients_mutex);
-    clients[clientCount].sock = client_sock;
-    strncpy(clients[clientCount].roll, roll, MAX_LINE - 1);
-    clients[clientCount].roll[MAX_LINE - 1] = '\0';
-    clientCount++;
-    printf("🎉 Student %s (Roll: %s) registered. Total clients: %d\n", name, roll, clientCount);
-    pthread_mutex_unlock(&clients_mutex);
+// Shows how far an exam's students have got, from the answers streamed in so far.
+void display_live_progress(Exam *e) {
+    LiveStats *live = &e->live;
+    pthread_mutex_lock(&live->mutex);
+    printf("\n--------------------------------------------------\n");
+    printf("| 📡 Live Exam Progress                          |\n");
+    printf("--------------------------------------------------\n");
+    printf("| Exam                 : %-23s |\n", e->code);
+    printf("| Status               : %-23s |\n", exam_status(e));
+    printf("| Students in exam     : %-23d |\n", atomic_load(&e->inProgress));
+    printf("| Dropped, resumable   : %-23d |\n", atomic_load(&e->suspended));
+    printf("| Answers received     : %-23ld |\n", live->answers);
+    printf("| Answer batches       : %-10ld max %-9d |\n", live->batches, live->maxBatch);
+    printf("--------------------------------------------------\n");
+    printf("| %-8s | %-9s | %-9s | %-12s |\n", "Question", "Answered", "Correct", "Avg time");
+    printf("--------------------------------------------------\n");
+    LiveQuestion *sorted = live->used ? malloc(live->used * sizeof(LiveQuestion)) : NULL;
+    int n = 0;
+    for (int i = 0; sorted && i < live->slots; i++) {
+        if (live->questions[i].qid >= 0) sorted[n++] = live->questions[i];
+    }
+    if (n > 0) qsort(sorted, n, sizeof(LiveQuestion), compare_live_questions);
+    for (int i = 0; i < n; i++) {
+        LiveQuestion *q = &sorted[i];
+        printf("| %-8d | %-9ld | %8.1f%% | %10.1f s |\n", q->qid + 1, q->answered,
+               100.0 * q->correct / q->answered, q->responseMs / 1000.0 / q->answered);
+    }
+    free(sorted);
+    printf("--------------------------------------------------\n");
+    pthread_mutex_unlock(&live->mutex);
+}
 
-    pthread_mutex_lock(&exam_mutex);
-    while (!examStarted) {
-        printf("⏳ Client %s (socket %d) waiting for exam start\n", roll, client_sock);
-        pthread_cond_wait(&exam_cond, &exam_mutex);
+// Lets the instructor pick the exam the menu works on.
+void select_exam() {
+    printf("\n--------------------------------------------------\n");
+    printf("| 🏫 Hosted Exams                                |\n");
+    printf("--------------------------------------------------\n");
+    for (int i = 0; i < examCount; i++) {
+        printf("| %2d. %-20.20s %-8s %5d students |\n", i + 1, exams[i]->code, exam_status(exams[i]),
+               atomic_load(&exams[i]->registered));
+    }
+    printf("--------------------------------------------------\n");
+    printf("🎯 Enter exam number: ");
+    int choice;
+    if (scanf("%d", &choice) != 1 || choice < 1 || choice > examCount) {
+        printf("📛 Invalid exam number, staying on %s\n", currentExam->code);
+        return;
     }
-    pthread_mutex_unlock(&exam_mutex);
+    currentExam = exams[choice - 1];
+    printf("🏫 Now managing exam %s\n", currentExam->code);
+}
 
-    DashboardStudent result;
-    n = recv(client_sock, &result, sizeof(DashboardStudent), 0);
-    if (n <= 0) {
-        printf("📛 Error receiving exam result for roll %s: %s\n", roll, strerror(errno));
-    } else {
-        printf("📥 Received exam result for roll %s\n", roll);
-        append_result(&result);
+// Regenerates a student's paper from the start seed for an audit: the questions, their
+// order and the order their options were shown in, as the student received them.
+void audit_paper(Exam *e) {
+    char roll[MAX_LINE], line[MAX_LINE];
+    clear_input_buffer();
+    printf("🎓 Enter the student's roll number: ");
+    if (fgets(roll, sizeof(roll), stdin) == NULL) return;
+    trim(roll);
+    printf("🎲 Enter the paper seed (press Enter for the current start): ");
+    if (fgets(line, sizeof(line), stdin) == NULL) return;
+    trim(line);
+    unsigned long long startSeed = atomic_load(&e->startSeed);
+    if (line[0] != '\0' && sscanf(line, "%llx", &startSeed) != 1) {
+        printf("📛 Invalid seed\n");
+        return;
+    }
+    if (line[0] == '\0' && !atomic_load(&e->started)) {
+        printf("📛 Exam %s has not been started; enter the seed of the start to audit\n", e->code);
+        return;
     }
 
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < clientCount; i++) {
-        if (clients[i].sock == client_sock) {
-            printf("🗑️ Removing client %s (socket %d)\n", clients[i].roll, client_sock);
-            for (int j = i; j < clientCount - 1; j++) {
-                clients[j] = clients[j + 1];
-            }
-            clientCount--;
-            break;
+    // The current start's bank version, which its papers came from, or the latest one
+    BankSnapshot *b = bank_acquire(&e->startBank);
+    if (b == NULL) b = bank_acquire(&e->bank);
+    uint64_t seed = paper_seed(e, startSeed, roll);
+    PaperLayout layout;
+    paper_layout(e, b, seed, &layout);
+    const char *diffNames[] = { "", "Easy", "Medium", "Hard" };
+    printf("\n--------------------------------------------------\n");
+    printf("| 🔎 Paper of %-20.20s seed %016llx |\n", roll, startSeed);
+    printf("--------------------------------------------------\n");
+    for (int i = 0; i < layout.count; i++) {
+        QuestionView q;
+        if (!bank_question(&b->bank, layout.qids[i], &q)) {
+            printf("| Q%d  #%-8d  damaged, sent as the default question |\n", i + 1, layout.qids[i]);
+            continue;
         }
+        char shown = q.correct;
+        char order[5] = { 0 };
+        for (int k = 0; k < 4; k++) {
+            order[k] = (char)('A' + layout.options[i][k]);
+            if (layout.options[i][k] == q.correct - 'A') shown = (char)('A' + k);
+        }
+        printf("| Q%d  #%-8d %-6s  shown A-D = bank %s  correct %c |\n", i + 1, layout.qids[i],
+               diffNames[q.difficulty], order, shown);
+        printf("|     %-44.44s |\n", q.text[0]);
     }
-    printf("📊 Total clients after removal: %d\n", clientCount);
-    pthread_mutex_unlock(&clients_mutex);
-
-    close(client_sock);
-    printf("🔌 Closed client socket %d\n", client_sock);
-    return NULL;
+    printf("--------------------------------------------------\n");
+    printf("💡 Regenerated from version %u of the question bank; an earlier start may have used another\n", b->version);
+    if (b->irt) {
+        printf("💡 The paper is adaptive: this is its first question. The ones after it followed the\n"
+               "   student's answers and are listed in order, with the answers, in %s.\n", ANSWER_FILE);
+    }
+    bank_release(b);
 }
 
-// Provides the instructor with a menu to manage the exam system (set time, add questions, marking, dashboard, start exam).
+// Provides the instructor with a menu to manage the exam system (set time, add questions, marking, dashboard, start exam, statistics, live progress, switch exam, trace export, paper audit).
 void instructor_menu() {
     int instructor_choice;
     do {
-        printf("\n📋 Instructor Menu:\n");
+        printf("\n📋 Instructor Menu (exam: %s):\n", currentExam->code);
         printf("1. ⏱️  Set Time Limit for Questions\n");
         printf("2. 📝 Add a Question\n");
         printf("3. 📊 Set Marking Scheme\n");
         printf("4. 📈 View Dashboard\n");
         printf("5. 📢 Start Exam\n");
-        printf("6. 🚪 Exit\n");
+        printf("6. 📊 Server Statistics\n");
+        printf("7. 📡 Live Exam Progress\n");
+        printf("8. 🏫 Switch Exam\n");
+        printf("9. 🧵 Export Trace\n");
+        printf("10. 🔎 Regenerate a Student's Paper\n");
+        printf("11. 🚪 Exit\n");
         printf("🎯 Enter your choice: ");
-        scanf("%d", &instructor_choice);
+        if (scanf("%d", &instructor_choice) == EOF) {
+            // No terminal left, e.g. a headless load test: keep serving students without the menu
+            printf("\n📛 Instructor input closed, menu stopped\n");
+            return;
+        }
 
         switch (instructor_choice) {
             case 1:
-                set_time_limit();
+                set_time_limit(currentExam);
                 break;
             case 2:
-                add_question();
-                load_questions();
+                add_question(currentExam);
                 break;
             case 3:
-                set_marking_scheme();
+                set_marking_scheme(currentExam);
                 break;
             case 4:
-                displayDashboard();
+                displayDashboard(currentExam);
                 break;
             case 5:
-                start_exam();
+                start_exam(currentExam);
                 break;
             case 6:
+                display_server_stats();
+                break;
+            case 7:
+                display_live_progress(currentExam);
+                break;
+            case 8:
+                select_exam();
+                break;
+            case 9:
+                if (traceEnabled) trace_export(tracePath);
+                else printf("📛 Tracing is off; start the server with -t file\n");
+                break;
+            case 10:
+                audit_paper(currentExam);
+                break;
+            case 11:
                 printf("\n🚪 Exiting...\n");
                 break;
             default:
                 printf("\n📛 Invalid choice! Please try again.\n");
         }
         clear_input_buffer();
-    } while (instructor_choice != 6);
+    } while (instructor_choice != 11);
 }
 
+// bench.c includes this file to time its routines and brings its own main
+#ifndef EXAMSYS_NO_MAIN
 // Main function: initializes server, handles instructor login, starts instructor menu and client threads.
-int main() {
+int main(int argc, char *argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    int port = SERVER_PORT;
+    int backlog = DEFAULT_BACKLOG;
+    int wantedLoops = cpus > MAX_LOOPS ? MAX_LOOPS : (int)cpus;
+    int wantedAcceptors = cpus > MAX_ACCEPTORS ? MAX_ACCEPTORS : (int)cpus;
+    const char *metricsEndpoint = NULL;
+    double loginRate = 0, loginBurst = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:a:b:l:d:s:r:B:m:t:h")) != -1) {
+        switch (opt) {
+            case 'p': port = atoi(optarg); break;
+            case 'a': wantedAcceptors = atoi(optarg); break;
+            case 'b': backlog = atoi(optarg); break;
+            case 'l': wantedLoops = atoi(optarg); break;
+            case 'd': examDuration = atoi(optarg); break;
+            case 's': autoStartCount = atoi(optarg); break;
+            case 'r': loginRate = atof(optarg); break;
+            case 'B': loginBurst = atof(optarg); break;
+            case 'm': metricsEndpoint = optarg; break;
+            case 't': tracePath = optarg; traceEnabled = 1; break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (port < 1 || port > 65535 || backlog < 1 || wantedAcceptors < 1 || wantedAcceptors > MAX_ACCEPTORS ||
+        wantedLoops < 1 || wantedLoops > MAX_LOOPS || examDuration < 1 || autoStartCount < 0 ||
+        loginRate < 0 || loginBurst < 0) {
+        printf("📛 Invalid option value\n");
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
     printf("\n\n✨✨✨ Welcome to ExamSys - Instructor Server ✨✨✨\n\n");
-    printf("📏 Size of Question: %zu bytes\n", sizeof(Question));
+    printf("📏 Size of question record: %zu bytes\n", sizeof(QBankRecord));
     printf("📏 Size of DashboardStudent: %zu bytes\n", sizeof(DashboardStudent));
 
-    load_rules();
-    load_questions();
+    // writev() has no MSG_NOSIGNAL; a student vanishing must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGUSR1 exports the trace; blocked here so every thread created later inherits the mask
+    // and only the trace thread's sigwait receives it
+    static sigset_t traceSignals;
+    if (traceEnabled) {
+        sigemptyset(&traceSignals);
+        sigaddset(&traceSignals, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &traceSignals, NULL);
+    }
+
+    if (log_init(LOG_FILE)) {
+        printf("📝 Logging to %s\n", LOG_FILE);
+    }
+
+    load_exams();
+    currentExam = exams[0];
+
+    int students = cred_store_load(&studentCreds);
+    int instructors = cred_store_load(&instructorCreds);
+    if (instructors < 0) {
+        printf("📛 Could not read %s\n", INSTRUCTOR_FILE);
+        exit(EXIT_FAILURE);
+    }
+    printf("🔑 Indexed %d student and %d instructor account(s)\n", students < 0 ? 0 : students, instructors);
+    pthread_t reload_thread;
+    if (pthread_create(&reload_thread, NULL, reload_run, NULL) != 0) {
+        perror("📛 Error creating reload thread");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(reload_thread);
 
     char instructor_id[50], password[50], name[50];
     printf("\n👨‍🏫 Enter Instructor ID: ");
@@ -851,68 +4811,79 @@ int main() {
 
     printf("\n🎉 Login successful. Welcome, %s!\n", name);
 
-    int server_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_sock < 0) {
-        perror("📛 Error creating socket");
+    registry_init();
+    if (!worker_pool_init()) {
+        printf("📛 No worker thread could be started\n");
         exit(EXIT_FAILURE);
     }
-    struct sockaddr_in server_addr;
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(SERVER_PORT);
 
-    int opt = 1;
-    if (setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        perror("📛 Error setting socket options");
-        close(server_sock);
-        exit(EXIT_FAILURE);
+    admission_init(loginRate, loginBurst > 0 ? loginBurst : loginRate);
+    if (loginRate > 0) {
+        pthread_t admission_thread;
+        if (pthread_create(&admission_thread, NULL, admission_run, NULL) != 0) {
+            perror("📛 Error creating admission thread");
+            exit(EXIT_FAILURE);
+        }
+        pthread_detach(admission_thread);
+        printf("🚦 Admitting %.1f logins per second, bursts of %.0f\n", loginRate, admission.burst);
     }
 
-    if (bind(server_sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("📛 Error binding socket");
-        close(server_sock);
+    // Event loops, one per online CPU by default, serve all student connections
+    for (int i = 0; i < wantedLoops; i++) {
+        if (!event_loop_init(&loops[loopCount], i)) break;
+        loopCount++;
+    }
+    if (loopCount == 0) {
+        printf("📛 No event loop could be started\n");
         exit(EXIT_FAILURE);
     }
+    printf("🔁 Started %d event loop(s)\n", loopCount);
+    assign_exam_loops();
 
-    if (listen(server_sock, 10) < 0) {
-        perror("📛 Error listening on socket");
-        close(server_sock);
+    clock_gettime(CLOCK_MONOTONIC, &serverStarted);
+    if (start_acceptors(wantedAcceptors, port, backlog) == 0) {
+        printf("📛 No acceptor could be started\n");
         exit(EXIT_FAILURE);
     }
-
-    printf("🌐 Server listening on port %d...\n", SERVER_PORT);
+    printf("🌐 Server listening on port %d with %d acceptor(s), backlog %d...\n", port, acceptorCount, backlog);
 
     pthread_t instructor_thread;
     if (pthread_create(&instructor_thread, NULL, (void*(*)(void*))instructor_menu, NULL) != 0) {
         perror("📛 Error creating instructor thread");
-        close(server_sock);
         exit(EXIT_FAILURE);
     }
 
-    // Main server loop: accept and handle student clients
-    while (1) {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int *client_sock = malloc(sizeof(int));
-        *client_sock = accept(server_sock, (struct sockaddr*)&client_addr, &client_len);
-        if (*client_sock < 0) {
-            perror("📛 Error accepting client");
-            free(client_sock);
-            continue;
+    if (traceEnabled) {
+        pthread_t trace_thread;
+        if (pthread_create(&trace_thread, NULL, trace_signal_run, &traceSignals) != 0) {
+            perror("📛 Error creating trace thread");
+            exit(EXIT_FAILURE);
         }
-        printf("📥 Accepted new client connection (socket %d)\n", *client_sock);
+        pthread_detach(trace_thread);
+        printf("🧵 Tracing sessions; the trace goes to %s on menu option 9 or SIGUSR1\n", tracePath);
+    }
 
-        pthread_t client_thread;
-        if (pthread_create(&client_thread, NULL, handle_client, client_sock) != 0) {
-            perror("📛 Error creating client thread");
-            close(*client_sock);
-            free(client_sock);
-        } else {
-            pthread_detach(client_thread);
+    if (metricsEndpoint != NULL) {
+        if (!start_metrics(metricsEndpoint)) exit(EXIT_FAILURE);
+        if (strchr(metricsEndpoint, '/') != NULL) printf("📈 Metrics served at /metrics on %s\n", metricsEndpoint);
+        else printf("📈 Metrics served at http://127.0.0.1:%s/metrics\n", metricsEndpoint);
+    }
+
+    if (autoStartCount > 0) {
+        pthread_t auto_start_thread;
+        if (pthread_create(&auto_start_thread, NULL, auto_start_run, NULL) != 0) {
+            perror("📛 Error creating auto-start thread");
+            exit(EXIT_FAILURE);
         }
+        pthread_detach(auto_start_thread);
+        printf("⏩ Exams start by themselves once %d students have logged in\n", autoStartCount);
     }
 
-    close(server_sock);
+    // Student connections are served entirely by the acceptor and event loop threads
+    for (int i = 0; i < acceptorCount; i++) {
+        pthread_join(acceptors[i].thread, NULL);
+    }
     pthread_join(instructor_thread, NULL);
     return 0;
 }
+#endif